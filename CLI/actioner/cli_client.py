@@ -18,15 +18,64 @@
 ################################################################################
 
 import os
+import re
 import json
-import urllib3
-import requests
-from requests.structures import CaseInsensitiveDict
-from six.moves.urllib.parse import quote
+import time
+import codecs
+import hashlib
+import tempfile
+from six.moves.urllib.parse import quote, urlencode
 from collections import OrderedDict
 from cli_log import log_info, log_warning
 
-urllib3.disable_warnings()
+# The clish plugin provides the transport through its own curl handle.
+# It's available only inside clish, requests is used otherwise.
+try:
+    import clish_rest
+except ImportError:
+    clish_rest = None
+
+# The times of the stages, like "render", are added to the statistics
+# of the clish command. The scripts started by the clish actions write
+# them to the file of CLISH_STATS_FD, a "<stage> <seconds>" line each.
+if clish_rest is not None:
+    add_time = clish_rest.add_time
+elif os.getenv('CLISH_STATS_FD', '').isdigit():
+    def add_time(stage, seconds):
+        line = "{0} {1:.6f}\n".format(stage, seconds)
+        try:
+            os.write(int(os.environ['CLISH_STATS_FD']), line.encode())
+        except OSError:
+            pass
+else:
+    add_time = None
+
+
+def _rest_unavailable():
+    """Returns the error of the clish plugin while its circuit breaker
+    is open, the requests fail at once then like inside clish.
+    """
+    fd = os.getenv('CLISH_REST_BREAKER_FD', '')
+    if not fd.isdigit():
+        return None
+    try:
+        error = os.pread(int(fd), 256, 0)
+    except OSError:
+        return None
+    return error.decode('utf-8', 'replace') if error else None
+
+
+def _add_request_time(start):
+    """Adds the time of the REST request sent through requests"""
+    if add_time is not None:
+        add_time("rest", time.monotonic() - start)
+
+# Inside clish the replies can be CBOR (RFC 9254) if CLISH_REST_CBOR
+# is set. The plugin sends the JSON request bodies as CBOR then.
+try:
+    import clish_cbor
+except ImportError:
+    clish_cbor = None
 
 
 class ApiClient(object):
@@ -36,30 +85,49 @@ class ApiClient(object):
 
     # Initialize API root and session
     __api_root = os.getenv('REST_API_ROOT', 'https://localhost')
-    __session = requests.Session()
+    __session = None
 
     def request(self, method, path, data=None, headers={}, query=None, response_type=None):
 
-        url = "{0}{1}".format(ApiClient.__api_root, path)
-
-        req_headers = CaseInsensitiveDict({'User-Agent': 'sonic-cli'})
+        req_headers = {'User-Agent': 'sonic-cli'}
         req_headers.update(headers)
 
         body = None
         if data is not None:
-            if 'Content-Type' not in req_headers:
+            if not any(k.lower() == 'content-type' for k in req_headers):
                 req_headers['Content-Type'] = 'application/yang-data+json'
             body = json.dumps(data)
 
+        if clish_rest is not None:
+            return ApiClient.__native_request(method, path, req_headers, body, query, response_type)
+
+        unavailable = _rest_unavailable()
+        if unavailable:
+            return ApiClient.__new_error_response('%Error: {0}, try again later'.format(unavailable))
+
+        import requests
+        url = "{0}{1}".format(ApiClient.__api_root, path)
+
+        cache_key = None
+        cached = None
+        if method == "GET":
+            cache_key = RESPONSE_CACHE.key(url, query, req_headers)
+            cached, validators = RESPONSE_CACHE.validators(cache_key)
+            req_headers.update(validators)
+
+        start = time.monotonic()
         try:
-            r = ApiClient.__session.request(
+            r = ApiClient.__requests_session().request(
                 method,
                 url,
                 headers=req_headers,
                 data=body,
                 params=query,
-                verify=False)
+                verify=False,
+                timeout=ApiClient.__timeout(path))
 
+            if cache_key is not None:
+                r = RESPONSE_CACHE.reply(cache_key, cached, r)
             return Response(r, response_type)
 
         except requests.RequestException as e:
@@ -67,6 +135,179 @@ class ApiClient(object):
             # TODO have more specific error message based
             msg = '%Error: Could not connect to Management REST Server'
             return ApiClient.__new_error_response(msg)
+        finally:
+            _add_request_time(start)
+
+    @staticmethod
+    def __native_request(method, path, headers, body, query, response_type):
+        path = str(path)
+        if query:
+            path = "{0}?{1}".format(path, urlencode(query))
+        if REST_CBOR and not any(k.lower() == 'accept' for k in headers):
+            headers['Accept'] = CBOR_ACCEPT
+        hdrs = ["{0}: {1}".format(k, v) for k, v in headers.items()]
+        if body is not None:
+            body = body.encode('utf-8')
+
+        try:
+            status, ctype, content = clish_rest.request(method, path, hdrs, body)
+        except clish_rest.error as e:
+            log_info("cli_client request exception: {}", e)
+            return ApiClient.__new_error_response(ApiClient.__connect_error(e))
+
+        return Response(RawResponse(status, content, ctype, path), response_type)
+
+    def stream(self, method, path, headers={}, query=None):
+        """Sends the request and returns the reply once its headers are
+        received. The body is read by iterating the returned chunks.
+        Returns (RawResponse without content, chunks iterable, close function).
+        """
+        req_headers = {'User-Agent': 'sonic-cli'}
+        req_headers.update(headers)
+
+        if clish_rest is not None:
+            if query:
+                path = "{0}?{1}".format(path, urlencode(query))
+            hdrs = ["{0}: {1}".format(k, v) for k, v in req_headers.items()]
+            try:
+                s = clish_rest.stream(method, path, hdrs)
+            except clish_rest.error as e:
+                log_info("cli_client request exception: {}", e)
+                return None, None, None
+            return RawResponse(s.status, None, s.content_type, path), s, s.close
+
+        if _rest_unavailable():
+            return None, None, None
+
+        import requests
+        url = "{0}{1}".format(ApiClient.__api_root, path)
+        start = time.monotonic()
+        try:
+            r = ApiClient.__requests_session().request(
+                method,
+                url,
+                headers=req_headers,
+                params=query,
+                verify=False,
+                stream=True,
+                timeout=ApiClient.__timeout(path))
+        except requests.RequestException as e:
+            log_info("cli_client request exception: {}", e)
+            _add_request_time(start)
+            return None, None, None
+        raw = RawResponse(r.status_code, None, r.headers.get("Content-Type"), url)
+
+        # The request is done when the body is read
+        def close():
+            r.close()
+            _add_request_time(start)
+        return raw, r.iter_content(STREAM_CHUNK_SIZE), close
+
+    def get_items(self, path, item_path, depth=None, ignore404=True):
+        """Sends GET request and decodes the list at item_path while the
+        body is received. The item_path is the sequence of keys from the
+        root of the reply to the list. The list elements are pulled from
+        the items() of the returned StreamResponse, the error reply has
+        none.
+        """
+        q = self.prepare_query(depth=depth)
+        raw, chunks, close = self.stream("GET", path, query=q)
+        if raw is None:
+            msg = '%Error: Could not connect to Management REST Server'
+            resp = StreamResponse(RawResponse(), (), None, item_path)
+            resp.content = ApiClient.__new_error_response(msg).content
+            return resp
+        resp = StreamResponse(raw, chunks, close, item_path)
+        if ignore404 and resp.status_code == 404:
+            resp.status_code = 200
+            resp.content = None
+        return resp
+
+    def get_many(self, paths, depth=None, ignore404=True, response_type=None):
+        """Sends GET requests for all the paths concurrently and returns
+        their Responses in the order of the paths. Each Response is the
+        same as the get() of its path. The requests run on up to
+        GET_MANY_CONNECTIONS kept-alive connections.
+        """
+        q = self.prepare_query(depth=depth)
+        paths = [str(p) for p in paths]
+        if clish_rest is not None:
+            resps = ApiClient.__native_request_many(paths, q, response_type)
+        else:
+            from multiprocessing.pool import ThreadPool
+            pool = ThreadPool(min(len(paths), GET_MANY_CONNECTIONS) or 1)
+            interrupted = []
+
+            def get(p):
+                if interrupted:
+                    return None
+                return self.request("GET", p, query=q, response_type=response_type)
+
+            try:
+                resps = pool.map(get, paths)
+            except KeyboardInterrupt:
+                # Ctrl-C returns at once. The queued requests are skipped,
+                # the ones being sent are left to the worker threads.
+                interrupted.append(True)
+                raise
+            finally:
+                pool.close()
+
+        for resp in resps:
+            if ignore404 and resp.status_code == 404:
+                resp.status_code = 200
+                resp.content = None
+        return resps
+
+    @staticmethod
+    def __native_request_many(paths, query, response_type):
+        hdrs = ["User-Agent: sonic-cli"]
+        if REST_CBOR:
+            hdrs.append("Accept: " + CBOR_ACCEPT)
+        if query:
+            paths = ["{0}?{1}".format(p, urlencode(query)) for p in paths]
+
+        try:
+            replies = clish_rest.request_many([("GET", p, hdrs) for p in paths])
+        except clish_rest.error as e:
+            log_info("cli_client request exception: {}", e)
+            replies = [e] * len(paths)
+
+        resps = []
+        for path, reply in zip(paths, replies):
+            if isinstance(reply, clish_rest.error):
+                log_info("cli_client request exception: {}", reply)
+                resps.append(ApiClient.__new_error_response(ApiClient.__connect_error(reply)))
+                continue
+            status, ctype, content = reply
+            resps.append(Response(RawResponse(status, content, ctype, path), response_type))
+        return resps
+
+    @staticmethod
+    def __connect_error(e):
+        # The plugin fails the requests at once while the server doesn't respond
+        if isinstance(e, clish_rest.unavailable):
+            return '%Error: {0}, try again later'.format(e)
+        return '%Error: Could not connect to Management REST Server'
+
+    @staticmethod
+    def __timeout(path):
+        # Like the plugin, the RPCs get the long timeout
+        if str(path).startswith('/restconf/operations/'):
+            return (REST_CONNECT_TIMEOUT, float(os.getenv('CLISH_REST_TIMEOUT_RPC', 900)))
+        return (REST_CONNECT_TIMEOUT, float(os.getenv('CLISH_REST_TIMEOUT', 120)))
+
+    @staticmethod
+    def __requests_session():
+        if ApiClient.__session is None:
+            import urllib3
+            import requests
+            urllib3.disable_warnings()
+            ApiClient.__session = requests.Session()
+            # requests asks for gzip and decodes it, like the plugin
+            if os.getenv('CLISH_REST_COMPRESS') == '0':
+                ApiClient.__session.headers['Accept-Encoding'] = 'identity'
+        return ApiClient.__session
 
     def post(self, path, data={}, response_type=None):
         return self.request("POST", path, data, response_type=response_type)
@@ -108,11 +349,15 @@ class ApiClient(object):
 
     @staticmethod
     def __new_error_response(errMessage, errType='client', errTag='operation-failed'):
-        r = Response(requests.Response())
+        r = Response(RawResponse())
         r.content = {'ietf-restconf:errors': {'error': [{
             'error-type': errType, 'error-tag': errTag, 'error-message': errMessage}]}}
         return r
 
+    @staticmethod
+    def new_error_response(errMessage):
+        return ApiClient.__new_error_response(errMessage)
+
     def cli_not_implemented(self, hint):
         return self.__new_error_response('%Error: not implemented {0}'.format(hint))
 
@@ -138,12 +383,29 @@ class Path(object):
         return self.path
 
 
+class RawResponse(object):
+    """Minimal HTTP response for the transports other than requests.
+    The content can be a memoryview over the received buffer.
+    """
+
+    def __init__(self, status_code=None, content=None, content_type=None, url=None):
+        self.status_code = status_code
+        self.content = content
+        self.headers = {}
+        if content_type:
+            self.headers["Content-Type"] = content_type
+        self.url = url
+
+
 class Response(object):
     def __init__(self, response, response_type=None):
         self.response = response
         self.response_type = response_type
         self.status_code = (response.status_code if response.status_code else 0)
         self.content = response.content
+        if isinstance(self.content, memoryview) and not has_json_content(response) \
+                and not has_cbor_content(response):
+            self.content = self.content.tobytes()
 
         try:
             if response.content is None or len(response.content) == 0:
@@ -151,12 +413,20 @@ class Response(object):
             elif self.response_type and self.response_type.lower() == 'string':
                 self.content = str(response.content).decode('string_escape')
             elif has_json_content(response):
-                self.content = json.loads(response.content, object_pairs_hook=OrderedDict)
+                content = response.content
+                if isinstance(content, memoryview):
+                    # Decode right from the receive buffer
+                    content = str(content, 'utf-8')
+                self.content = json.loads(content, object_pairs_hook=OrderedDict)
+            elif has_cbor_content(response):
+                self.content = clish_cbor.loads(response.content)
         except ValueError:
             # TODO Can we set status_code to 5XX in this case???
             # Json parsing can fail only if server returned bad json
             log_warning("Server returned invalid json for url {}", self.response.url)
             self.content = response.content
+            if isinstance(self.content, memoryview):
+                self.content = self.content.tobytes()
 
     def ok(self):
         return self.status_code >= 200 and self.status_code <= 299
@@ -192,11 +462,327 @@ class Response(object):
         return self.content[key]
 
 
+class StreamResponse(Response):
+    """Response whose list elements are decoded while the body is
+    received. The error reply is read at once, its content is the
+    error JSON like for the Response.
+    """
+
+    def __init__(self, response, chunks, close, item_path):
+        self.__chunks = None
+        self.__close = close
+        self.__item_path = item_path
+        code = response.status_code if response.status_code else 0
+        if 200 <= code <= 299 and has_json_content(response):
+            Response.__init__(self, response)
+            self.__chunks = chunks
+            return
+        try:
+            response.content = b''.join(chunks)
+        except Exception as e:
+            log_info("cli_client stream exception: {}", e)
+        self.close()
+        Response.__init__(self, response)
+
+    def items(self):
+        """Yields the list elements as they are received. The ok() is
+        false once the transfer or decoding failed.
+        """
+        if self.__chunks is None:
+            return
+        decoder = JsonItemDecoder(self.__item_path)
+        try:
+            for chunk in self.__chunks:
+                for item in decoder.feed(chunk):
+                    yield item
+            for item in decoder.close():
+                yield item
+        except ValueError:
+            log_warning("Server returned invalid json for url {}", self.response.url)
+            self.status_code = 0
+        except Exception as e:
+            log_info("cli_client stream exception: {}", e)
+            self.status_code = 0
+            self.content = ApiClient.new_error_response(
+                '%Error: Could not connect to Management REST Server').content
+        finally:
+            self.close()
+
+    def close(self):
+        """Aborts the transfer unless the body is read till the end"""
+        self.__chunks = None
+        if self.__close is not None:
+            self.__close()
+            self.__close = None
+
+
+# Size of the body parts read by the requests transport
+STREAM_CHUNK_SIZE = 64 * 1024
+
+
+class ResponseCache(object):
+    """GET replies with an ETag or Last-Modified, for the requests
+    transport. The request is sent with If-None-Match/If-Modified-Since
+    and the cached reply is served when the server returns 304. The
+    actioner scripts run one process per command, so the replies are
+    kept in a private directory of the user, a file per request. The
+    least recently stored or revalidated replies are evicted over
+    max_size bytes and the ones older than max_age seconds are not
+    used. Inside clish the plugin caches the replies with the same
+    limits.
+    """
+
+    def __init__(self, path, max_size, max_age):
+        self.path = path
+        self.max_size = max_size if path else 0
+        self.max_age = max_age
+
+    def key(self, url, query, headers):
+        """Returns the cache key of the request, None if not cached.
+        The replies differ by the representation and the user. The
+        key is a hash, so the token is not kept in the file name."""
+        if not self.max_size:
+            return None
+        hdrs = dict((k.lower(), v) for k, v in headers.items())
+        key = "\n".join((url, urlencode(query or {}), hdrs.get('accept') or '',
+                         hdrs.get('authorization') or ''))
+        return hashlib.sha256(key.encode('utf-8')).hexdigest()
+
+    def validators(self, key):
+        """Returns the entry of the key and the headers to validate it.
+        The request keeps the entry till the reply, so it's served on
+        304 even if the file is evicted meanwhile."""
+        entry = self.__load(key) if key is not None else None
+        if entry is None:
+            return None, {}
+        hdrs = {}
+        if entry['etag']:
+            hdrs['If-None-Match'] = entry['etag']
+        if entry['modified']:
+            hdrs['If-Modified-Since'] = entry['modified']
+        return entry, hdrs
+
+    def reply(self, key, entry, r):
+        """Returns the validated entry on 304, caches the new reply
+        otherwise. The 304 without the entry is passed as is, it's the
+        reply to the validators of the caller."""
+        fname = os.path.join(self.path, key)
+        if r.status_code == 304 and entry is not None:
+            try:
+                os.utime(fname, None)
+            except OSError:
+                pass
+            return RawResponse(200, entry['content'], entry['content_type'], r.url)
+        if entry is not None:
+            try:
+                os.unlink(fname)
+            except OSError:
+                pass
+
+        etag = r.headers.get('ETag')
+        modified = r.headers.get('Last-Modified')
+        if r.status_code != 200 or not (etag or modified) or \
+                len(r.content) > self.max_size // 4:
+            return r
+        self.__store(key, {'etag': etag, 'modified': modified,
+                           'content_type': r.headers.get('Content-Type')}, r.content)
+        return r
+
+    def __load(self, key):
+        """Returns the entry of the key, None if it's missing or too old"""
+        fname = os.path.join(self.path, key)
+        try:
+            with open(fname, 'rb') as f:
+                if time.time() - os.fstat(f.fileno()).st_mtime > self.max_age:
+                    os.unlink(fname)
+                    return None
+                entry = json.loads(f.readline().decode('utf-8'))
+                entry['content'] = f.read()
+                return entry
+        except (OSError, ValueError):
+            return None
+
+    def __store(self, key, entry, content):
+        """Writes the entry to a private file renamed over the old one,
+        then evicts the oldest entries over the size limit"""
+        try:
+            os.makedirs(self.path, 0o700, exist_ok=True)
+            fd, tmp = tempfile.mkstemp(dir=self.path, prefix='.')
+            with os.fdopen(fd, 'wb') as f:
+                f.write(json.dumps(entry).encode('utf-8') + b'\n')
+                f.write(content)
+            os.replace(tmp, os.path.join(self.path, key))
+        except OSError as e:
+            log_info("cli_client cache not saved: {}", e)
+            return
+
+        try:
+            files = [(f.stat().st_mtime, f.stat().st_size, f.path)
+                     for f in os.scandir(self.path) if not f.name.startswith('.')]
+        except OSError:
+            return
+        size = sum(f[1] for f in files)
+        for _, fsize, fname in sorted(files):
+            if size <= self.max_size:
+                break
+            try:
+                os.unlink(fname)
+            except OSError:
+                pass
+            size -= fsize
+
+
+def _response_cache_path():
+    path = os.getenv('CLISH_REST_CACHE_DIR')
+    if path == '0':
+        return None
+    return path or os.path.join(os.path.expanduser('~'), '.clish_rest_cache')
+
+
+RESPONSE_CACHE = ResponseCache(_response_cache_path(),
+                               int(os.getenv('CLISH_REST_CACHE', '2048')) * 1024,
+                               int(os.getenv('CLISH_REST_CACHE_AGE', '300')))
+
+# Concurrent connections of get_many() for the requests transport,
+# the plugin keeps the same number of connections
+GET_MANY_CONNECTIONS = 8
+
+# Connect timeout of the requests transport in seconds, the read
+# timeouts are set by CLISH_REST_TIMEOUT and CLISH_REST_TIMEOUT_RPC
+REST_CONNECT_TIMEOUT = 2
+
+# The replies are asked for as CBOR, the servers without it send JSON
+REST_CBOR = clish_cbor is not None and os.getenv('CLISH_REST_CBOR', '0') not in ('', '0')
+CBOR_ACCEPT = 'application/yang-data+cbor, application/yang-data+json;q=0.9'
+
+_JSON_SPACE = re.compile(r'[\s,]*')
+_JSON_DECODER = json.JSONDecoder(object_pairs_hook=OrderedDict)
+
+
+def _json_decode(buf, pos, eof=False):
+    """Decodes the JSON value which starts at pos. Returns the value and
+    its end, or (None, None) if the value is not received completely yet.
+    """
+    try:
+        value, end = _JSON_DECODER.raw_decode(buf, pos)
+    except ValueError:
+        if eof:
+            raise
+        return None, None
+    # The number may continue in the next part
+    if end == len(buf) and not eof and buf[pos] not in '{["':
+        return None, None
+    return value, end
+
+
+class JsonItemDecoder(object):
+    """Incremental decoder of the list in the JSON document. The list
+    is found by the item_path, the keys of the objects from the root.
+    The body parts are fed as they are received, every complete list
+    element is decoded at once. The rest of the document is skipped.
+    If the item_path leads to an object, it's decoded as one element.
+    """
+
+    def __init__(self, item_path):
+        self.item_path = list(item_path)
+        self.matched = 0
+        self.state = 'value'
+        self.buf = ''
+        self.pos = 0
+        self.text = codecs.getincrementaldecoder('utf-8')()
+
+    def feed(self, data):
+        """Returns the list elements completed by the data"""
+        self.buf = self.buf[self.pos:] + self.text.decode(data)
+        self.pos = 0
+        return self.__decode(False)
+
+    def close(self):
+        """Returns the last elements. Raises ValueError if the document
+        is incomplete.
+        """
+        self.buf = self.buf[self.pos:] + self.text.decode(b'', True)
+        self.pos = 0
+        items = self.__decode(True)
+        started = self.matched or self.state != 'value'
+        if self.state != 'done' and (started or self.buf[self.pos:].strip()):
+            raise ValueError("Incomplete JSON document")
+        return items
+
+    def __decode(self, eof):
+        items = []
+        buf = self.buf
+        while self.state != 'done':
+            pos = _JSON_SPACE.match(buf, self.pos).end()
+            if pos == len(buf):
+                break
+            c = buf[pos]
+            if self.state == 'value':
+                if self.matched == len(self.item_path):
+                    if c == '[':
+                        self.state = 'items'
+                        self.pos = pos + 1
+                        continue
+                    item, end = _json_decode(buf, pos, eof)
+                    if end is None:
+                        break
+                    items.append(item)
+                    self.state = 'done'
+                    self.pos = end
+                    break
+                elif c == '{':
+                    self.state = 'object'
+                else:
+                    self.state = 'done'
+                self.pos = pos + 1
+            elif self.state == 'object':
+                if c != '"':
+                    # The end of the object, there's no item_path
+                    self.state = 'done'
+                    break
+                key, colon = _json_decode(buf, pos, eof)
+                if colon is None:
+                    break
+                colon = _JSON_SPACE.match(buf, colon).end()
+                if colon >= len(buf):
+                    break
+                if buf[colon] != ':':
+                    raise ValueError("Expecting ':' delimiter")
+                value = _JSON_SPACE.match(buf, colon + 1).end()
+                if value >= len(buf):
+                    break
+                if key == self.item_path[self.matched]:
+                    self.matched += 1
+                    self.state = 'value'
+                    self.pos = value
+                    continue
+                # Skip the value of other key
+                skipped, end = _json_decode(buf, value, eof)
+                if end is None:
+                    break
+                self.pos = end
+            elif self.state == 'items':
+                if c == ']':
+                    self.state = 'done'
+                    break
+                item, end = _json_decode(buf, pos, eof)
+                if end is None:
+                    break
+                items.append(item)
+                self.pos = end
+        return items
+
+
 def has_json_content(resp):
     ctype = resp.headers.get("Content-Type")
     return ctype is not None and "json" in ctype
 
 
+def has_cbor_content(resp):
+    ctype = resp.headers.get("Content-Type")
+    return clish_cbor is not None and ctype is not None and "cbor" in ctype
+
+
 def format_error_message(status_code, err_entry, formatter_func=None):
     if formatter_func is not None:
         err_msg = formatter_func(status_code, err_entry)
@@ -20,7 +20,6 @@
 import sys
 import re
 from cli_client import ApiClient, Path
-from rpipe_utils import pipestr
 from scripts.render_cli import show_cli_output
 
 
@@ -186,6 +185,5 @@ def run(func, args):
 
 
 if __name__ == '__main__':
-    pipestr().write(sys.argv)
     func = sys.argv[1]
     run(func, sys.argv[2:])
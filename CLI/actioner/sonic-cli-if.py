@@ -18,10 +18,12 @@
 ###########################################################################
 
 import sys
-from natsort import natsorted
+try:
+    from clish_natsort import natsorted
+except ImportError:
+    from natsort import natsorted
 
 from cli_client import ApiClient, Path
-from rpipe_utils import pipestr
 from scripts.render_cli import show_cli_output
 
 
@@ -48,53 +50,57 @@ def ipaddr_payload(ip):
     }]}
 
 
+# The config handlers get the parameters of the command by name from
+# clish_pyobj: iface of the interface view, the PARAMs and __command__.
+# The defaults are the values of the "no" commands.
 class Handlers:
     @staticmethod
-    def patch_openconfig_interfaces_interfaces_interface_config_description(name, value, *args):
-        return config_intf(name, "config/description", {"description": value})
+    def patch_openconfig_interfaces_interfaces_interface_config_description(iface, desc="", *args, **kwargs):
+        return config_intf(iface, "config/description", {"description": desc})
 
     @staticmethod
-    def patch_openconfig_interfaces_interfaces_interface_config_enabled(name, value, *args):
-        return config_intf(name, "config/enabled", {"enabled": (value == "True")})
+    def patch_openconfig_interfaces_interfaces_interface_config_enabled(iface, enabled=None, *args, **kwargs):
+        if enabled is None:
+            enabled = str(kwargs["__command__"].startswith("no "))
+        return config_intf(iface, "config/enabled", {"enabled": (enabled == "True")})
 
     @staticmethod
-    def patch_openconfig_interfaces_interfaces_interface_config_mtu(name, mtu, *args):
-        return config_intf(name, "config/mtu", {"mtu": int(mtu)})
+    def patch_openconfig_interfaces_interfaces_interface_config_mtu(iface, mtu="9100", *args, **kwargs):
+        return config_intf(iface, "config/mtu", {"mtu": int(mtu)})
 
     @staticmethod
-    def patch_openconfig_if_ip_interfaces_interface_subinterfaces_subinterface_ipv4_addresses_address_config(name, ip4, *args):
+    def patch_openconfig_if_ip_interfaces_interface_subinterfaces_subinterface_ipv4_addresses_address_config(iface, addr, *args, **kwargs):
         ip4_path = "subinterfaces/subinterface=0/openconfig-if-ip:ipv4/addresses/address"
-        return config_intf(name, ip4_path, ipaddr_payload(ip4))
+        return config_intf(iface, ip4_path, ipaddr_payload(addr))
 
     @staticmethod
-    def delete_openconfig_if_ip_interfaces_interface_subinterfaces_subinterface_ipv4_addresses_address_config_prefix_length(name, ip4):
-        ip4_path = Path("subinterfaces/subinterface=0/openconfig-if-ip:ipv4/addresses/address={ip}", ip=ip4)
-        return config_intf(name, ip4_path, None)
+    def delete_openconfig_if_ip_interfaces_interface_subinterfaces_subinterface_ipv4_addresses_address_config_prefix_length(iface, addr, *args, **kwargs):
+        ip4_path = Path("subinterfaces/subinterface=0/openconfig-if-ip:ipv4/addresses/address={ip}", ip=addr)
+        return config_intf(iface, ip4_path, None)
 
     @staticmethod
-    def patch_openconfig_if_ip_interfaces_interface_subinterfaces_subinterface_ipv6_addresses_address_config(name, ip6, *args):
+    def patch_openconfig_if_ip_interfaces_interface_subinterfaces_subinterface_ipv6_addresses_address_config(iface, addr, *args, **kwargs):
         ip6_path = "subinterfaces/subinterface=0/openconfig-if-ip:ipv6/addresses/address"
-        return config_intf(name, ip6_path, ipaddr_payload(ip6))
+        return config_intf(iface, ip6_path, ipaddr_payload(addr))
 
     @staticmethod
-    def delete_openconfig_if_ip_interfaces_interface_subinterfaces_subinterface_ipv6_addresses_address_config_prefix_length(name, ip6):
-        ip6_path = Path("subinterfaces/subinterface=0/openconfig-if-ip:ipv6/addresses/address={ip}", ip=ip6)
-        return config_intf(name, ip6_path, None)
+    def delete_openconfig_if_ip_interfaces_interface_subinterfaces_subinterface_ipv6_addresses_address_config_prefix_length(iface, addr, *args, **kwargs):
+        ip6_path = Path("subinterfaces/subinterface=0/openconfig-if-ip:ipv6/addresses/address={ip}", ip=addr)
+        return config_intf(iface, ip6_path, None)
 
     @staticmethod
     def get_openconfig_interfaces_interfaces(template, *args):
-        resp = ApiClient().get("/restconf/data/openconfig-interfaces:interfaces")
+        resp = ApiClient().get_items("/restconf/data/openconfig-interfaces:interfaces",
+                                     ("openconfig-interfaces:interfaces", "interface"))
+        # The records are decoded as they are received, the sort by
+        # name needs them all. The error reply has no records.
+        intf_list = natsorted(resp.items(), key=lambda x: x["name"])
         if not resp.ok():
             print(resp.error_message())
             return 1
-        if not resp.content:
+        if not intf_list:
             return 0
-        # Sort interface records by name
-        intf_list = resp.content.get("openconfig-interfaces:interfaces", {}).get("interface", [])
-        if len(intf_list) > 1:
-            sorted_list = natsorted(intf_list, key=lambda x: x["name"])
-            resp.content["openconfig-interfaces:interfaces"]["interface"] = sorted_list
-        show_cli_output(template, resp.content)
+        show_cli_output(template, {"openconfig-interfaces:interfaces": {"interface": intf_list}})
         return 0
 
     @staticmethod
@@ -109,11 +115,10 @@ class Handlers:
         return 0
 
 
-def run(func, args):
-    return getattr(Handlers, func)(*args)
+def run(func, args, **kwargs):
+    return getattr(Handlers, func)(*args, **kwargs)
 
 
 if __name__ == '__main__':
-    pipestr().write(sys.argv)
     func = sys.argv[1]
     run(func, sys.argv[2:])
@@ -18,10 +18,12 @@
 ###########################################################################
 
 import sys
-from natsort import natsorted
+try:
+    from clish_natsort import natsorted
+except ImportError:
+    from natsort import natsorted
 
 from cli_client import ApiClient, Path
-from rpipe_utils import pipestr
 from scripts.render_cli import show_cli_output
 
 
@@ -42,23 +44,33 @@ def show_lldp_interface(path, template):
     return 0
 
 
+# The templates of the commands. From clish_pyobj the handlers get the
+# parameters of the command by name and the command as __command__.
+TEMPLATES = {
+    "show lldp": "lldp_show.j2",
+    "show lldp table": "lldp_show.j2",
+    "show lldp neighbor": "lldp_neighbor_show.j2",
+}
+
+
 class Handlers:
     @staticmethod
-    def get_openconfig_lldp_lldp_interfaces(template, *args):
+    def get_openconfig_lldp_lldp_interfaces(template=None, *args, **kwargs):
+        if kwargs.get("ifname"):
+            return Handlers.get_openconfig_lldp_lldp_interfaces_interface(template, **kwargs)
         allif_path = Path("/restconf/data/openconfig-lldp:lldp/interfaces")
-        return show_lldp_interface(allif_path, template)
+        return show_lldp_interface(allif_path, template or TEMPLATES[kwargs["__command__"]])
 
     @staticmethod
-    def get_openconfig_lldp_lldp_interfaces_interface(template, ifname, *args):
+    def get_openconfig_lldp_lldp_interfaces_interface(template=None, ifname=None, *args, **kwargs):
         oneif_path = Path("/restconf/data/openconfig-lldp:lldp/interfaces/interface={name}", name=ifname)
-        return show_lldp_interface(oneif_path, template)
+        return show_lldp_interface(oneif_path, template or TEMPLATES[kwargs["__command__"]])
 
 
-def run(func, args):
-    return getattr(Handlers, func)(*args)
+def run(func, args, **kwargs):
+    return getattr(Handlers, func)(*args, **kwargs)
 
 
 if __name__ == '__main__':
-    pipestr().write(sys.argv)
     func = sys.argv[1]
     run(func, sys.argv[2:])
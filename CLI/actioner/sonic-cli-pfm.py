@@ -19,7 +19,6 @@
 
 import sys
 import cli_client as cc
-from rpipe_utils import pipestr
 from scripts.render_cli import show_cli_output
 
 
@@ -66,7 +65,6 @@ def run(func, args):
 
 if __name__ == '__main__':
 
-    pipestr().write(sys.argv)
     #pdb.set_trace()
     func = sys.argv[1]
     run(func, sys.argv[2:])
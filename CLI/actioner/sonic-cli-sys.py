@@ -19,7 +19,6 @@
 
 import sys
 from cli_client import ApiClient
-from rpipe_utils import pipestr
 from scripts.render_cli import show_cli_output
 
 
@@ -105,6 +104,5 @@ def run(func, args):
 
 
 if __name__ == '__main__':
-    pipestr().write(sys.argv)
     func = sys.argv[1]
     run(func, sys.argv[2:])
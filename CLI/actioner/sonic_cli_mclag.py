@@ -24,7 +24,6 @@ import collections
 import re
 #import pdb
 import cli_client as cc
-from rpipe_utils import pipestr
 from scripts.render_cli import show_cli_output
 
 def invoke(func, args):
@@ -203,53 +202,68 @@ def invoke(func, args):
         print("%Error: not implemented")
         exit(1)
 
-def mclag_get_portchannel_traffic_disable(po_name):
-    ''' call LAG Table Rest API to get LAG Admin Status '''
+def mclag_portchannel_traffic_disable_path(po_name):
+    return cc.Path('/restconf/data/sonic-portchannel:sonic-portchannel/LAG_TABLE/LAG_TABLE_LIST={lagname}/traffic_disable', lagname=po_name)
+
+def mclag_portchannel_traffic_disable(api_response):
+    ''' LAG traffic disable setting from LAG Table Rest API response '''
     traffic_disable = 'No'
 
-    aa = cc.ApiClient()
-    path = cc.Path('/restconf/data/sonic-portchannel:sonic-portchannel/LAG_TABLE/LAG_TABLE_LIST={lagname}/traffic_disable', lagname=po_name)
-    api_response = aa.get(path)
     if api_response.ok():
         response = api_response.content
-        if len(response) != 0:
+        if response is not None and len(response) != 0:
             if response['sonic-portchannel:traffic_disable']:
                 traffic_disable = 'Yes'
 
     return traffic_disable
 
+def mclag_get_portchannel_traffic_disable(po_name):
+    ''' call LAG Table Rest API to get LAG Admin Status '''
+    aa = cc.ApiClient()
+    return mclag_portchannel_traffic_disable(aa.get(mclag_portchannel_traffic_disable_path(po_name)))
+
 
-def mclag_get_local_if_port_isolate(po_name):
-    ''' call MCLAG Local Interface state Table Rest API to get Port isolate property setting '''
+def mclag_local_if_port_isolate_path(po_name):
+    return cc.Path('/restconf/data/sonic-mclag:sonic-mclag/MCLAG_LOCAL_INTF_TABLE/MCLAG_LOCAL_INTF_TABLE_LIST={if_name}/port_isolate_peer_link', if_name=po_name)
+
+def mclag_local_if_port_isolate(api_response):
+    ''' Port isolate property setting from MCLAG Local Interface state Table Rest API response '''
     port_isolate = 'No'
 
-    aa = cc.ApiClient()
-    path = cc.Path('/restconf/data/sonic-mclag:sonic-mclag/MCLAG_LOCAL_INTF_TABLE/MCLAG_LOCAL_INTF_TABLE_LIST={if_name}/port_isolate_peer_link', if_name=po_name)
-    api_response = aa.get(path)
     if api_response.ok():
         response = api_response.content
-        if len(response) != 0:
+        if response is not None and len(response) != 0:
             if response['sonic-mclag:port_isolate_peer_link']:
                 port_isolate = 'Yes'
 
     return port_isolate
 
+def mclag_get_local_if_port_isolate(po_name):
+    ''' call MCLAG Local Interface state Table Rest API to get Port isolate property setting '''
+    aa = cc.ApiClient()
+    return mclag_local_if_port_isolate(aa.get(mclag_local_if_port_isolate_path(po_name)))
 
 
 
-def mclag_get_portchannel_oper_status(po_name):
-    ''' call LAG Table Rest API to get LAG Admin Status '''
+
+def mclag_portchannel_oper_status_path(po_name):
+    return cc.Path('/restconf/data/sonic-portchannel:sonic-portchannel/LAG_TABLE/LAG_TABLE_LIST={lagname}/oper_status', lagname=po_name)
+
+def mclag_portchannel_oper_status(api_response):
+    ''' LAG Oper Status from LAG Table Rest API response '''
     po_oper_status = 'down'
 
-    aa = cc.ApiClient()
-    path = cc.Path('/restconf/data/sonic-portchannel:sonic-portchannel/LAG_TABLE/LAG_TABLE_LIST={lagname}/oper_status', lagname=po_name)
-    api_response = aa.get(path)
     if api_response.ok():
         response = api_response.content
-        if len(response) != 0:
+        if response is not None and len(response) != 0:
             po_oper_status = response['sonic-portchannel:oper_status']
     return po_oper_status
 
+def mclag_get_portchannel_oper_status(po_name):
+    ''' call LAG Table Rest API to get LAG Admin Status '''
+    aa = cc.ApiClient()
+    return mclag_portchannel_oper_status(aa.get(mclag_portchannel_oper_status_path(po_name)))
+
 
 
 def mclag_get_ethernet_if_oper_status(if_name):
@@ -272,7 +286,7 @@ def mclag_get_remote_if_oper_status(if_name, remote_if_list):
 
     for list_item in remote_if_list:
         if list_item["if_name"] == if_name:
-            for k,v in list_item.iteritems():
+            for k,v in list_item.items():
                 if k == "oper_status":
                     if_oper_status = v
     return if_oper_status
@@ -281,7 +295,7 @@ def mclag_get_remote_if_oper_status(if_name, remote_if_list):
 #returns True or False and also returns value corresponding to the field
 def mclag_is_element_in_list(list_to_search, field):
     for list_item in list_to_search:
-        for  k,v  in list_item.iteritems():
+        for  k,v  in list_item.items():
             if (k == field):
                 return True
     return False
@@ -292,7 +306,7 @@ def mclag_convert_list_to_dict(list_to_converted, field = None, value = None):
     converted_dict = {}
     for  list_item in list_to_converted:
         if ((field is None) or list_item[field] == value):
-            for k, v in list_item.iteritems():
+            for k, v in list_item.items():
                 converted_dict[k] = v
     return converted_dict;
 
@@ -309,18 +323,26 @@ def mclag_get_mclag_intf_dict(local_if_list, remote_if_list):
     mclag_intf_dict = {}
     count = 0
 
-    for list_item in local_if_list:
-       for k,v in list_item.iteritems():
-           if k == "if_name":
-               mclag_intf_dict[v] = {}
-               if_local_status  = mclag_get_portchannel_oper_status(v)
-               if_remote_status = mclag_get_remote_if_oper_status(v, remote_if_list)
-               mclag_intf_dict[v]["local_if_status"] = if_local_status
-               mclag_intf_dict[v]["remote_if_status"] = if_remote_status
-               mclag_intf_dict[v]["if_name"] = v
-               mclag_intf_dict[v]["traffic_disable"] = mclag_get_portchannel_traffic_disable(v)
-               mclag_intf_dict[v]["port_isolate"]    = mclag_get_local_if_port_isolate(v)
-               count += 1
+    if_names = [list_item["if_name"] for list_item in local_if_list if "if_name" in list_item]
+
+    #The LAG and local interface states of all the interfaces are fetched together
+    paths = []
+    for if_name in if_names:
+        paths.append(mclag_portchannel_oper_status_path(if_name))
+        paths.append(mclag_portchannel_traffic_disable_path(if_name))
+        paths.append(mclag_local_if_port_isolate_path(if_name))
+    aa = cc.ApiClient()
+    responses = aa.get_many(paths)
+
+    for i, v in enumerate(if_names):
+        oper_status, traffic_disable, port_isolate = responses[3 * i:3 * i + 3]
+        mclag_intf_dict[v] = {}
+        mclag_intf_dict[v]["local_if_status"] = mclag_portchannel_oper_status(oper_status)
+        mclag_intf_dict[v]["remote_if_status"] = mclag_get_remote_if_oper_status(v, remote_if_list)
+        mclag_intf_dict[v]["if_name"] = v
+        mclag_intf_dict[v]["traffic_disable"] = mclag_portchannel_traffic_disable(traffic_disable)
+        mclag_intf_dict[v]["port_isolate"]    = mclag_local_if_port_isolate(port_isolate)
+        count += 1
     return count, mclag_intf_dict
 
 #show mclag interface command
@@ -351,8 +373,8 @@ def mclag_show_mclag_interface(args):
    
     else:
         #error response
-        print api_response
-        print api_response.error_message()
+        print(api_response)
+        print(api_response.error_message())
 
     return
 
@@ -406,8 +428,8 @@ def mclag_show_mclag_brief(args):
 
     else:
         #error response
-        print api_response
-        print api_response.error_message()
+        print(api_response)
+        print(api_response.error_message())
 
     return
 
@@ -425,7 +447,7 @@ def run(func, args):
             return
 
     except Exception as e:
-            print sys.exc_value
+            print(sys.exc_info()[1])
             return
 
 
@@ -462,7 +484,6 @@ def run(func, args):
     return
 
 if __name__ == '__main__':
-    pipestr().write(sys.argv)
     #pdb.set_trace()
     run(sys.argv[1], sys.argv[2:])
 
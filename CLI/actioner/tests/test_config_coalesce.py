@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+###########################################################################
+#
+# Copyright 2019 Dell, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###########################################################################
+
+"""
+Feeds interface config lines to clish with the cli-xml command tree
+and checks the PATCHes a local REST server gets. The server listens
+on /var/run/rest-local.sock, so it's skipped while the REST server
+runs. Needs the built clish and the Python modules of the actioners:
+
+  CLISH=build/cli/clish PYTHONPATH=build/cli:CLI/actioner:CLI/renderer \\
+      python3 -m unittest discover -s CLI/actioner/tests
+"""
+
+import http.server
+import json
+import os
+import shutil
+import socketserver
+import subprocess
+import tempfile
+import threading
+import unittest
+
+CLISH = os.environ.get("CLISH")
+REST_SOCKET = "/var/run/rest-local.sock"
+CLI_XML_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            '..', '..', 'clitree', 'cli-xml')
+INTF_PATH = "/restconf/data/openconfig-interfaces:interfaces/interface="
+
+
+class RestHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def address_string(self):
+        return "local"
+
+    def log_message(self, *args):
+        pass
+
+    def do_PATCH(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        self.server.requests.append((self.command, self.path, json.loads(body)))
+        # The server which dies on the request
+        if "Ethernet8" in self.path:
+            self.close_connection = True
+            return
+        if b"bad" in body:
+            error = json.dumps({"ietf-restconf:errors": {"error": [{
+                "error-type": "application",
+                "error-tag": "invalid-value",
+                "error-message": "Bad value"}]}}).encode()
+            self.send_response(400)
+            self.send_header("Content-Type", "application/yang-data+json")
+            self.send_header("Content-Length", str(len(error)))
+            self.end_headers()
+            self.wfile.write(error)
+            return
+        self.send_response(204)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+
+class RestServer(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+    daemon_threads = True
+
+
+@unittest.skipIf(not CLISH, "CLISH is not set to the built clish")
+@unittest.skipIf(os.path.exists(REST_SOCKET), "REST server is running")
+@unittest.skipIf(not os.access(os.path.dirname(REST_SOCKET), os.W_OK),
+                 "no access to " + os.path.dirname(REST_SOCKET))
+class ConfigCoalesceTest(unittest.TestCase):
+
+    def setUp(self):
+        self.server = RestServer(REST_SOCKET, RestHandler)
+        self.server.requests = []
+        threading.Thread(target=self.server.serve_forever, daemon=True).start()
+        self.tree = tempfile.mkdtemp()
+        shutil.copytree(CLI_XML_PATH, self.tree, dirs_exist_ok=True)
+
+    def tearDown(self):
+        self.server.shutdown()
+        self.server.server_close()
+        os.unlink(REST_SOCKET)
+        shutil.rmtree(self.tree)
+
+    def run_lines(self, *lines):
+        env = dict(os.environ, CLISH_NOAUTH="1", CLISH_REST_COALESCE="10000")
+        res = subprocess.run([CLISH, "-x", self.tree],
+                             input="\n".join(("configure terminal",) + lines) + "\n",
+                             stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             universal_newlines=True, env=env, timeout=60)
+        return res.stdout
+
+    def test_coalesced(self):
+        self.run_lines("interface Ethernet 0",
+                       "mtu 9000",
+                       "description uplink",
+                       "shutdown",
+                       "interface Ethernet 4",
+                       "mtu 9100",
+                       "no description",
+                       "no shutdown")
+        # The last line waits for the deferred ones and is sent alone
+        self.assertEqual(self.server.requests, [
+            ("PATCH", INTF_PATH + "Ethernet0/config",
+             {"config": {"mtu": 9000, "description": "uplink", "enabled": False}}),
+            ("PATCH", INTF_PATH + "Ethernet4/config",
+             {"config": {"mtu": 9100, "description": ""}}),
+            ("PATCH", INTF_PATH + "Ethernet4/config/enabled",
+             {"enabled": True}),
+        ])
+
+    def test_rejected_replayed(self):
+        output = self.run_lines("interface Ethernet 0",
+                                "mtu 9000",
+                                "description bad",
+                                "shutdown",
+                                "interface Ethernet 4")
+        self.assertEqual(self.server.requests, [
+            ("PATCH", INTF_PATH + "Ethernet0/config",
+             {"config": {"mtu": 9000, "description": "bad", "enabled": False}}),
+            ("PATCH", INTF_PATH + "Ethernet0/config/mtu", {"mtu": 9000}),
+            ("PATCH", INTF_PATH + "Ethernet0/config/description", {"description": "bad"}),
+            ("PATCH", INTF_PATH + "Ethernet0/config/enabled", {"enabled": False}),
+        ])
+        self.assertIn("% Error: Bad value (line 4: description bad)", output)
+        self.assertNotIn("line 3", output)
+        self.assertNotIn("line 5", output)
+
+    def test_unreachable_not_replayed(self):
+        output = self.run_lines("interface Ethernet 8",
+                                "mtu 9000",
+                                "shutdown",
+                                "interface Ethernet 4")
+        self.assertEqual(self.server.requests, [
+            ("PATCH", INTF_PATH + "Ethernet8/config",
+             {"config": {"mtu": 9000, "enabled": False}}),
+        ])
+        self.assertIn("(line 3: mtu 9000)", output)
+        self.assertIn("(line 4: shutdown)", output)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+###########################################################################
+#
+# Copyright 2019 Dell, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###########################################################################
+
+"""
+Checks the arguments clish_pyobj passes to the run() of the actioners:
+the tokens of the script text for run(func, args) and the parameters
+by name for run(func, args, **kwargs). Needs the built clish:
+
+  CLISH=build/cli/clish python3 -m unittest discover -s CLI/actioner/tests
+"""
+
+import json
+import os
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+CLISH = os.environ.get("CLISH")
+
+MANY_ARGS = " ".join("a%d" % i for i in range(200))
+
+# The script texts of the commands and the tokens run() gets
+TOKENS = [
+    ("f a  b   c", ["f", "a", "b", "c"]),
+    ('f "a b" c', ["f", "a b", "c"]),
+    ('f "" x', ["f", "", "x"]),
+    ('f x\\"y a\\\\b', ["f", 'x"y', "a\\b"]),
+    ('f \\"a b\\" c', ["f", '"a', 'b"', "c"]),
+    ('f \\"a"b c" d', ["f", 'a"b c', "d"]),
+    ('f "ab"cd e', ["f", "ab", "e"]),
+    ('f "abc', ["f", '"abc']),
+    ("f " + MANY_ARGS, ["f"] + MANY_ARGS.split()),
+]
+
+TREE = """<?xml version="1.0" encoding="UTF-8"?>
+<CLISH_MODULE xmlns="http://clish.sourceforge.net/XMLSchema">
+<PLUGIN name="clish"/>
+<PTYPE name="STRING" pattern=".+" help="String"/>
+<VIEW name="enable-view" prompt="# ">
+{commands}
+ <COMMAND name="kw" help="kw">
+  <PARAM name="value" help="Value" ptype="STRING"/>
+  <ACTION builtin="clish_pyobj">kwdump f ignored "text</ACTION>
+ </COMMAND>
+</VIEW>
+<STARTUP view="enable-view"/>
+</CLISH_MODULE>
+"""
+
+COMMAND = """ <COMMAND name="t{0}" help="t">
+  <ACTION builtin="clish_pyobj">argdump {1}</ACTION>
+ </COMMAND>"""
+
+ARGDUMP = """import json
+def run(func, args):
+    print(json.dumps([func] + args))
+"""
+
+KWDUMP = """import json
+def run(func, args, **kwargs):
+    print(json.dumps([func, args, kwargs]))
+"""
+
+
+def xml_text(text):
+    return text.replace("&", "&amp;").replace("<", "&lt;")
+
+
+@unittest.skipIf(not CLISH, "CLISH is not set to the built clish")
+class PyobjArgsTest(unittest.TestCase):
+
+    def setUp(self):
+        self.tree = tempfile.mkdtemp()
+        commands = "\n".join(COMMAND.format(i, xml_text(text))
+                             for i, (text, _) in enumerate(TOKENS))
+        with open(os.path.join(self.tree, "test.xml"), "w") as f:
+            f.write(TREE.format(commands=commands))
+        for name, code in (("argdump", ARGDUMP), ("kwdump", KWDUMP)):
+            with open(os.path.join(self.tree, name + ".py"), "w") as f:
+                f.write(code)
+
+    def tearDown(self):
+        shutil.rmtree(self.tree)
+
+    def run_lines(self, *lines):
+        path = [self.tree] + [p for p in [os.environ.get("PYTHONPATH")] if p]
+        env = dict(os.environ, CLISH_NOAUTH="1", PYTHONPATH=os.pathsep.join(path))
+        res = subprocess.run([CLISH, "-x", self.tree],
+                             input="\n".join(lines) + "\n",
+                             stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             universal_newlines=True, env=env, timeout=60)
+        return [json.loads(l) for l in res.stdout.splitlines() if l.startswith("[")]
+
+    def test_tokens(self):
+        output = self.run_lines(*("t%d" % i for i in range(len(TOKENS))))
+        self.assertEqual(output, [tokens for _, tokens in TOKENS])
+
+    def test_kwargs(self):
+        # The script text after the func isn't parsed
+        output = self.run_lines('kw "a \'b\' c"')
+        self.assertEqual(output, [["f", [], {"value": "a 'b' c", "__command__": "kw"}]])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -37,16 +37,55 @@
 #include "lub/system.h"
 #include "lub/log.h"
 #include "lub/conv.h"
+#include "lub/prof.h"
 #include "clish/shell.h"
+#include "session.h"
 
 #include <stdbool.h>
+#include <assert.h>
 
 #define QUOTE(t) #t
 /* #define version(v) printf("%s\n", QUOTE(v)) */
 #define version(v) printf("%s\n", v)
 
+/* Command line options */
+struct options {
+	const char *socket_path;
+	bool_t lockless;
+	bool_t stop_on_error;
+	bool_t interactive;
+	bool_t quiet;
+	bool_t utf8;
+	bool_t bit8;
+	bool_t log;
+	int log_facility;
+	bool_t dryrun;
+	bool_t dryrun_config;
+	bool_t canon_out;
+	const char *xml_path;
+	const char *view;
+	const char *viewid;
+	const char *xslt_file;
+	bool_t istimeout;
+	unsigned int timeout;
+	bool_t cmd; /* -c option */
+	lub_list_t *cmds; /* Commands defined by -c */
+	const char *histfile;
+	unsigned int histsize;
+	const char *daemon_path; /* Serve sessions, -D option */
+	const char *connect_path; /* Pass session to server, -C option */
+	bool_t profile; /* Profile startup phases, -P option */
+	const char *profile_path; /* JSON output of the startup profile */
+	int files; /* Index of the first script file */
+};
+
 static void sighandler(int signo);
 static void help(int status, const char *argv0);
+static struct options *opts_init(void);
+static void opts_free(struct options *opts);
+static int opts_parse(int argc, char *argv[], struct options *opts);
+static void profile_dump(struct options *opts);
+static int opt_differs(const char *first, const char *second);
 
 bool _nos_use_alt_name = false;
 
@@ -58,37 +97,16 @@ bool nos_use_alt_name() {
 int main(int argc, char **argv)
 {
 	int running;
+	int res;
 	int result = -1;
 	clish_shell_t *shell = NULL;
-
-	/* Command line options */
-	const char *socket_path = KONFD_SOCKET_PATH;
-	bool_t lockless = BOOL_FALSE;
-	bool_t stop_on_error = BOOL_FALSE;
-	bool_t interactive = BOOL_TRUE;
-	bool_t quiet = BOOL_FALSE;
-	bool_t utf8 = BOOL_FALSE;
-	bool_t bit8 = BOOL_FALSE;
-	bool_t log = BOOL_FALSE;
-	int log_facility = LOG_LOCAL0;
-	bool_t dryrun = BOOL_FALSE;
-	bool_t dryrun_config = BOOL_FALSE;
-	bool_t canon_out = BOOL_FALSE;
-	const char *xml_path = getenv("CLISH_PATH");
-	const char *view = getenv("CLISH_VIEW");
-	const char *viewid = getenv("CLISH_VIEWID");
-	const char *xslt_file = NULL;
+	struct options *opts = NULL;
 
 	FILE *outfd = stdout;
-	bool_t istimeout = BOOL_FALSE;
-	unsigned int timeout = 0;
-	bool_t cmd = BOOL_FALSE; /* -c option */
-	lub_list_t *cmds; /* Commands defined by -c */
 	lub_list_node_t *iter;
-	const char *histfile = "~/.clish_history";
 	char *histfile_expanded = NULL;
-	unsigned int histsize = 50;
 	clish_sym_t *sym = NULL;
+	int session = -1; /* Socket of the session served by template */
 
 	/* Signal vars */
 	struct sigaction sigpipe_act;
@@ -99,7 +117,315 @@ int main(int argc, char **argv)
         _nos_use_alt_name = (strcmp(mode, "standard") == 0);
     }
 
-	static const char *shortopts = "hvs:ledx:w:i:bqu8oO:kKt:c:f:z:p:";
+	/* Ignore SIGPIPE */
+	sigemptyset(&sigpipe_set);
+	sigaddset(&sigpipe_set, SIGPIPE);
+	sigpipe_act.sa_flags = 0;
+	sigpipe_act.sa_mask = sigpipe_set;
+	sigpipe_act.sa_handler = &sighandler;
+	sigaction(SIGPIPE, &sigpipe_act, NULL);
+
+#if HAVE_LOCALE_H
+	/* Set current locale */
+	setlocale(LC_ALL, "");
+#endif
+
+	/* Parse command line options */
+	opts = opts_init();
+	if (opts_parse(argc, argv, opts))
+		goto end;
+	if (opts->profile)
+		lub_prof_enable();
+
+	/* Validate command line options */
+	if (opts->utf8 && opts->bit8) {
+		fprintf(stderr, "Error: The -u and -8 options can't be used together.\n");
+		goto end;
+	}
+
+	/* Try the warm session server first. Start the local shell
+	   if the server is not available. */
+	if (opts->connect_path && !opts->daemon_path) {
+		result = clish_session_connect(opts->connect_path, argc, argv);
+		if (result >= 0)
+			goto end;
+	}
+
+	/* Create shell instance */
+	if (opts->daemon_path) {
+		/* The session decides on quiet mode. So use the separate
+		   descriptor to be replaced by forked session. */
+		int tmpfd = dup(fileno(stdout));
+		if (tmpfd >= 0)
+			outfd = fdopen(tmpfd, "w");
+		if (!outfd)
+			outfd = stdout;
+		/* The user specific part of plugins is initialized by
+		   forked session */
+		setenv("CLISHD_TEMPLATE", "1", 1);
+	} else if (opts->quiet) {
+		FILE *tmpfd = NULL;
+		if ((tmpfd = fopen("/dev/null", "w")))
+			outfd = tmpfd;
+	}
+	shell = clish_shell_new(NULL, outfd, opts->stop_on_error);
+	if (!shell) {
+		fprintf(stderr, "Error: Can't run clish.\n");
+		goto end;
+	}
+	/* Load the XML files */
+	clish_xmldoc_start();
+	lub_prof_begin("load scheme");
+	res = clish_shell_load_scheme(shell, opts->xml_path, opts->xslt_file);
+	lub_prof_end();
+	if (res)
+		goto end;
+	/* Set communication to the konfd */
+	clish_shell__set_socket(shell, opts->socket_path);
+	/* Set lockless mode */
+	if (opts->lockless)
+		clish_shell__set_lockfile(shell, NULL);
+	/* Set UTF-8 or 8-bit mode */
+	if (opts->utf8 || opts->bit8)
+		clish_shell__set_utf8(shell, opts->utf8);
+	else {
+#if HAVE_LANGINFO_CODESET
+		/* Autodetect encoding */
+		if (!strcmp(nl_langinfo(CODESET), "UTF-8"))
+			clish_shell__set_utf8(shell, BOOL_TRUE);
+#else
+		/* The default is 8-bit if locale is not supported */
+		clish_shell__set_utf8(shell, BOOL_FALSE);
+#endif
+	}
+	/* Set logging */
+	if (opts->log) {
+		clish_shell__set_log(shell, opts->log);
+		clish_shell__set_log_facility(shell, opts->log_facility);
+	}
+	/* Set dry-run */
+	if (opts->dryrun)
+		clish_shell__set_dryrun(shell, opts->dryrun);
+	/* Set canonical output */
+	if (opts->canon_out)
+		clish_shell__set_canon_out(shell, opts->canon_out);
+	/* Access rights are checked on behalf of the session user */
+	if (opts->daemon_path)
+		clish_shell__set_defer_access(shell, BOOL_TRUE);
+	/* Load plugins, link aliases and check access rights */
+	lub_prof_begin("prepare");
+	res = clish_shell_prepare(shell);
+	lub_prof_end();
+	if (res < 0)
+		goto end;
+	/* Dryrun config and log hooks */
+	if (opts->dryrun_config) {
+		if ((sym = clish_shell_get_hook(shell, CLISH_SYM_TYPE_CONFIG)))
+			clish_sym__set_permanent(sym, BOOL_FALSE);
+		if ((sym = clish_shell_get_hook(shell, CLISH_SYM_TYPE_LOG)))
+			clish_sym__set_permanent(sym, BOOL_FALSE);
+	}
+
+	/* The template is ready. Fork it for each session. */
+	if (opts->daemon_path) {
+		int session_argc = 0;
+		char **session_argv = NULL;
+		int tmpfd = -1;
+		const char *xml_path = opts->xml_path;
+		const char *xslt_file = opts->xslt_file;
+		bool_t lockless = opts->lockless;
+
+		session = clish_session_serve(opts->daemon_path, shell,
+			&session_argc, &session_argv);
+		if (session < 0)
+			goto end;
+		/* Session process. It gets session specific options. */
+		opts_free(opts);
+		opts = opts_init();
+		/* The schema is shared by all sessions. The client starts
+		   the local shell if the session asks for other schema. */
+		if (opts_parse(session_argc, session_argv, opts) ||
+			opt_differs(xml_path, opts->xml_path) ||
+			opt_differs(xslt_file, opts->xslt_file) ||
+			clish_session_accept(session)) {
+			close(session);
+			session = -1;
+			goto end;
+		}
+		argc = session_argc;
+		argv = session_argv;
+		if (opts->quiet)
+			tmpfd = open("/dev/null", O_WRONLY);
+		else
+			tmpfd = dup(fileno(stdout));
+		if (tmpfd >= 0) {
+			fflush(outfd);
+			dup2(tmpfd, fileno(outfd));
+			close(tmpfd);
+		}
+		/* The access rights are checked by the session server */
+		clish_shell_attach_session(shell);
+		/* The rest of the template options are overridden */
+		clish_shell__set_socket(shell, opts->socket_path);
+		if (opts->lockless && !lockless)
+			clish_shell__set_lockfile(shell, NULL);
+		if (opts->utf8 || opts->bit8)
+			clish_shell__set_utf8(shell, opts->utf8);
+		clish_shell__set_log(shell, opts->log);
+		clish_shell__set_log_facility(shell, opts->log_facility);
+		clish_shell__set_dryrun(shell, opts->dryrun);
+		clish_shell__set_canon_out(shell, opts->canon_out);
+		if (opts->dryrun_config) {
+			if ((sym = clish_shell_get_hook(shell, CLISH_SYM_TYPE_CONFIG)))
+				clish_sym__set_permanent(sym, BOOL_FALSE);
+			if ((sym = clish_shell_get_hook(shell, CLISH_SYM_TYPE_LOG)))
+				clish_sym__set_permanent(sym, BOOL_FALSE);
+		}
+	}
+
+	/* Set interactive mode */
+	if (!opts->interactive)
+		clish_shell__set_interactive(shell, opts->interactive);
+	/* Set startup view */
+	if (opts->view)
+		clish_shell__set_startup_view(shell, opts->view);
+	/* Set startup viewid */
+	if (opts->viewid)
+		clish_shell__set_startup_viewid(shell, opts->viewid);
+	/* Set idle timeout */
+	if (opts->istimeout)
+		clish_shell__set_timeout(shell, opts->timeout);
+	/* Set history settings */
+	clish_shell__stifle_history(shell, opts->histsize);
+	if (opts->histfile)
+		histfile_expanded = lub_system_tilde_expand(opts->histfile);
+	if (histfile_expanded) {
+		lub_prof_begin("history");
+		clish_shell__restore_history(shell, histfile_expanded);
+		lub_prof_end();
+	}
+#ifdef DEBUG
+	clish_shell_dump(shell);
+#endif
+
+	/* Set source of command stream: files or interactive tty */
+	if (opts->files < argc) {
+		int i;
+		/* Run the commands from the files */
+		for (i = argc - 1; i >= opts->files; i--)
+			clish_shell_push_file(shell, argv[i], opts->stop_on_error);
+	} else {
+		/* The interactive shell */
+		int tmpfd = dup(fileno(stdin));
+#ifdef FD_CLOEXEC
+		fcntl(tmpfd, F_SETFD, fcntl(tmpfd, F_GETFD) | FD_CLOEXEC);
+#endif
+		clish_shell_push_fd(shell, fdopen(tmpfd, "r"), opts->stop_on_error);
+	}
+
+	/* Execute startup */
+	lub_prof_begin("startup");
+	running = clish_shell_startup(shell);
+	lub_prof_end();
+	if (running) {
+		fprintf(stderr, "Error: Can't startup clish.\n");
+		goto end;
+	}
+	profile_dump(opts);
+
+	if (opts->cmd) {
+		/* Iterate cmds */
+		for(iter = lub_list__get_head(opts->cmds);
+			iter; iter = lub_list_node__get_next(iter)) {
+			char *str = (char *)lub_list_node__get_data(iter);
+			result = clish_shell_forceline(shell, str, NULL);
+			if (opts->stop_on_error && result)
+				break;
+		}
+	} else {
+		/* Main loop */
+		result = clish_shell_loop(shell);
+	}
+
+end:
+	/* Cleanup */
+	if (shell) {
+		if (histfile_expanded) {
+			clish_shell__save_history(shell, histfile_expanded);
+			free(histfile_expanded);
+		}
+		clish_shell_delete(shell);
+	}
+	if (outfd != stdout)
+		fclose(outfd);
+
+	/* Report the result to the client */
+	if (session >= 0)
+		clish_session_finish(session, result);
+
+	/* Free command line options */
+	if (opts)
+		opts_free(opts);
+
+	/* Stop XML engine */
+	clish_xmldoc_stop();
+
+	return result;
+}
+
+/*--------------------------------------------------------- */
+/* Initialize option structure by defaults */
+static struct options *opts_init(void)
+{
+	struct options *opts = NULL;
+
+	opts = malloc(sizeof(*opts));
+	assert(opts);
+	opts->socket_path = KONFD_SOCKET_PATH;
+	opts->lockless = BOOL_FALSE;
+	opts->stop_on_error = BOOL_FALSE;
+	opts->interactive = BOOL_TRUE;
+	opts->quiet = BOOL_FALSE;
+	opts->utf8 = BOOL_FALSE;
+	opts->bit8 = BOOL_FALSE;
+	opts->log = BOOL_FALSE;
+	opts->log_facility = LOG_LOCAL0;
+	opts->dryrun = BOOL_FALSE;
+	opts->dryrun_config = BOOL_FALSE;
+	opts->canon_out = BOOL_FALSE;
+	opts->xml_path = getenv("CLISH_PATH");
+	opts->view = getenv("CLISH_VIEW");
+	opts->viewid = getenv("CLISH_VIEWID");
+	opts->xslt_file = NULL;
+	opts->istimeout = BOOL_FALSE;
+	opts->timeout = 0;
+	opts->cmd = BOOL_FALSE;
+	opts->cmds = lub_list_new(NULL, free);
+	opts->histfile = "~/.clish_history";
+	opts->histsize = 50;
+	opts->daemon_path = NULL;
+	opts->connect_path = NULL;
+	opts->profile = BOOL_FALSE;
+	opts->profile_path = NULL;
+	opts->files = 0;
+
+	return opts;
+}
+
+/*--------------------------------------------------------- */
+/* Free option structure */
+static void opts_free(struct options *opts)
+{
+	/* Delete each cmds element */
+	lub_list_free_all(opts->cmds);
+	free(opts);
+}
+
+/*--------------------------------------------------------- */
+/* Parse command line options */
+static int opts_parse(int argc, char *argv[], struct options *opts)
+{
+	static const char *shortopts = "hvs:ledx:w:i:bqu8oO:kKt:c:f:z:p:D:C:P::";
 #ifdef HAVE_GETOPT_LONG
 	static const struct option longopts[] = {
 		{"help",	0, NULL, 'h'},
@@ -124,27 +450,13 @@ int main(int argc, char **argv)
 		{"histfile",	1, NULL, 'f'},
 		{"histsize",	1, NULL, 'z'},
 		{"xslt",	1, NULL, 'p'},
+		{"daemon",	1, NULL, 'D'},
+		{"connect",	1, NULL, 'C'},
+		{"profile-startup", 2, NULL, 'P'},
 		{NULL,		0, NULL, 0}
 	};
 #endif
-
-	/* Ignore SIGPIPE */
-	sigemptyset(&sigpipe_set);
-	sigaddset(&sigpipe_set, SIGPIPE);
-	sigpipe_act.sa_flags = 0;
-	sigpipe_act.sa_mask = sigpipe_set;
-	sigpipe_act.sa_handler = &sighandler;
-	sigaction(SIGPIPE, &sigpipe_act, NULL);
-
-#if HAVE_LOCALE_H
-	/* Set current locale */
-	setlocale(LC_ALL, "");
-#endif
-
-	/* Var initialization */
-	cmds = lub_list_new(NULL, free);
-
-	/* Parse command line options */
+	optind = 1;
 	while(1) {
 		int opt;
 #ifdef HAVE_GETOPT_LONG
@@ -156,91 +468,101 @@ int main(int argc, char **argv)
 			break;
 		switch (opt) {
 		case 's':
-			socket_path = optarg;
+			opts->socket_path = optarg;
 			break;
 		case 'l':
-			lockless = BOOL_TRUE;
+			opts->lockless = BOOL_TRUE;
 			break;
 		case 'e':
-			stop_on_error = BOOL_TRUE;
+			opts->stop_on_error = BOOL_TRUE;
 			break;
 		case 'b':
-			interactive = BOOL_FALSE;
+			opts->interactive = BOOL_FALSE;
 			break;
 		case 'q':
-			quiet = BOOL_TRUE;
+			opts->quiet = BOOL_TRUE;
 			break;
 		case 'u':
-			utf8 = BOOL_TRUE;
+			opts->utf8 = BOOL_TRUE;
 			break;
 		case '8':
-			bit8 = BOOL_TRUE;
+			opts->bit8 = BOOL_TRUE;
 			break;
 		case 'o':
-			log = BOOL_TRUE;
+			opts->log = BOOL_TRUE;
 			break;
 		case 'O':
-			if (lub_log_facility(optarg, &log_facility)) {
+			if (lub_log_facility(optarg, &opts->log_facility)) {
 				fprintf(stderr, "Error: Illegal syslog facility %s.\n", optarg);
 				help(-1, argv[0]);
-				goto end;
+				return -1;
 			}
 			break;
 		case 'd':
-			dryrun = BOOL_TRUE;
+			opts->dryrun = BOOL_TRUE;
 			break;
 		case 'x':
-			xml_path = optarg;
+			opts->xml_path = optarg;
 			break;
 		case 'w':
-			view = optarg;
+			opts->view = optarg;
 			break;
 		case 'i':
-			viewid = optarg;
+			opts->viewid = optarg;
 			break;
 		case 'k':
-			lockless = BOOL_TRUE;
-			dryrun = BOOL_TRUE;
-			dryrun_config = BOOL_TRUE;
+			opts->lockless = BOOL_TRUE;
+			opts->dryrun = BOOL_TRUE;
+			opts->dryrun_config = BOOL_TRUE;
 			break;
 		case 'K':
-			lockless = BOOL_TRUE;
-			dryrun = BOOL_TRUE;
-			dryrun_config = BOOL_TRUE;
-			canon_out = BOOL_TRUE;
+			opts->lockless = BOOL_TRUE;
+			opts->dryrun = BOOL_TRUE;
+			opts->dryrun_config = BOOL_TRUE;
+			opts->canon_out = BOOL_TRUE;
 			break;
 		case 't':
-			istimeout = BOOL_TRUE;
-			timeout = 0;
-			lub_conv_atoui(optarg, &timeout, 0);
+			opts->istimeout = BOOL_TRUE;
+			opts->timeout = 0;
+			lub_conv_atoui(optarg, &opts->timeout, 0);
 			break;
 		case 'c': {
 			char *str;
-			cmd = BOOL_TRUE;
-			quiet = BOOL_TRUE;
+			opts->cmd = BOOL_TRUE;
+			opts->quiet = BOOL_TRUE;
 			str = strdup(optarg);
-			lub_list_add(cmds, str);
+			lub_list_add(opts->cmds, str);
 			}
 			break;
 		case 'f':
 			if (!strcmp(optarg, "/dev/null"))
-				histfile = NULL;
+				opts->histfile = NULL;
 			else
-				histfile = optarg;
+				opts->histfile = optarg;
 			break;
 		case 'z': {
-			histsize = 0;
-			lub_conv_atoui(optarg, &histsize, 0);
+			opts->histsize = 0;
+			lub_conv_atoui(optarg, &opts->histsize, 0);
 			}
 			break;
 		case 'p':
 #ifdef HAVE_LIB_LIBXSLT
-			xslt_file = optarg;
+			opts->xslt_file = optarg;
 #else
 			fprintf(stderr, "Error: The klish was built without XSLT support.\n");
-			goto end;
+			return -1;
 #endif
 			break;
+		case 'D':
+			opts->daemon_path = optarg;
+			break;
+		case 'C':
+			opts->connect_path = optarg;
+			break;
+		case 'P':
+			opts->profile = BOOL_TRUE;
+			opts->profile_path = optarg;
+			break;
 		case 'h':
 			help(0, argv[0]);
 			exit(0);
@@ -251,148 +573,42 @@ int main(int argc, char **argv)
 			break;
 		default:
 			help(-1, argv[0]);
-			goto end;
+			return -1;
 			break;
 		}
 	}
+	opts->files = optind;
 
-	/* Validate command line options */
-	if (utf8 && bit8) {
-		fprintf(stderr, "Error: The -u and -8 options can't be used together.\n");
-		goto end;
-	}
-
-	/* Create shell instance */
-	if (quiet) {
-		FILE *tmpfd = NULL;
-		if ((tmpfd = fopen("/dev/null", "w")))
-			outfd = tmpfd;
-	}
-	shell = clish_shell_new(NULL, outfd, stop_on_error);
-	if (!shell) {
-		fprintf(stderr, "Error: Can't run clish.\n");
-		goto end;
-	}
-	/* Load the XML files */
-	clish_xmldoc_start();
-	if (clish_shell_load_scheme(shell, xml_path, xslt_file))
-		goto end;
-	/* Set communication to the konfd */
-	clish_shell__set_socket(shell, socket_path);
-	/* Set lockless mode */
-	if (lockless)
-		clish_shell__set_lockfile(shell, NULL);
-	/* Set interactive mode */
-	if (!interactive)
-		clish_shell__set_interactive(shell, interactive);
-	/* Set startup view */
-	if (view)
-		clish_shell__set_startup_view(shell, view);
-	/* Set startup viewid */
-	if (viewid)
-		clish_shell__set_startup_viewid(shell, viewid);
-	/* Set UTF-8 or 8-bit mode */
-	if (utf8 || bit8)
-		clish_shell__set_utf8(shell, utf8);
-	else {
-#if HAVE_LANGINFO_CODESET
-		/* Autodetect encoding */
-		if (!strcmp(nl_langinfo(CODESET), "UTF-8"))
-			clish_shell__set_utf8(shell, BOOL_TRUE);
-#else
-		/* The default is 8-bit if locale is not supported */
-		clish_shell__set_utf8(shell, BOOL_FALSE);
-#endif
-	}
-	/* Set logging */
-	if (log) {
-		clish_shell__set_log(shell, log);
-		clish_shell__set_log_facility(shell, log_facility);
-	}
-	/* Set dry-run */
-	if (dryrun)
-		clish_shell__set_dryrun(shell, dryrun);
-	/* Set canonical output */
-	if (canon_out)
-		clish_shell__set_canon_out(shell, canon_out);
-	/* Set idle timeout */
-	if (istimeout)
-		clish_shell__set_timeout(shell, timeout);
-	/* Set history settings */
-	clish_shell__stifle_history(shell, histsize);
-	if (histfile)
-		histfile_expanded = lub_system_tilde_expand(histfile);
-	if (histfile_expanded)
-		clish_shell__restore_history(shell, histfile_expanded);
-	/* Load plugins, link aliases and check access rights */
-	if (clish_shell_prepare(shell) < 0)
-		goto end;
-	/* Dryrun config and log hooks */
-	if (dryrun_config) {
-		if ((sym = clish_shell_get_hook(shell, CLISH_SYM_TYPE_CONFIG)))
-			clish_sym__set_permanent(sym, BOOL_FALSE);
-		if ((sym = clish_shell_get_hook(shell, CLISH_SYM_TYPE_LOG)))
-			clish_sym__set_permanent(sym, BOOL_FALSE);
-	}
-#ifdef DEBUG
-	clish_shell_dump(shell);
-#endif
-
-	/* Set source of command stream: files or interactive tty */
-	if(optind < argc) {
-		int i;
-		/* Run the commands from the files */
-		for (i = argc - 1; i >= optind; i--)
-			clish_shell_push_file(shell, argv[i], stop_on_error);
-	} else {
-		/* The interactive shell */
-		int tmpfd = dup(fileno(stdin));
-#ifdef FD_CLOEXEC
-		fcntl(tmpfd, F_SETFD, fcntl(tmpfd, F_GETFD) | FD_CLOEXEC);
-#endif
-		clish_shell_push_fd(shell, fdopen(tmpfd, "r"), stop_on_error);
-	}
+	return 0;
+}
 
-	/* Execute startup */
-	running = clish_shell_startup(shell);
-	if (running) {
-		fprintf(stderr, "Error: Can't startup clish.\n");
-		goto end;
-	}
+/*--------------------------------------------------------- */
+/* Print the startup profile and stop profiling */
+static void profile_dump(struct options *opts)
+{
+	FILE *out;
 
-	if (cmd) {
-		/* Iterate cmds */
-		for(iter = lub_list__get_head(cmds);
-			iter; iter = lub_list_node__get_next(iter)) {
-			char *str = (char *)lub_list_node__get_data(iter);
-			result = clish_shell_forceline(shell, str, NULL);
-			if (stop_on_error && result)
-				break;
-		}
+	if (!lub_prof_enabled())
+		return;
+	if (!opts->profile_path) {
+		lub_prof_dump(stderr, BOOL_FALSE);
+	} else if ((out = fopen(opts->profile_path, "w"))) {
+		lub_prof_dump(out, BOOL_TRUE);
+		fclose(out);
 	} else {
-		/* Main loop */
-		result = clish_shell_loop(shell);
+		fprintf(stderr, "Warning: Can't write startup profile to %s\n",
+			opts->profile_path);
 	}
+	lub_prof_free();
+}
 
-end:
-	/* Cleanup */
-	if (shell) {
-		if (histfile_expanded) {
-			clish_shell__save_history(shell, histfile_expanded);
-			free(histfile_expanded);
-		}
-		clish_shell_delete(shell);
-	}
-	if (quiet && (outfd != stdout))
-		fclose(outfd);
-
-	/* Delete each cmds element */
-	lub_list_free_all(cmds);
-
-	/* Stop XML engine */
-	clish_xmldoc_stop();
-
-	return result;
+/*--------------------------------------------------------- */
+/* Compare the optional string options */
+static int opt_differs(const char *first, const char *second)
+{
+	if (!first || !second)
+		return (first != second);
+	return strcmp(first, second);
 }
 
 /*--------------------------------------------------------- */
@@ -444,6 +660,9 @@ static void help(int status, const char *argv0)
 		printf("\t-c <command>, --command=<command>\tExecute specified command(s).\n\t\tMultiple options are possible.\n");
 		printf("\t-f <path>, --histfile=<path>\tFile to save command history.\n");
 		printf("\t-z <num>, --histsize=<num>\tCommand history size in lines.\n");
+		printf("\t-D <path>, --daemon=<path>\tServe the sessions on the UNIX socket\n\t\tby forking the prepared shell.\n");
+		printf("\t-C <path>, --connect=<path>\tPass the session to the server.\n\t\tStart the local shell if server is not available\n\t\tor the -x, -p options differ from the server ones.\n");
+		printf("\t-P[<path>], --profile-startup[=<path>]\tMeasure the startup phases.\n\t\tPrint table to stderr or save JSON to the file.\n");
 	}
 }
 
@@ -0,0 +1,811 @@
+/*
+ * session.c
+ *
+ * The clish session server keeps the prepared shell (loaded schema,
+ * plugins, embedded interpreter) in the template process and forks
+ * it for every incoming session. The client passes its terminal
+ * descriptors, arguments and environment over the UNIX socket. The
+ * forked process takes over the credentials of the client and
+ * continues as a regular clish.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* struct ucred */
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <errno.h>
+#include <signal.h>
+#include <syslog.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#include "lub/db.h"
+#include "clish/shell.h"
+#include "session.h"
+
+/* UNIX socket path */
+/* Don't use UNIX_PATH_MAX due to portability issues */
+#define USOCK_PATH_MAX sizeof(((struct sockaddr_un *)0)->sun_path)
+
+/* stdin, stdout and stderr of the client */
+#define SESSION_FDS 3
+/* Limit for arguments and environment of the client */
+#define SESSION_PAYLOAD_MAX (256 * 1024)
+/* The client must pass the session within this time (seconds) */
+#define SESSION_RECV_TIMEOUT 10
+
+/* The payload is the NUL-separated list of strings: current
+ * directory, argc arguments and envc environment variables.
+ */
+typedef struct {
+	uint32_t argc;
+	uint32_t envc;
+	uint32_t len;
+} session_hdr_t;
+
+/* Number of the group sets to keep the pruned templates for */
+#define SESSION_TMPL_MAX 16
+
+/* The template with access rights checked for the group set */
+typedef struct {
+	gid_t *gids; /* Sorted group set */
+	int ngids;
+	int ctl; /* Socket to pass the sessions to template */
+	unsigned long used; /* The least recently used is replaced */
+} session_tmpl_t;
+
+extern char **environ;
+
+static session_tmpl_t session_tmpls[SESSION_TMPL_MAX];
+
+/* Process group of the forked session */
+static volatile pid_t session_pgid = -1;
+
+/*--------------------------------------------------------- */
+/* The terminal belongs to the client, so the keyboard generated
+ * signals come here. Pass them to the session.
+ */
+static void session_sighandler(int signo)
+{
+	if (session_pgid > 0)
+		kill(-session_pgid, signo);
+}
+
+/*--------------------------------------------------------- */
+static int session_read(int sock, void *buf, size_t len)
+{
+	char *p = buf;
+
+	while (len > 0) {
+		ssize_t n = read(sock, p, len);
+		if (n < 0 && EINTR == errno)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*--------------------------------------------------------- */
+static int session_write(int sock, const void *buf, size_t len)
+{
+	const char *p = buf;
+
+	while (len > 0) {
+		ssize_t n = write(sock, p, len);
+		if (n < 0 && EINTR == errno)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*--------------------------------------------------------- */
+static char *session_pack(int argc, char **argv, session_hdr_t *hdr)
+{
+	char cwd[PATH_MAX];
+	char *payload, *p;
+	size_t len;
+	int i;
+
+	if (!getcwd(cwd, sizeof(cwd)))
+		strcpy(cwd, "/");
+
+	len = strlen(cwd) + 1;
+	for (i = 0; i < argc; i++)
+		len += strlen(argv[i]) + 1;
+	hdr->envc = 0;
+	for (i = 0; environ[i]; i++) {
+		len += strlen(environ[i]) + 1;
+		hdr->envc++;
+	}
+	if (len > SESSION_PAYLOAD_MAX)
+		return NULL;
+	hdr->argc = argc;
+	hdr->len = len;
+
+	payload = malloc(len);
+	if (!payload)
+		return NULL;
+	p = stpcpy(payload, cwd) + 1;
+	for (i = 0; i < argc; i++)
+		p = stpcpy(p, argv[i]) + 1;
+	for (i = 0; environ[i]; i++)
+		p = stpcpy(p, environ[i]) + 1;
+
+	return payload;
+}
+
+/*--------------------------------------------------------- */
+/* Pass the session to the server. Returns the exit status of the
+ * session or -1 if server is unavailable and the local shell must
+ * be started instead.
+ */
+int clish_session_connect(const char *path, int argc, char **argv)
+{
+	int sock;
+	struct sockaddr_un laddr;
+	session_hdr_t hdr;
+	char *payload;
+	struct msghdr msg;
+	struct iovec iov[2];
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int) * SESSION_FDS)];
+	} cmsgbuf;
+	struct cmsghdr *cmsg;
+	int fds[SESSION_FDS] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+	int32_t pid, result;
+	struct sigaction sig_act;
+	int res;
+
+	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		return -1;
+	memset(&laddr, 0, sizeof(laddr));
+	laddr.sun_family = AF_UNIX;
+	strncpy(laddr.sun_path, path, USOCK_PATH_MAX);
+	laddr.sun_path[USOCK_PATH_MAX - 1] = '\0';
+	if (connect(sock, (struct sockaddr *)&laddr, sizeof(laddr))) {
+		close(sock);
+		return -1;
+	}
+
+	if (!(payload = session_pack(argc, argv, &hdr))) {
+		close(sock);
+		return -1;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = payload;
+	iov[1].iov_len = hdr.len;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+	memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	/* The server reads the rest of the payload if sendmsg()
+	   is short */
+	do {
+		res = sendmsg(sock, &msg, MSG_NOSIGNAL);
+	} while (res < 0 && EINTR == errno);
+	if ((res < 0) || ((res < (int)(sizeof(hdr) + hdr.len)) &&
+		((res < (int)sizeof(hdr)) || session_write(sock,
+		payload + (res - sizeof(hdr)),
+		hdr.len - (res - sizeof(hdr)))))) {
+		free(payload);
+		close(sock);
+		return -1;
+	}
+	free(payload);
+
+	/* Nothing is printed yet if the session can't be started */
+	if (session_read(sock, &pid, sizeof(pid))) {
+		close(sock);
+		return -1;
+	}
+	session_pgid = pid;
+
+	sigemptyset(&sig_act.sa_mask);
+	sig_act.sa_flags = SA_RESTART;
+	sig_act.sa_handler = session_sighandler;
+	sigaction(SIGINT, &sig_act, NULL);
+	sigaction(SIGQUIT, &sig_act, NULL);
+	sigaction(SIGTERM, &sig_act, NULL);
+	sigaction(SIGHUP, &sig_act, NULL);
+	sig_act.sa_handler = SIG_IGN;
+	sigaction(SIGTSTP, &sig_act, NULL);
+
+	/* Connection is closed without result if session crashed */
+	if (session_read(sock, &result, sizeof(result)))
+		result = 1;
+	close(sock);
+
+	return result & 0xff;
+}
+
+/*--------------------------------------------------------- */
+static int session_listen(const char *path)
+{
+	int sock;
+	struct sockaddr_un laddr;
+	const int reuseaddr = 1;
+
+	unlink(path);
+	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		syslog(LOG_ERR, "Can't create socket: %s\n", strerror(errno));
+		return -1;
+	}
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR,
+		&reuseaddr, sizeof(reuseaddr))) {
+		syslog(LOG_ERR, "Can't set socket options: %s\n", strerror(errno));
+		close(sock);
+		return -1;
+	}
+	memset(&laddr, 0, sizeof(laddr));
+	laddr.sun_family = AF_UNIX;
+	strncpy(laddr.sun_path, path, USOCK_PATH_MAX);
+	laddr.sun_path[USOCK_PATH_MAX - 1] = '\0';
+	if (bind(sock, (struct sockaddr *)&laddr, sizeof(laddr))) {
+		syslog(LOG_ERR, "Can't bind socket: %s\n", strerror(errno));
+		close(sock);
+		return -1;
+	}
+	/* Every user can connect. The session gets the credentials
+	   of the peer so nobody gets more rights than they have. */
+	if (chmod(path, 0666)) {
+		syslog(LOG_ERR, "Can't chmod socket: %s\n", strerror(errno));
+		close(sock);
+		return -1;
+	}
+	if (listen(sock, 16)) {
+		syslog(LOG_ERR, "Can't listen socket: %s\n", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+/*--------------------------------------------------------- */
+/* Take the descriptors of the SCM_RIGHTS messages. All of them are
+ * closed if the peer passed a wrong number of descriptors.
+ */
+static int session_recv_fds(struct msghdr *msg, int *fds, int expected)
+{
+	struct cmsghdr *cmsg;
+	int num = 0;
+	int bad = (msg->msg_flags & MSG_CTRUNC) ? 1 : 0;
+	int i;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		size_t n;
+		if ((cmsg->cmsg_level != SOL_SOCKET) ||
+			(cmsg->cmsg_type != SCM_RIGHTS))
+			continue;
+		n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (i = 0; i < (int)n; i++) {
+			int fd;
+			memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(fd));
+			if (num < expected)
+				fds[num++] = fd;
+			else {
+				close(fd);
+				bad = 1;
+			}
+		}
+	}
+	if (!bad && (expected == num))
+		return 0;
+
+	for (i = 0; i < num; i++)
+		close(fds[i]);
+	return -1;
+}
+
+/*--------------------------------------------------------- */
+static int session_recv(int sock, int *fds, session_hdr_t *hdr,
+	char **payload)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int) * SESSION_FDS)];
+	} cmsgbuf;
+	uint32_t num = 0;
+	uint32_t i;
+	ssize_t res;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = hdr;
+	iov.iov_len = sizeof(*hdr);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	do {
+		res = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+	} while (res < 0 && EINTR == errno);
+	if (res <= 0)
+		return -1;
+	if (session_recv_fds(&msg, fds, SESSION_FDS) < 0)
+		return -1;
+
+	if ((res < (ssize_t)sizeof(*hdr)) &&
+		session_read(sock, (char *)hdr + res, sizeof(*hdr) - res))
+		goto error;
+	if ((hdr->len == 0) || (hdr->len > SESSION_PAYLOAD_MAX))
+		goto error;
+	if (!(*payload = malloc(hdr->len)))
+		goto error;
+	if (session_read(sock, *payload, hdr->len) ||
+		((*payload)[hdr->len - 1] != '\0')) {
+		free(*payload);
+		goto error;
+	}
+
+	/* Check the number of strings */
+	for (i = 0; i < hdr->len; i++)
+		if ((*payload)[i] == '\0')
+			num++;
+	if ((hdr->argc < 1) || (num != 1 + hdr->argc + hdr->envc)) {
+		free(*payload);
+		goto error;
+	}
+
+	return 0;
+
+error:
+	for (i = 0; i < SESSION_FDS; i++)
+		close(fds[i]);
+	return -1;
+}
+
+/*--------------------------------------------------------- */
+/* Become the client: take over its terminal, credentials, current
+ * directory and environment.
+ */
+static int session_setup(int sock, int *fds, session_hdr_t *hdr,
+	char *payload, int *argc, char ***argv)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	const char *cwd;
+	char *p;
+	uint32_t i;
+
+	if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len)) {
+		syslog(LOG_ERR, "Can't get peer credentials: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* The keyboard signals are passed to the group by client */
+	setsid();
+	for (i = 0; i < SESSION_FDS; i++) {
+		if (dup2(fds[i], i) < 0)
+			return -1;
+		if (fds[i] >= SESSION_FDS)
+			close(fds[i]);
+	}
+
+	/* The supplementary groups are set by the pruned template */
+	if (cred.uid != geteuid()) {
+		if (setgid(cred.gid) || setuid(cred.uid)) {
+			syslog(LOG_ERR, "Can't set credentials of user %u: %s\n",
+				cred.uid, strerror(errno));
+			return -1;
+		}
+	}
+
+	/* The payload strings are never freed. The putenv() keeps
+	   the references. */
+	cwd = payload;
+	p = payload + strlen(payload) + 1;
+	*argc = hdr->argc;
+	*argv = malloc((hdr->argc + 1) * sizeof(char *));
+	if (!*argv)
+		return -1;
+	for (i = 0; i < hdr->argc; i++) {
+		(*argv)[i] = p;
+		p += strlen(p) + 1;
+	}
+	(*argv)[hdr->argc] = NULL;
+	clearenv();
+	for (i = 0; i < hdr->envc; i++) {
+		putenv(p);
+		p += strlen(p) + 1;
+	}
+	if (chdir(cwd) < 0)
+		syslog(LOG_WARNING, "Can't change directory to %s\n", cwd);
+
+	return 0;
+}
+
+/*--------------------------------------------------------- */
+/* Receive the session within the forked process. The server loop
+ * doesn't wait for the client, so the silent client can't stall
+ * the other logins.
+ */
+static int session_start(int sock, int *argc, char ***argv)
+{
+	struct timeval tv = {SESSION_RECV_TIMEOUT, 0};
+	struct timeval notv = {0, 0};
+	int fds[SESSION_FDS];
+	session_hdr_t hdr;
+	char *payload = NULL;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)))
+		return -1;
+	if (session_recv(sock, fds, &hdr, &payload) < 0)
+		return -1;
+	if (session_setup(sock, fds, &hdr, payload, argc, argv) < 0)
+		return -1;
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &notv, sizeof(notv));
+
+	return 0;
+}
+
+/*--------------------------------------------------------- */
+/* Get the sorted group set of the peer. The group set is the key
+ * of the pruned template.
+ */
+static gid_t *session_peer_groups(int sock, int *ngids)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	struct passwd *pw;
+	gid_t *gids;
+	int num = 0;
+	int i, j;
+
+	if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len)) {
+		syslog(LOG_ERR, "Can't get peer credentials: %s\n", strerror(errno));
+		return NULL;
+	}
+	if (!(pw = lub_db_getpwuid(cred.uid))) {
+		syslog(LOG_ERR, "Unknown user %u\n", cred.uid);
+		return NULL;
+	}
+	getgrouplist(pw->pw_name, cred.gid, NULL, &num);
+	gids = malloc(sizeof(*gids) * (num + 1));
+	if (gids && (getgrouplist(pw->pw_name, cred.gid, gids, &num) < 0)) {
+		free(gids);
+		gids = NULL;
+	}
+	free(pw);
+	if (!gids)
+		return NULL;
+
+	for (i = 1; i < num; i++) {
+		gid_t gid = gids[i];
+		for (j = i; (j > 0) && (gids[j - 1] > gid); j--)
+			gids[j] = gids[j - 1];
+		gids[j] = gid;
+	}
+	*ngids = num;
+
+	return gids;
+}
+
+/*--------------------------------------------------------- */
+static session_tmpl_t *session_tmpl_find(const gid_t *gids, int ngids)
+{
+	int i;
+
+	for (i = 0; i < SESSION_TMPL_MAX; i++) {
+		session_tmpl_t *tmpl = &session_tmpls[i];
+		if ((tmpl->ctl >= 0) && (tmpl->ngids == ngids) &&
+			!memcmp(tmpl->gids, gids, sizeof(*gids) * ngids))
+			return tmpl;
+	}
+
+	return NULL;
+}
+
+/*--------------------------------------------------------- */
+/* The pruned template exits when its control socket is closed.
+ * The running sessions are not affected.
+ */
+static void session_tmpl_drop(session_tmpl_t *tmpl)
+{
+	if (tmpl->ctl >= 0)
+		close(tmpl->ctl);
+	tmpl->ctl = -1;
+	free(tmpl->gids);
+	tmpl->gids = NULL;
+	tmpl->ngids = 0;
+}
+
+/*--------------------------------------------------------- */
+/* Pass the accepted socket to the pruned template */
+static int session_tmpl_pass(session_tmpl_t *tmpl, int sock)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} cmsgbuf;
+	struct cmsghdr *cmsg;
+	char c = 0;
+	ssize_t res;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &c;
+	iov.iov_len = sizeof(c);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(sock));
+	memcpy(CMSG_DATA(cmsg), &sock, sizeof(sock));
+
+	do {
+		res = sendmsg(tmpl->ctl, &msg, MSG_NOSIGNAL);
+	} while (res < 0 && EINTR == errno);
+
+	return (res == sizeof(c)) ? 0 : -1;
+}
+
+/*--------------------------------------------------------- */
+/* Receive the socket passed by the server */
+static int session_tmpl_recv(int ctl)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} cmsgbuf;
+	char c;
+	int sock;
+	ssize_t res;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &c;
+	iov.iov_len = sizeof(c);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	do {
+		res = recvmsg(ctl, &msg, MSG_CMSG_CLOEXEC);
+	} while (res < 0 && EINTR == errno);
+	if (res <= 0)
+		return -2; /* The server closed the template */
+	if (session_recv_fds(&msg, &sock, 1) < 0)
+		return -1;
+
+	return sock;
+}
+
+/*--------------------------------------------------------- */
+/* Start the pruned template for the group set. It forks the
+ * sessions and returns within the session process only.
+ */
+static session_tmpl_t *session_tmpl_new(clish_shell_t *shell,
+	int lsock, int sock, gid_t *gids, int ngids, int *session)
+{
+	session_tmpl_t *tmpl = NULL;
+	int sv[2];
+	pid_t pid;
+	int i;
+
+	*session = -1;
+	/* Replace the least recently used one */
+	for (i = 0; i < SESSION_TMPL_MAX; i++) {
+		if (!tmpl || (session_tmpls[i].used < tmpl->used))
+			tmpl = &session_tmpls[i];
+		if (session_tmpls[i].ctl < 0) {
+			tmpl = &session_tmpls[i];
+			break;
+		}
+	}
+	session_tmpl_drop(tmpl);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv)) {
+		syslog(LOG_ERR, "Can't create socket pair: %s\n", strerror(errno));
+		free(gids);
+		return NULL;
+	}
+	pid = fork();
+	if (pid < 0) {
+		syslog(LOG_ERR, "Can't fork template: %s\n", strerror(errno));
+		close(sv[0]);
+		close(sv[1]);
+		free(gids);
+		return NULL;
+	}
+	if (pid > 0) {
+		close(sv[1]);
+		tmpl->ctl = sv[0];
+		tmpl->gids = gids;
+		tmpl->ngids = ngids;
+		return tmpl;
+	}
+
+	/* Pruned template process. The other templates must see
+	   EOF when the server drops them. */
+	close(lsock);
+	close(sock);
+	close(sv[0]);
+	for (i = 0; i < SESSION_TMPL_MAX; i++)
+		session_tmpl_drop(&session_tmpls[i]);
+	if ((geteuid() == 0) && setgroups(ngids, gids)) {
+		syslog(LOG_ERR, "Can't set groups: %s\n", strerror(errno));
+		_exit(-1);
+	}
+	free(gids);
+	if (clish_shell_prune_access(shell) < 0)
+		_exit(-1);
+
+	while (1) {
+		sock = session_tmpl_recv(sv[1]);
+		if (-2 == sock)
+			_exit(0);
+		if (sock < 0)
+			continue;
+		pid = fork();
+		if (pid != 0) {
+			if (pid < 0)
+				syslog(LOG_ERR, "Can't fork session: %s\n", strerror(errno));
+			close(sock);
+			continue;
+		}
+		/* Session process */
+		close(sv[1]);
+		*session = sock;
+		return NULL;
+	}
+}
+
+/*--------------------------------------------------------- */
+/* Serve the incoming sessions. The function returns in the forked
+ * session process only. The return value is the socket to report
+ * the session result to. The session arguments are returned by
+ * argc and argv. The -1 means the server failure. The client waits
+ * for clish_session_accept() before it gives the terminal to the
+ * session. It starts the local shell if the socket is closed
+ * without it.
+ *
+ * The access rights are checked once per group set. The server
+ * keeps a pruned template process for each recent group set and
+ * passes the sessions of the users with that group set to it.
+ */
+int clish_session_serve(const char *path, clish_shell_t *shell,
+	int *argc, char ***argv)
+{
+	int lsock;
+	struct sigaction sig_act;
+	unsigned long stamp = 0;
+	int session = -1;
+	int i;
+
+	/* The received descriptors must not take the stdio numbers */
+	for (lsock = 0; lsock < SESSION_FDS; lsock++) {
+		if (fcntl(lsock, F_GETFD) < 0)
+			open("/dev/null", O_RDWR);
+	}
+
+	if ((lsock = session_listen(path)) < 0)
+		return -1;
+	for (i = 0; i < SESSION_TMPL_MAX; i++)
+		session_tmpls[i].ctl = -1;
+
+	/* Don't collect zombies */
+	sigemptyset(&sig_act.sa_mask);
+	sig_act.sa_flags = SA_NOCLDWAIT;
+	sig_act.sa_handler = SIG_DFL;
+	sigaction(SIGCHLD, &sig_act, NULL);
+
+	syslog(LOG_INFO, "Session server is listening %s\n", path);
+	while (session < 0) {
+		int sock;
+		gid_t *gids;
+		int ngids = 0;
+		session_tmpl_t *tmpl;
+
+		if ((sock = accept4(lsock, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+			if ((EINTR == errno) || (ECONNABORTED == errno))
+				continue;
+			syslog(LOG_ERR, "Can't accept session: %s\n", strerror(errno));
+			break;
+		}
+		if (!(gids = session_peer_groups(sock, &ngids))) {
+			close(sock);
+			continue;
+		}
+
+		/* The template may be gone. Start it again then. */
+		tmpl = session_tmpl_find(gids, ngids);
+		if (tmpl && (session_tmpl_pass(tmpl, sock) < 0)) {
+			session_tmpl_drop(tmpl);
+			tmpl = NULL;
+		}
+		if (tmpl) {
+			free(gids);
+		} else {
+			tmpl = session_tmpl_new(shell, lsock, sock,
+				gids, ngids, &session);
+			if (session >= 0)
+				break; /* Session process */
+			if (tmpl && (session_tmpl_pass(tmpl, sock) < 0)) {
+				session_tmpl_drop(tmpl);
+				tmpl = NULL;
+			}
+		}
+		if (tmpl)
+			tmpl->used = ++stamp;
+		close(sock);
+	}
+
+	if (session < 0) {
+		close(lsock);
+		unlink(path);
+		return -1;
+	}
+
+	/* Session process */
+	sig_act.sa_flags = 0;
+	sigaction(SIGCHLD, &sig_act, NULL);
+	if (session_start(session, argc, argv) < 0)
+		_exit(-1);
+
+	return session;
+}
+
+/*--------------------------------------------------------- */
+/* The session is ready. Let the client pass the terminal to it. */
+int clish_session_accept(int sock)
+{
+	int32_t pid = getpid();
+
+	return session_write(sock, &pid, sizeof(pid));
+}
+
+/*--------------------------------------------------------- */
+/* Report the session result to the client */
+void clish_session_finish(int sock, int result)
+{
+	int32_t res = result;
+
+	session_write(sock, &res, sizeof(res));
+	close(sock);
+}
@@ -0,0 +1,21 @@
+/*
+ * session.h
+ *
+ * Hand-off of the terminal sessions to the pre-forked clish server.
+ */
+
+#ifndef _bin_session_h
+#define _bin_session_h
+
+#include "clish/shell.h"
+
+/* Default listen socket of the session server */
+#define CLISHD_SOCKET_PATH "/var/run/clishd.sock"
+
+int clish_session_connect(const char *path, int argc, char **argv);
+int clish_session_serve(const char *path, clish_shell_t *shell,
+	int *argc, char ***argv);
+int clish_session_accept(int sock);
+void clish_session_finish(int sock, int result);
+
+#endif /* _bin_session_h */
@@ -20,6 +20,7 @@ typedef enum {
 	CLISH_SYM_TYPE_ACCESS, /* Callback for "access" field */
 	CLISH_SYM_TYPE_CONFIG, /* Callback for CONFIG tag */
 	CLISH_SYM_TYPE_LOG, /* Callback for logging */
+	CLISH_SYM_TYPE_STATS, /* Callback for the ACTION timing */
 	CLISH_SYM_TYPE_MAX /* Number of elements */
 } clish_sym_type_e;
 
@@ -47,6 +48,7 @@ typedef struct clish_plugin_s clish_plugin_t;
 #define CLISH_HOOK_ACCESS(name) int name(void *clish_shell, const char *access)
 #define CLISH_HOOK_CONFIG(name) int name(void *clish_context)
 #define CLISH_HOOK_LOG(name) int name(void *clish_context, const char *line, int retcode)
+#define CLISH_HOOK_STATS(name) int name(void *clish_context, bool_t done, unsigned long usec)
 
 typedef CLISH_PLUGIN_INIT_FUNC(clish_plugin_init_t);
 typedef CLISH_PLUGIN_FINI(clish_plugin_fini_t);
@@ -55,6 +57,7 @@ typedef CLISH_PLUGIN_OSYM(clish_hook_oaction_fn_t);
 typedef CLISH_HOOK_ACCESS(clish_hook_access_fn_t);
 typedef CLISH_HOOK_CONFIG(clish_hook_config_fn_t);
 typedef CLISH_HOOK_LOG(clish_hook_log_fn_t);
+typedef CLISH_HOOK_STATS(clish_hook_stats_fn_t);
 
 /* Helpers */
 #define SYM_FN(TYPE,SYM) (*((clish_hook_##TYPE##_fn_t *)(clish_sym__get_func(SYM))))
@@ -16,6 +16,7 @@
 #include "string.h"
 #include "stdlib.h"
 #include "signal.h"
+#include "fcntl.h"
 
 int interruptRecvd = 0;
 
@@ -26,11 +27,29 @@ int interruptRecvd = 0;
 int ctrlc_rd_fd = 0, ctrlc_wr_fd = 0;
 
 /*-------------------------------------------------------- */
+void clish_interrupt_init(void)
+{
+    int fds[2];
+
+    if (ctrlc_wr_fd > 0)
+        return;
+    /* Non-blocking, the handler must not wait for the reader */
+    if (pipe(fds) < 0)
+        return;
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    ctrlc_rd_fd = fds[0];
+    ctrlc_wr_fd = fds[1];
+}
+
 void clish_interrupt_handler(int signum)
 {
     interruptRecvd = 1;
     /* Write some data in Ctrl-C pipe to exit render gracefully */
-    write(ctrlc_wr_fd, "q", 1);
+    if (ctrlc_wr_fd > 0)
+        write(ctrlc_wr_fd, "q", 1);
 }
 
 bool_t is_ctrlc_pressed(void)
@@ -53,6 +72,8 @@ void flush_ctrlc_pipe(void)
 
     // Reset interrupt recieved flag
     interruptRecvd = 0;
+    if (ctrlc_rd_fd <= 0)
+        return;
     // Flush pipe contents
     while(BOOL_TRUE) {
         FD_ZERO (&fds);
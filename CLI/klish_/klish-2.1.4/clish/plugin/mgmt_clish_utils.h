@@ -15,6 +15,11 @@ extern "C" {
 #include "time.h"
 extern int interruptRecvd;
 
+/**
+* @brief Creates the Ctrl-C pipe, once
+*/
+void clish_interrupt_init(void);
+
 /**
 * @brief Sugnal handler for clish
 *
@@ -34,6 +34,9 @@ void clish_sym_dump(const clish_sym_t *this)
 	case CLISH_SYM_TYPE_LOG:
 		type = "log";
 		break;
+	case CLISH_SYM_TYPE_STATS:
+		type = "stats";
+		break;
 	default:
 		type = "unknown";
 		break;
@@ -155,6 +155,8 @@ _CLISH_SET(shell, bool_t, dryrun);
 _CLISH_GET(shell, bool_t, dryrun);
 _CLISH_SET(shell, bool_t, canon_out);
 _CLISH_GET(shell, bool_t, canon_out);
+_CLISH_SET(shell, bool_t, defer_access);
+_CLISH_GET(shell, bool_t, defer_access);
 
 clish_view_t *clish_shell__get_view(const clish_shell_t * instance);
 clish_view_t *clish_shell__set_depth(clish_shell_t *instance, unsigned int depth);
@@ -166,6 +168,8 @@ char *clish_shell__get_pwd_line(const clish_shell_t * instance,
 	 unsigned int index);
 clish_pargv_t *clish_shell__get_pwd_pargv(const clish_shell_t *instance,
 	unsigned int index);
+lub_bintree_t *clish_shell__get_pwd_viewid(const clish_shell_t *instance,
+	unsigned int index);
 char *clish_shell__get_pwd_cmd(const clish_shell_t *instance,
 	unsigned int index);
 char *clish_shell__get_pwd_prefix(const clish_shell_t *instance,
@@ -176,6 +180,10 @@ clish_view_t *clish_shell__get_pwd_view(const clish_shell_t * instance,
 	unsigned int index);
 FILE *clish_shell__get_istream(const clish_shell_t * instance);
 FILE *clish_shell__get_ostream(const clish_shell_t * instance);
+bool_t clish_shell__get_input_pending(const clish_shell_t * instance);
+unsigned int clish_shell__get_line_num(const clish_shell_t * instance);
+bool_t clish_shell__get_stop_on_error(const clish_shell_t * instance);
+unsigned long clish_shell__get_parse_time(const clish_shell_t * instance);
 int clish_shell__set_socket(clish_shell_t * instance, const char * path);
 int clish_shell_load_scheme(clish_shell_t * instance, const char * xml_path, const char *xslt_path);
 int clish_shell_loop(clish_shell_t * instance);
@@ -215,6 +223,7 @@ clish_sym_t *clish_shell_get_hook(const clish_shell_t *instance, int type);
 const void *clish_shell_check_hook(const clish_context_t *clish_context, int type);
 CLISH_HOOK_CONFIG(clish_shell_exec_config);
 CLISH_HOOK_LOG(clish_shell_exec_log);
+CLISH_HOOK_STATS(clish_shell_exec_stats);
 
 /* User data functions */
 void *clish_shell__get_udata(const clish_shell_t *instance, const char *name);
@@ -224,6 +233,8 @@ int clish_shell__set_udata(clish_shell_t *instance,
 
 /* Access functions */
 int clish_shell_prepare(clish_shell_t *instance);
+int clish_shell_prune_access(clish_shell_t *instance);
+void clish_shell_attach_session(clish_shell_t *instance);
 
 /*
  * Non shell specific functions.
@@ -37,6 +37,9 @@ typedef struct {
 	char *prefix; /* Prefix string if exists */
 } clish_shell_pwd_t;
 
+/* Output modifiers of the command line */
+typedef struct clish_pipe_s clish_pipe_t;
+
 /* Context structure */
 struct clish_context_s {
 	clish_shell_t *shell;
@@ -69,6 +72,7 @@ struct clish_shell_s {
 	char *overview; /* Overview text for this shell */
 	tinyrl_t *tinyrl; /* Tiny readline instance */
 	clish_shell_file_t *current_file; /* file currently in use for input */
+	unsigned long parse_time; /* Parse time of the last line, usec */
 	clish_shell_pwd_t **pwdv; /* Levels for the config file structure */
 	unsigned int pwdc;
 	int depth;
@@ -85,6 +89,7 @@ struct clish_shell_s {
 	bool_t dryrun; /* Is this a dry-running */
 	bool_t default_plugin; /* Use or not default plugin */
 	bool_t canon_out; /* Output every command in canonical form (with pre-spaces) */
+	bool_t defer_access; /* Don't check access rights while prepare */
 
 	/* Plugins and symbols */
 	lub_list_t *plugins; /* List of plugins */
@@ -150,3 +155,6 @@ void clish_shell__fini_pwd(clish_shell_pwd_t *pwd);
 int clish_shell_timeout_fn(tinyrl_t *tinyrl);
 int clish_shell_keypress_fn(tinyrl_t *tinyrl, int key);
 bool_t clish_shell_command_test(const clish_command_t *cmd, void *context);
+int clish_shell_pipe_start(clish_context_t *context, clish_pipe_t **pipe);
+bool_t clish_shell_pipe_repeat(clish_pipe_t *pipe);
+void clish_shell_pipe_stop(clish_pipe_t *pipe);
@@ -19,6 +19,7 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <time.h>
 
 #define CONFIG_VIEW        "configure-view"
 
@@ -413,6 +414,8 @@ int clish_shell_exec_action(clish_context_t *context, char **out)
 	clish_parg_t *parg = NULL;
         clish_ptype_t *ptype = NULL;
         clish_ptype_method_e method = CLISH_PTYPE_METHOD_REGEXP;
+	clish_pipe_t *modifiers = NULL;
+	struct timespec start, end;
 
 	bool_t intr = clish_action__get_interrupt(action);
 	/* Signal vars */
@@ -451,6 +454,14 @@ int clish_shell_exec_action(clish_context_t *context, char **out)
 		sigprocmask(SIG_BLOCK, &sigs, &old_sigs);
 	}
 
+	/* Pass the output through the modifiers like "| grep" */
+	if (!out && (clish_shell_pipe_start(context, &modifiers) < 0))
+		goto pipe_error;
+
+repeat:
+	/* Every run of the ACTION is timed by the stats hook */
+	clish_shell_exec_stats(context, BOOL_FALSE, 0);
+	clock_gettime(CLOCK_MONOTONIC, &start);
 	parg = (clish_parg_t*)clish_shell__get_parg(context);
 	if (!parg || !(ptype = (clish_ptype_t *)clish_parg__get_ptype(parg)))
 	{
@@ -546,7 +557,16 @@ int clish_shell_exec_action(clish_context_t *context, char **out)
 			result = clish_shell_exec_sym_api(sym, func, context, script, out);
                 }
         }
-
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	clish_shell_exec_stats(context, BOOL_TRUE,
+		(end.tv_sec - start.tv_sec) * 1000000 +
+		(end.tv_nsec - start.tv_nsec) / 1000);
+	/* The "| repeat" runs the ACTION again till the user stops it */
+	if (clish_shell_pipe_repeat(modifiers))
+		goto repeat;
+	clish_shell_pipe_stop(modifiers);
+
+pipe_error:
 	/* Restore SIGINT, SIGQUIT, SIGHUP */
 	if (!intr) {
 		sigprocmask(SIG_SETMASK, &old_sigs, NULL);
@@ -601,6 +621,14 @@ CLISH_HOOK_LOG(clish_shell_exec_log)
 	return func ? func(clish_context, line, retcode) : 0;
 }
 
+/*----------------------------------------------------------- */
+CLISH_HOOK_STATS(clish_shell_exec_stats)
+{
+	clish_hook_stats_fn_t *func = NULL;
+	func = clish_shell_check_hook(clish_context, CLISH_SYM_TYPE_STATS);
+	return func ? func(clish_context, done, usec) : 0;
+}
+
 /*----------------------------------------------------------- */
 char *clish_shell_mkfifo(clish_shell_t * this, char *name, size_t n)
 {
@@ -92,3 +92,22 @@ int clish_shell_pop_file(clish_shell_t *this)
 }
 
 /*----------------------------------------------------------- */
+/* The number of the current line in the input file */
+unsigned int clish_shell__get_line_num(const clish_shell_t *this)
+{
+	assert(this);
+	if (!this->current_file)
+		return 0;
+	return this->current_file->line;
+}
+
+/*----------------------------------------------------------- */
+bool_t clish_shell__get_stop_on_error(const clish_shell_t *this)
+{
+	assert(this);
+	if (!this->current_file)
+		return BOOL_FALSE;
+	return this->current_file->stop_on_error;
+}
+
+/*----------------------------------------------------------- */
@@ -144,8 +144,8 @@ void sort_help_command (const lub_argv_t *name , const lub_argv_t *help, int com
 
                         if ((str1 == NULL) || (str2 == NULL))
                                 continue;
-                        /* check two strings. if compared string is lowest letter, then swap */
-                        if(lub_string_nocasecmp(str1,str2) > 0) {
+                        /* check two strings in the natural order (Ethernet4 < Ethernet48), swap if greater */
+                        if(lub_string_natcmp(str1,str2) > 0) {
                                 /*swap the name to sort */
                                 lub_argv__swap_arg(name,indexi,indexj);
                                 /*swap the corresponding help string of command */
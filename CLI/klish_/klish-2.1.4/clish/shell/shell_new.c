@@ -67,6 +67,7 @@ static void clish_shell_init(clish_shell_t * this,
 	this->overview = NULL;
 	this->tinyrl = clish_shell_tinyrl_new(istream, ostream, 0);
 	this->current_file = NULL;
+	this->parse_time = 0;
 	this->pwdv = NULL;
 	this->pwdc = 0;
 	this->depth = -1; /* Current depth is undefined */
@@ -79,6 +80,7 @@ static void clish_shell_init(clish_shell_t * this,
 	this->user = lub_db_getpwuid(getuid()); /* Get user information */
 	this->default_plugin = BOOL_TRUE; /* Load default plugin by default */
 	this->canon_out = BOOL_FALSE; /* A canonical output is needed in special cases only */
+	this->defer_access = BOOL_FALSE; /* Check access rights while prepare */
 
 	/* Create template (string) for FIFO name generation */
 	snprintf(template, sizeof(template),
@@ -185,4 +187,32 @@ void clish_shell_delete(clish_shell_t *this)
 	free(this);
 }
 
+/*--------------------------------------------------------- */
+/* Rebind the per-process state to the current process and user.
+ * It's needed when the prepared shell is inherited by a forked
+ * session process running with other credentials.
+ */
+void clish_shell_attach_session(clish_shell_t *this)
+{
+	char template[PATH_MAX];
+	char lock_file[PATH_MAX];
+
+	free(this->user);
+	this->user = lub_db_getpwuid(getuid());
+
+	/* The lockless mode has no lock file */
+	if (this->lockfile) {
+		snprintf(lock_file, sizeof(lock_file),
+			"%s.%u", CLISH_LOCK_PATH, getpid());
+		lock_file[sizeof(lock_file) - 1] = '\0';
+		clish_shell__set_lockfile(this, lock_file);
+	}
+
+	snprintf(template, sizeof(template),
+		"%s/klish.fifo.%u.XXXXXX", "/tmp", getpid());
+	template[sizeof(template) - 1] = '\0';
+	lub_string_free(this->fifo_temp);
+	this->fifo_temp = lub_string_dup(template);
+}
+
 CLISH_GET(shell, struct passwd *, user);
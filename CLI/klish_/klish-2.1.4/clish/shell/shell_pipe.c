@@ -0,0 +1,996 @@
+/*
+ * shell_pipe.c
+ *
+ * The output modifiers of the command line: "| grep", "| except",
+ * "| find", "| save", "| no-more" and "| repeat". The modifiers are
+ * the PARAMs of the include/pipe.xml. The ACTION's output is passed
+ * through the forked filter process which applies the modifiers line
+ * by line and pages the result.
+ *
+ * The "| repeat" runs the ACTION again every interval. The output of
+ * every run is captured as a frame, filtered and compared to the
+ * previous frame, only the changed parts of the lines are redrawn.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* ppoll() */
+#endif
+#include "private.h"
+#include "lub/string.h"
+#include "tinyrl/vt100.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <regex.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <pwd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* The pipe.xml has the "N_pipe" PARAMs. Every one has the
+ * "N_switch_var" with the modifier name, the modifier arguments
+ * are "N_LINE" and "N_ignore-case". The "save" has the "filename"
+ * and "append". */
+#define CLISH_PIPE_MAX 8
+#define CLISH_PIPE_SWITCH "switch_var"
+#define CLISH_PIPE_LINE "LINE"
+#define CLISH_PIPE_ICASE "ignore-case"
+#define CLISH_PIPE_FILENAME "filename"
+#define CLISH_PIPE_APPEND "append"
+#define CLISH_PIPE_INTERVAL "interval"
+#define CLISH_PIPE_PAGE_LEN 24
+#define CLISH_PIPE_TAB_SIZE 8
+
+typedef enum {
+	CLISH_PIPE_NONE,
+	CLISH_PIPE_GREP,
+	CLISH_PIPE_EXCEPT,
+	CLISH_PIPE_FIND,
+	CLISH_PIPE_SAVE,
+	CLISH_PIPE_NO_MORE,
+	CLISH_PIPE_REPEAT
+} clish_pipe_e;
+
+typedef struct {
+	clish_pipe_e type;
+	const char *pattern;
+	bool_t icase;
+	bool_t active; /* The "find" is passed once matched */
+	bool_t compiled;
+	regex_t re;
+} clish_pipe_filter_t;
+
+struct clish_pipe_s {
+	clish_pipe_filter_t filter[CLISH_PIPE_MAX];
+	bool_t filtered; /* Has something to filter */
+	bool_t no_more;
+	unsigned int page_len;
+	const char *filename;
+	bool_t append;
+	FILE *save;
+	char *term_len; /* Saved CLISH_TERM_LEN */
+	pid_t pid;
+	int real_stdout;
+	int real_stderr;
+	/* The "repeat" */
+	unsigned int interval; /* Seconds between the runs */
+	char *title; /* The command line */
+	FILE *frame; /* Captured output of the run */
+	char **lines; /* The frame on the screen */
+	unsigned int lines_num;
+	tinyrl_vt100_t *term;
+	bool_t redraw; /* Only the changes are drawn on the terminal */
+};
+
+/*--------------------------------------------------------- */
+static clish_pipe_e clish_pipe_type(const char *name)
+{
+	if (!name)
+		return CLISH_PIPE_NONE;
+	if (!strcmp(name, "grep"))
+		return CLISH_PIPE_GREP;
+	if (!strcmp(name, "except"))
+		return CLISH_PIPE_EXCEPT;
+	if (!strcmp(name, "find"))
+		return CLISH_PIPE_FIND;
+	if (!strcmp(name, "save"))
+		return CLISH_PIPE_SAVE;
+	if (!strcmp(name, "no-more"))
+		return CLISH_PIPE_NO_MORE;
+	if (!strcmp(name, "repeat"))
+		return CLISH_PIPE_REPEAT;
+	return CLISH_PIPE_NONE;
+}
+
+/*--------------------------------------------------------- */
+static void clish_pipe_free(clish_pipe_t *this)
+{
+	unsigned int i;
+
+	for (i = 0; i < CLISH_PIPE_MAX; i++) {
+		if (this->filter[i].compiled)
+			regfree(&this->filter[i].re);
+	}
+	if (this->save)
+		fclose(this->save);
+	if (this->frame)
+		fclose(this->frame);
+	for (i = 0; i < this->lines_num; i++)
+		lub_string_free(this->lines[i]);
+	free(this->lines);
+	if (this->term)
+		tinyrl_vt100_delete(this->term);
+	lub_string_free(this->title);
+	lub_string_free(this->term_len);
+	free(this);
+}
+
+/*--------------------------------------------------------- */
+/* Get the modifiers from the parsed command line */
+static clish_pipe_t *clish_pipe_new(clish_context_t *context)
+{
+	clish_pargv_t *pargv = clish_context__get_pargv(context);
+	clish_pipe_t *this;
+	bool_t found = BOOL_FALSE;
+	unsigned int i;
+
+	if (!pargv)
+		return NULL;
+	this = calloc(1, sizeof(*this));
+	if (!this)
+		return NULL;
+	this->pid = -1;
+	this->real_stdout = -1;
+	this->real_stderr = -1;
+
+	for (i = 0; i < clish_pargv__get_count(pargv); i++) {
+		const char *name = clish_param__get_name(
+			clish_pargv__get_param(pargv, i));
+		const char *value = clish_parg__get_value(
+			clish_pargv__get_parg(pargv, i));
+		clish_pipe_filter_t *filter;
+		unsigned long n;
+		char *end = NULL;
+
+		if (!strcmp(name, CLISH_PIPE_FILENAME)) {
+			this->filename = value;
+			continue;
+		}
+		if (!strcmp(name, CLISH_PIPE_APPEND)) {
+			this->append = value ? BOOL_TRUE : BOOL_FALSE;
+			continue;
+		}
+		if (!strcmp(name, CLISH_PIPE_INTERVAL)) {
+			this->interval = value ? strtoul(value, NULL, 10) : 0;
+			continue;
+		}
+		n = strtoul(name, &end, 10);
+		if ((end == name) || (*end != '_') ||
+			(n < 1) || (n > CLISH_PIPE_MAX))
+			continue;
+		filter = &this->filter[n - 1];
+		end++;
+		if (!strcmp(end, CLISH_PIPE_SWITCH)) {
+			filter->type = clish_pipe_type(value);
+			filter->active = BOOL_TRUE;
+			found = BOOL_TRUE;
+		} else if (!strcmp(end, CLISH_PIPE_LINE)) {
+			filter->pattern = value;
+		} else if (!strcmp(end, CLISH_PIPE_ICASE)) {
+			filter->icase = value ? BOOL_TRUE : BOOL_FALSE;
+		}
+	}
+	if (!found) {
+		free(this);
+		return NULL;
+	}
+
+	return this;
+}
+
+/*--------------------------------------------------------- */
+/* The Perl classes of the Python patterns in ERE. The negated ones
+ * have no form inside the brackets. */
+static const char *clish_pipe_class(char c, bool_t bracket)
+{
+	switch (c) {
+	case 'd':
+		return bracket ? "0-9" : "[0-9]";
+	case 's':
+		return bracket ? "[:space:]" : "[[:space:]]";
+	case 'w':
+		return bracket ? "[:alnum:]_" : "[[:alnum:]_]";
+	case 'D':
+		return bracket ? NULL : "[^0-9]";
+	case 'S':
+		return bracket ? NULL : "[^[:space:]]";
+	case 'W':
+		return bracket ? NULL : "[^[:alnum:]_]";
+	case 'A':
+		return bracket ? NULL : "^";
+	case 'Z':
+		return bracket ? NULL : "$";
+	case 't':
+		return "\t";
+	case 'n':
+		return "\n";
+	default:
+		break;
+	}
+	return NULL;
+}
+
+/*--------------------------------------------------------- */
+/* The bracket expression from the '['. The backslash isn't special
+ * in ERE brackets, the escaped ']', '-' and '^' are collating
+ * symbols there. Returns the position after the ']'. */
+static const char *clish_pipe_bracket(const char *p, char **res,
+	char *bad)
+{
+	lub_string_cat(res, "[");
+	p++;
+	if (*p == '^')
+		lub_string_catn(res, p++, 1);
+	if (*p == ']')
+		lub_string_catn(res, p++, 1);
+	while (*p && (*p != ']')) {
+		const char *cls;
+		char c = p[1];
+
+		if ((*p == '[') && (c == ':')) {
+			const char *end = strstr(p + 2, ":]");
+			size_t len = end ? (size_t)(end + 2 - p) : strlen(p);
+			lub_string_catn(res, p, len);
+			p += len;
+			continue;
+		}
+		if ((*p != '\\') || !c) {
+			lub_string_catn(res, p++, 1);
+			continue;
+		}
+		cls = clish_pipe_class(c, BOOL_TRUE);
+		if (cls) {
+			lub_string_cat(res, cls);
+		} else if (strchr("]-^", c)) {
+			char sym[] = { '[', '.', c, '.', ']', '\0' };
+			lub_string_cat(res, sym);
+		} else if (isalnum((unsigned char)c)) {
+			*bad = c;
+			return NULL;
+		} else {
+			lub_string_catn(res, p + 1, 1);
+		}
+		p += 2;
+	}
+	if (*p)
+		lub_string_catn(res, p++, 1);
+
+	return p;
+}
+
+/*--------------------------------------------------------- */
+/* The patterns are the Python ones, regcomp() gets them in ERE.
+ * The Perl classes and the "(?:" groups are translated, the lazy
+ * quantifiers are greedy as only the match of the line counts. The
+ * escapes ERE has no meaning for are refused in the "bad" rather
+ * than matched literally. */
+static char *clish_pipe_regex(const char *pattern, char *bad)
+{
+	const char *p = pattern;
+	char *res = NULL;
+
+	lub_string_cat(&res, "");
+	while (p && *p) {
+		const char *cls;
+		char c = p[1];
+
+		if (*p == '[') {
+			p = clish_pipe_bracket(p, &res, bad);
+			continue;
+		}
+		if ((*p == '(') && (c == '?')) {
+			if (p[2] != ':') {
+				*bad = c;
+				p = NULL;
+				continue;
+			}
+			lub_string_cat(&res, "(");
+			p += 3;
+			continue;
+		}
+		if (strchr("*+?}", *p) && (c == '?')) {
+			lub_string_catn(&res, p, 1);
+			p += 2;
+			continue;
+		}
+		if ((*p != '\\') || !c) {
+			lub_string_catn(&res, p++, 1);
+			continue;
+		}
+		/* The GNU \b, \B, \< and \> and the back-references
+		 * are as in Python */
+		cls = clish_pipe_class(c, BOOL_FALSE);
+		if (cls) {
+			lub_string_cat(&res, cls);
+		} else if (isalpha((unsigned char)c) && !strchr("bB", c)) {
+			*bad = c;
+			p = NULL;
+			continue;
+		} else {
+			lub_string_catn(&res, p, 2);
+		}
+		p += 2;
+	}
+	if (!p) {
+		lub_string_free(res);
+		return NULL;
+	}
+
+	return res;
+}
+
+/*--------------------------------------------------------- */
+static int clish_pipe_compile(clish_pipe_t *this)
+{
+	bool_t save = BOOL_FALSE;
+	bool_t repeat = BOOL_FALSE;
+	unsigned int i;
+
+	for (i = 0; i < CLISH_PIPE_MAX; i++) {
+		clish_pipe_filter_t *filter = &this->filter[i];
+		int flags = REG_EXTENDED | REG_NOSUB;
+		char *regex;
+		char bad = '\0';
+		int res;
+
+		switch (filter->type) {
+		case CLISH_PIPE_GREP:
+		case CLISH_PIPE_EXCEPT:
+		case CLISH_PIPE_FIND:
+			break;
+		case CLISH_PIPE_SAVE:
+			save = BOOL_TRUE;
+			this->filtered = BOOL_TRUE;
+			continue;
+		case CLISH_PIPE_NO_MORE:
+			this->no_more = BOOL_TRUE;
+			continue;
+		case CLISH_PIPE_REPEAT:
+			repeat = BOOL_TRUE;
+			continue;
+		default:
+			continue;
+		}
+		if (!filter->pattern)
+			continue;
+		if (filter->icase)
+			flags |= REG_ICASE;
+		regex = clish_pipe_regex(filter->pattern, &bad);
+		if (!regex) {
+			fprintf(stderr, "%%Error: Unsupported \"%s%c\" in "
+				"regular expression \"%s\"\n",
+				(bad == '?') ? "(" : "\\", bad, filter->pattern);
+			return -1;
+		}
+		res = regcomp(&filter->re, regex, flags);
+		lub_string_free(regex);
+		if (res) {
+			char err[128];
+			regerror(res, &filter->re, err, sizeof(err));
+			fprintf(stderr, "%%Error: Invalid regular expression "
+				"\"%s\": %s\n", filter->pattern, err);
+			return -1;
+		}
+		filter->compiled = BOOL_TRUE;
+		this->filtered = BOOL_TRUE;
+	}
+	/* The "filename" and "interval" of the command itself */
+	if (!save)
+		this->filename = NULL;
+	if (!repeat)
+		this->interval = 0;
+	else if (!this->interval)
+		this->interval = 1;
+
+	return 0;
+}
+
+/*--------------------------------------------------------- */
+/* The relative path is in the user's home directory */
+static int clish_pipe_open_save(clish_pipe_t *this, clish_context_t *context)
+{
+	clish_shell_t *shell = clish_context__get_shell(context);
+	char *path = NULL;
+	char *line;
+	char stamp[64];
+	time_t now;
+
+	if (!this->filename)
+		return 0;
+	if (this->filename[0] != '/') {
+		const char *home = getenv("HOME");
+		if (!home && shell->user)
+			home = shell->user->pw_dir;
+		lub_string_cat(&path, home ? home : ".");
+		lub_string_cat(&path, "/");
+	}
+	lub_string_cat(&path, this->filename);
+
+	this->save = fopen(path, this->append ? "a" : "w");
+	if (!this->save) {
+		fprintf(stderr, "%%Error: Can't create file %s: %s\n",
+			path, strerror(errno));
+		lub_string_free(path);
+		return -1;
+	}
+	lub_string_free(path);
+#ifdef FD_CLOEXEC
+	fcntl(fileno(this->save), F_SETFD,
+		fcntl(fileno(this->save), F_GETFD) | FD_CLOEXEC);
+#endif
+
+	now = time(NULL);
+	strftime(stamp, sizeof(stamp), "%d/%m, %Y, %H:%M:%S", gmtime(&now));
+	line = clish_shell__get_full_line(context);
+	fprintf(this->save, "\n! ====================================="
+		"===================================\n"
+		"! Started saving show command output at %s for command:\n"
+		"! %s\n"
+		"! ====================================="
+		"===================================\n",
+		stamp, line ? line : "");
+	lub_string_free(line);
+
+	return 0;
+}
+
+/*--------------------------------------------------------- */
+/* Returns BOOL_TRUE if the line must be printed */
+static bool_t clish_pipe_match(clish_pipe_t *this, const char *line)
+{
+	bool_t print = BOOL_TRUE;
+	unsigned int i;
+
+	for (i = 0; i < CLISH_PIPE_MAX; i++) {
+		clish_pipe_filter_t *filter = &this->filter[i];
+
+		if (!filter->active)
+			continue;
+		switch (filter->type) {
+		case CLISH_PIPE_GREP:
+			if (filter->compiled &&
+				regexec(&filter->re, line, 0, NULL, 0))
+				return BOOL_FALSE;
+			print = BOOL_TRUE;
+			break;
+		case CLISH_PIPE_EXCEPT:
+			if (filter->compiled &&
+				!regexec(&filter->re, line, 0, NULL, 0))
+				return BOOL_FALSE;
+			print = BOOL_TRUE;
+			break;
+		case CLISH_PIPE_FIND:
+			if (filter->compiled &&
+				regexec(&filter->re, line, 0, NULL, 0))
+				return BOOL_FALSE;
+			/* The rest of output follows the first match */
+			filter->active = BOOL_FALSE;
+			print = BOOL_TRUE;
+			break;
+		case CLISH_PIPE_SAVE:
+			if (this->save && line[0])
+				fprintf(this->save, "%s\n", line);
+			print = BOOL_FALSE;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return print;
+}
+
+/*--------------------------------------------------------- */
+/* Wait for the key on the "--more--" prompt.
+ * Returns the number of lines to show or 0 to stop. */
+static unsigned int clish_pipe_more(clish_pipe_t *this)
+{
+	struct termios old, raw;
+	unsigned int lines = 0;
+	char c = 0;
+	ssize_t res;
+
+	fputs("--more--", stdout);
+	fflush(stdout);
+	if (tcgetattr(STDIN_FILENO, &old) < 0)
+		return 0;
+	raw = old;
+	raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+	while (!lines) {
+		do {
+			res = read(STDIN_FILENO, &c, 1);
+		} while ((res < 0) && (EINTR == errno));
+		if ((res <= 0) || ('q' == c) || (3 == c)) /* Ctrl-C */
+			break;
+		if (' ' == c)
+			lines = this->page_len;
+		else if (('\n' == c) || ('\r' == c))
+			lines = 1;
+	}
+	tcflush(STDIN_FILENO, TCIFLUSH);
+	tcsetattr(STDIN_FILENO, TCSANOW, &old);
+	fputs("\x1b[2K\x1b[0G", stdout);
+
+	return lines;
+}
+
+/*--------------------------------------------------------- */
+/* The filter process. The rest of output is drained when the
+ * user quits the pager so the ACTION is not blocked on write. */
+static void clish_pipe_filter(clish_pipe_t *this, int fd)
+{
+	FILE *in = fdopen(fd, "r");
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	unsigned int left = this->page_len;
+	bool_t quit = BOOL_FALSE;
+
+	if (!in)
+		return;
+	while ((len = getline(&line, &size, in)) > 0) {
+		bool_t nl = BOOL_FALSE;
+
+		if (quit)
+			continue;
+		if ('\n' == line[len - 1]) {
+			line[--len] = '\0';
+			nl = BOOL_TRUE;
+		}
+		if (!clish_pipe_match(this, line))
+			continue;
+		fputs(line, stdout);
+		if (nl)
+			fputc('\n', stdout);
+		if (this->page_len && !--left) {
+			left = clish_pipe_more(this);
+			if (!left)
+				quit = BOOL_TRUE;
+		}
+	}
+	fflush(stdout);
+	free(line);
+	fclose(in);
+}
+
+/*--------------------------------------------------------- */
+static void clish_pipe_set_term_len(clish_pipe_t *this)
+{
+	const char *term_len = getenv("CLISH_TERM_LEN");
+
+	this->term_len = term_len ? lub_string_dup(term_len) : NULL;
+	/* The ACTION doesn't page the output, the filter does */
+	setenv("CLISH_TERM_LEN", "0", 1);
+}
+
+/*--------------------------------------------------------- */
+static void clish_pipe_restore_term_len(clish_pipe_t *this)
+{
+	if (this->term_len)
+		setenv("CLISH_TERM_LEN", this->term_len, 1);
+	else
+		unsetenv("CLISH_TERM_LEN");
+}
+
+/*--------------------------------------------------------- */
+/* Capture the output of the next run of the ACTION */
+static int clish_pipe_frame_begin(clish_pipe_t *this)
+{
+	unsigned int i;
+
+	/* The "find" matches anew in every frame */
+	for (i = 0; i < CLISH_PIPE_MAX; i++)
+		this->filter[i].active =
+			(this->filter[i].type != CLISH_PIPE_NONE) ?
+			BOOL_TRUE : BOOL_FALSE;
+	if (!this->frame && !(this->frame = tmpfile()))
+		return -1;
+	if (ftruncate(fileno(this->frame), 0) < 0)
+		return -1;
+	rewind(this->frame);
+
+	fflush(stdout);
+	fflush(stderr);
+	this->real_stdout = dup(STDOUT_FILENO);
+	this->real_stderr = dup(STDERR_FILENO);
+	dup2(fileno(this->frame), STDOUT_FILENO);
+	dup2(fileno(this->frame), STDERR_FILENO);
+#ifdef FD_CLOEXEC
+	fcntl(this->real_stdout, F_SETFD,
+		fcntl(this->real_stdout, F_GETFD) | FD_CLOEXEC);
+	fcntl(this->real_stderr, F_SETFD,
+		fcntl(this->real_stderr, F_GETFD) | FD_CLOEXEC);
+#endif
+
+	return 0;
+}
+
+/*--------------------------------------------------------- */
+static void clish_pipe_frame_end(clish_pipe_t *this)
+{
+	if (this->real_stdout == -1)
+		return;
+	fflush(stdout);
+	fflush(stderr);
+	dup2(this->real_stdout, STDOUT_FILENO);
+	dup2(this->real_stderr, STDERR_FILENO);
+	close(this->real_stdout);
+	close(this->real_stderr);
+	this->real_stdout = -1;
+	this->real_stderr = -1;
+}
+
+/*--------------------------------------------------------- */
+/* The tabs are expanded so the columns can be compared */
+static char *clish_pipe_frame_line(const char *line, unsigned int width)
+{
+	char *result = NULL;
+	unsigned int col = 0;
+	const char *p;
+
+	for (p = line; *p && (!width || (col < width)); p++) {
+		if ('\t' == *p) {
+			do {
+				lub_string_catn(&result, " ", 1);
+				col++;
+			} while ((col % CLISH_PIPE_TAB_SIZE) &&
+				(!width || (col < width)));
+			continue;
+		}
+		if ('\r' == *p)
+			continue;
+		lub_string_catn(&result, p, 1);
+		col++;
+	}
+
+	return result ? result : lub_string_dup("");
+}
+
+/*--------------------------------------------------------- */
+static void clish_pipe_goto(clish_pipe_t *this, unsigned int row,
+	unsigned int col)
+{
+	tinyrl_vt100_cursor_home(this->term);
+	if (row)
+		tinyrl_vt100_cursor_down(this->term, row);
+	if (col)
+		tinyrl_vt100_cursor_forward(this->term, col);
+}
+
+/*--------------------------------------------------------- */
+/* Draw the changed part of the line. The non-ASCII line is drawn
+ * whole because its bytes are not the columns. */
+static void clish_pipe_draw_line(clish_pipe_t *this, unsigned int row,
+	const char *old, const char *line)
+{
+	size_t old_len = old ? strlen(old) : 0;
+	size_t len = strlen(line);
+	size_t first = 0, last = len;
+	const char *p;
+
+	if (old && !strcmp(old, line))
+		return;
+	for (p = line; *p; p++) {
+		if (*p & 0x80) {
+			old = NULL;
+			old_len = 0;
+			break;
+		}
+	}
+	if (old) {
+		for (p = old; *p; p++) {
+			if (*p & 0x80) {
+				old = NULL;
+				break;
+			}
+		}
+	}
+	if (old) {
+		while ((first < len) && (old[first] == line[first]))
+			first++;
+		/* The same length line is drawn till the last change */
+		if (old_len == len) {
+			while ((last > first) && (old[last - 1] == line[last - 1]))
+				last--;
+		}
+	}
+	clish_pipe_goto(this, row, first);
+	if (!old)
+		tinyrl_vt100_erase_line(this->term);
+	tinyrl_vt100_printf(this->term, "%.*s", (int)(last - first), line + first);
+	if (old && (old_len > len))
+		tinyrl_vt100_printf(this->term, "\x1b[K");
+}
+
+/*--------------------------------------------------------- */
+/* Read the captured output and show it. The first line is the
+ * title with the interval and the time of the run. */
+static void clish_pipe_frame_draw(clish_pipe_t *this)
+{
+	unsigned int width = 0, height = 0;
+	char **lines = NULL;
+	unsigned int lines_num = 0;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	char stamp[32];
+	char head[32];
+	char *title = NULL;
+	time_t now;
+	unsigned int i;
+
+	if (this->redraw) {
+		width = tinyrl_vt100__get_width(this->term);
+		height = tinyrl_vt100__get_height(this->term);
+		/* The last row is left for the cursor */
+		if (height > 1)
+			height--;
+	}
+
+	now = time(NULL);
+	strftime(stamp, sizeof(stamp), "%H:%M:%S", localtime(&now));
+	snprintf(head, sizeof(head), "Every %us: ", this->interval);
+	lub_string_cat(&title, head);
+	lub_string_cat(&title, this->title ? this->title : "");
+	while (width && (strlen(title) + strlen(stamp) + 1 < width))
+		lub_string_cat(&title, " ");
+	lub_string_cat(&title, " ");
+	lub_string_cat(&title, stamp);
+
+	lines = malloc(sizeof(*lines));
+	lines[lines_num++] = clish_pipe_frame_line(title, width);
+	lub_string_free(title);
+
+	rewind(this->frame);
+	while ((len = getline(&line, &size, this->frame)) > 0) {
+		char **tmp;
+
+		if (height && (lines_num >= height))
+			break;
+		if ('\n' == line[len - 1])
+			line[--len] = '\0';
+		if (!clish_pipe_match(this, line))
+			continue;
+		tmp = realloc(lines, (lines_num + 1) * sizeof(*lines));
+		if (!tmp)
+			break;
+		lines = tmp;
+		lines[lines_num++] = clish_pipe_frame_line(line, width);
+	}
+	free(line);
+
+	if (!this->redraw) {
+		/* Not a terminal, every frame is printed whole */
+		for (i = 0; i < lines_num; i++)
+			printf("%s\n", lines[i]);
+		printf("\n");
+		fflush(stdout);
+	} else {
+		if (!this->lines_num)
+			tinyrl_vt100_clear_screen(this->term);
+		for (i = 0; i < lines_num; i++)
+			clish_pipe_draw_line(this, i, (i < this->lines_num) ?
+				this->lines[i] : NULL, lines[i]);
+		for (i = lines_num; i < this->lines_num; i++) {
+			clish_pipe_goto(this, i, 0);
+			tinyrl_vt100_erase_line(this->term);
+		}
+		clish_pipe_goto(this, lines_num, 0);
+		tinyrl_vt100_oflush(this->term);
+	}
+
+	for (i = 0; i < this->lines_num; i++)
+		lub_string_free(this->lines[i]);
+	free(this->lines);
+	this->lines = lines;
+	this->lines_num = lines_num;
+}
+
+/*--------------------------------------------------------- */
+/* Wait for the next run. The "q" or Ctrl-C on the terminal or
+ * the signal stops the repeat. Returns BOOL_TRUE to run again. */
+static bool_t clish_pipe_frame_wait(clish_pipe_t *this)
+{
+	struct termios old, raw;
+	struct timespec end, now, left;
+	struct pollfd pfd;
+	sigset_t sigs;
+	bool_t tty = this->redraw;
+	bool_t result = BOOL_TRUE;
+
+	if (tty && (tcgetattr(STDIN_FILENO, &old) < 0))
+		tty = BOOL_FALSE;
+	if (tty) {
+		raw = old;
+		raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+		raw.c_cc[VMIN] = 1;
+		raw.c_cc[VTIME] = 0;
+		tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+	}
+	/* The signals blocked for the ACTION can break the wait */
+	sigemptyset(&sigs);
+	pfd.fd = STDIN_FILENO;
+	pfd.events = POLLIN;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += this->interval;
+	for (;;) {
+		int res;
+		char c = 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		left.tv_sec = end.tv_sec - now.tv_sec;
+		left.tv_nsec = end.tv_nsec - now.tv_nsec;
+		if (left.tv_nsec < 0) {
+			left.tv_sec--;
+			left.tv_nsec += 1000000000L;
+		}
+		if (left.tv_sec < 0)
+			break;
+		res = ppoll(&pfd, tty ? 1 : 0, &left, &sigs);
+		if (!res)
+			continue;
+		if (res < 0) {
+			result = BOOL_FALSE;
+			break;
+		}
+		res = read(STDIN_FILENO, &c, 1);
+		if ((res <= 0) || ('q' == c) || ('Q' == c) || (3 == c)) {
+			result = BOOL_FALSE;
+			break;
+		}
+	}
+	if (tty) {
+		tcflush(STDIN_FILENO, TCIFLUSH);
+		tcsetattr(STDIN_FILENO, TCSANOW, &old);
+	}
+
+	return result;
+}
+
+/*--------------------------------------------------------- */
+bool_t clish_shell_pipe_repeat(clish_pipe_t *this)
+{
+	if (!this || !this->interval)
+		return BOOL_FALSE;
+	clish_pipe_frame_end(this);
+	clish_pipe_frame_draw(this);
+	if (!clish_pipe_frame_wait(this))
+		return BOOL_FALSE;
+	if (clish_pipe_frame_begin(this) < 0)
+		return BOOL_FALSE;
+
+	return BOOL_TRUE;
+}
+
+/*--------------------------------------------------------- */
+int clish_shell_pipe_start(clish_context_t *context, clish_pipe_t **pipe_out)
+{
+	clish_pipe_t *this;
+	int fds[2];
+
+	assert(pipe_out);
+	*pipe_out = NULL;
+	if (!(this = clish_pipe_new(context)))
+		return 0;
+	if (clish_pipe_compile(this) || clish_pipe_open_save(this, context)) {
+		clish_pipe_free(this);
+		return -1;
+	}
+	clish_pipe_set_term_len(this);
+	*pipe_out = this;
+	/* The "repeat" captures the frames instead of the filter process */
+	if (this->interval) {
+		this->redraw = (isatty(STDIN_FILENO) && isatty(STDOUT_FILENO)) ?
+			BOOL_TRUE : BOOL_FALSE;
+		this->term = tinyrl_vt100_new(NULL, stdout);
+		this->title = clish_shell__get_full_line(context);
+		if (!this->term || (clish_pipe_frame_begin(this) < 0)) {
+			fprintf(stderr, "Warning: Can't capture the output to repeat.\n");
+			clish_pipe_frame_end(this);
+			this->interval = 0;
+		}
+		return 0;
+	}
+	/* The "no-more" only */
+	if (!this->filtered)
+		return 0;
+
+	if (!this->no_more && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO)) {
+		this->page_len = CLISH_PIPE_PAGE_LEN;
+		if (this->term_len)
+			this->page_len = (unsigned int)atoi(this->term_len);
+	}
+
+	if (pipe(fds) < 0)
+		return 0;
+	fflush(stdout);
+	fflush(stderr);
+	this->pid = fork();
+	if (this->pid == -1) {
+		fprintf(stderr, "Warning: Can't fork the output filter process.\n");
+		close(fds[0]);
+		close(fds[1]);
+		return 0;
+	}
+
+	/* Child: filter the ACTION's output */
+	if (this->pid == 0) {
+		close(fds[1]);
+		clish_pipe_filter(this, fds[0]);
+		if (this->save)
+			fclose(this->save);
+		_exit(0);
+	}
+
+	/* The file is written by the filter */
+	if (this->save) {
+		fclose(this->save);
+		this->save = NULL;
+	}
+	close(fds[0]);
+	this->real_stdout = dup(STDOUT_FILENO);
+	dup2(fds[1], STDOUT_FILENO);
+	/* The errors are filtered too unless the output is saved */
+	if (!this->filename) {
+		this->real_stderr = dup(STDERR_FILENO);
+		dup2(fds[1], STDERR_FILENO);
+	}
+	close(fds[1]);
+#ifdef FD_CLOEXEC
+	fcntl(this->real_stdout, F_SETFD,
+		fcntl(this->real_stdout, F_GETFD) | FD_CLOEXEC);
+	if (this->real_stderr != -1)
+		fcntl(this->real_stderr, F_SETFD,
+			fcntl(this->real_stderr, F_GETFD) | FD_CLOEXEC);
+#endif
+
+	return 0;
+}
+
+/*--------------------------------------------------------- */
+void clish_shell_pipe_stop(clish_pipe_t *this)
+{
+	if (!this)
+		return;
+
+	clish_pipe_restore_term_len(this);
+	/* The last run wasn't shown if the repeat is stopped by error */
+	if (this->interval && (this->real_stdout != -1)) {
+		clish_pipe_frame_end(this);
+		clish_pipe_frame_draw(this);
+	}
+	if (this->pid > 0) {
+		/* Close the write end so the filter gets EOF */
+		fflush(stdout);
+		fflush(stderr);
+		dup2(this->real_stdout, STDOUT_FILENO);
+		close(this->real_stdout);
+		if (this->real_stderr != -1) {
+			dup2(this->real_stderr, STDERR_FILENO);
+			close(this->real_stderr);
+		}
+		while ((waitpid(this->pid, NULL, 0) < 0) && (EINTR == errno));
+	}
+	clish_pipe_free(this);
+}
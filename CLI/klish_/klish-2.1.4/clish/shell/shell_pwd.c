@@ -113,6 +113,15 @@ clish_pargv_t *clish_shell__get_pwd_pargv(const clish_shell_t *this, unsigned in
 	return this->pwdv[index]->pargv;
 }
 
+/*--------------------------------------------------------- */
+lub_bintree_t *clish_shell__get_pwd_viewid(const clish_shell_t *this, unsigned int index)
+{
+	if (index >= this->pwdc)
+		return NULL;
+
+	return &this->pwdv[index]->viewid;
+}
+
 /*--------------------------------------------------------- */
 char *clish_shell__get_pwd_cmd(const clish_shell_t *this, unsigned int index)
 {
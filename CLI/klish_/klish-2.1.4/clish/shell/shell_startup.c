@@ -5,6 +5,7 @@
 #include <assert.h>
 
 #include "lub/string.h"
+#include "lub/prof.h"
 
 /* Default hooks */
 const char* clish_plugin_default_hook[] = {
@@ -12,7 +13,8 @@ const char* clish_plugin_default_hook[] = {
 	"clish_script@clish",
 	NULL,
 	"clish_hook_config@clish",
-	"clish_hook_log@clish"
+	"clish_hook_log@clish",
+	"clish_hook_stats@clish"
 };
 
 /*----------------------------------------------------------- */
@@ -76,7 +78,9 @@ static clish_ptype_t * resolve_ptype(clish_shell_t *this, clish_param_t *param)
 		return NULL;
 
 	/* Resolve PARAM's PTYPE */
+	lub_prof_begin("ptype");
 	ptype = clish_shell_find_ptype(this, clish_param__get_ptype_name(param));
+	lub_prof_end();
 	if (!ptype) {
 		fprintf(stderr, "Error: Unresolved PTYPE \"%s\" in PARAM \"%s\"\n",
 			clish_param__get_ptype_name(param),
@@ -89,6 +93,24 @@ static clish_ptype_t * resolve_ptype(clish_shell_t *this, clish_param_t *param)
 	return ptype;
 }
 
+/*-------------------------------------------------------- */
+/* Check access rights using access hook.
+ * Returns non-zero if access is denied.
+ */
+static int check_access(clish_shell_t *this, clish_hook_access_fn_t *access_fn,
+	const char *access)
+{
+	int res;
+
+	if (!access_fn || !access)
+		return 0;
+	lub_prof_begin("access");
+	res = access_fn(this, access);
+	lub_prof_end();
+
+	return res;
+}
+
 /*-------------------------------------------------------- */
 /* Static recursive function to iterate parameters. Logically it's the
  * part of clish_shell_prepare() function.
@@ -107,8 +129,7 @@ static int iterate_paramv(clish_shell_t *this, clish_paramv_t *paramv,
 			return -1;
 
 		/* Check access for PARAM */
-		if (access_fn && clish_param__get_access(param) &&
-			access_fn(this, clish_param__get_access(param))) {
+		if (check_access(this, access_fn, clish_param__get_access(param))) {
 #ifdef DEBUG
 			fprintf(stderr, "Warning: Access denied. Remove PARAM \"%s\"\n",
 				clish_param__get_name(param));
@@ -149,6 +170,7 @@ int clish_shell_prepare(clish_shell_t *this)
 	clish_hook_access_fn_t *access_fn = NULL;
 	clish_paramv_t *paramv;
 	int i = 0;
+	int res;
 
 	/* Add statically linked plugins */
 	while (clish_plugin_builtin_list[i].name) {
@@ -181,12 +203,20 @@ int clish_shell_prepare(clish_shell_t *this)
 	}
 
 	/* Load plugins and link symbols */
-	if (clish_shell_load_plugins(this) < 0)
+	lub_prof_begin("plugin load");
+	res = clish_shell_load_plugins(this);
+	lub_prof_end();
+	if (res < 0)
 		return -1;
-	if (clish_shell_link_plugins(this) < 0)
+	lub_prof_begin("symbol link");
+	res = clish_shell_link_plugins(this);
+	lub_prof_end();
+	if (res < 0)
 		return -1;
 
-	access_fn = clish_sym__get_func(clish_shell_get_hook(this, CLISH_SYM_TYPE_ACCESS));
+	/* The deferred access rights are checked by clish_shell_prune_access() */
+	if (!this->defer_access)
+		access_fn = clish_sym__get_func(clish_shell_get_hook(this, CLISH_SYM_TYPE_ACCESS));
 
 	/* Iterate the VIEWs */
 	view_tree = this->view_tree;
@@ -197,8 +227,7 @@ int clish_shell_prepare(clish_shell_t *this)
 		old_view_iter = view_iter;
 		view_iter = lub_list_node__get_next(view_iter);
 		/* Check access rights for the VIEW */
-		if (access_fn && clish_view__get_access(view) &&
-			access_fn(this, clish_view__get_access(view))) {
+		if (check_access(this, access_fn, clish_view__get_access(view))) {
 #ifdef DEBUG
 			fprintf(stderr, "Warning: Access denied. Remove VIEW \"%s\"\n",
 				clish_view__get_name(view));
@@ -235,10 +264,10 @@ int clish_shell_prepare(clish_shell_t *this)
 			/* Check access rights for the NAMESPACE */
 			if (access_fn && (
 				/* Check NAMESPASE owned access */
-				(clish_nspace__get_access(nspace) && access_fn(this, clish_nspace__get_access(nspace)))
+				check_access(this, access_fn, clish_nspace__get_access(nspace))
 				||
 				/* Check referenced VIEW's access */
-				(clish_view__get_access(ref_view) && access_fn(this, clish_view__get_access(ref_view)))
+				check_access(this, access_fn, clish_view__get_access(ref_view))
 				)) {
 #ifdef DEBUG
 				fprintf(stderr, "Warning: Access denied. Remove NAMESPACE \"%s\" from \"%s\" VIEW\n",
@@ -260,8 +289,7 @@ int clish_shell_prepare(clish_shell_t *this)
 			clish_param_t *args = NULL;
 
 			/* Check access rights for the COMMAND */
-			if (access_fn && clish_command__get_access(cmd) &&
-				access_fn(this, clish_command__get_access(cmd))) {
+			if (check_access(this, access_fn, clish_command__get_access(cmd))) {
 #ifdef DEBUG
 				fprintf(stderr, "Warning: Access denied. Remove COMMAND \"%s\" from VIEW \"%s\"\n",
 					clish_command__get_name(cmd), clish_view__get_name(view));
@@ -307,8 +335,7 @@ int clish_shell_prepare(clish_shell_t *this)
 				/* Check access rights for newly constructed COMMAND.
 				   Now the link has access filed from referenced command.
 				 */
-				if (access_fn && clish_command__get_access(cmd) &&
-					access_fn(this, clish_command__get_access(cmd))) {
+				if (check_access(this, access_fn, clish_command__get_access(cmd))) {
 #ifdef DEBUG
 					fprintf(stderr, "Warning: Access denied. Remove COMMAND \"%s\" from VIEW \"%s\"\n",
 						clish_command__get_name(cmd), clish_view__get_name(view));
@@ -335,7 +362,131 @@ int clish_shell_prepare(clish_shell_t *this)
 	return 0;
 }
 
+/*-------------------------------------------------------- */
+/* Static recursive function to remove the PARAMs denied by
+ * access hook. The PTYPEs are already resolved.
+ */
+static int prune_paramv(clish_shell_t *this, clish_paramv_t *paramv,
+	clish_hook_access_fn_t *access_fn)
+{
+	int i = 0;
+	clish_param_t *param;
+
+	while((param = clish_paramv__get_param(paramv, i))) {
+		if (check_access(this, access_fn, clish_param__get_access(param))) {
+			if (clish_paramv_remove(paramv, i) < 0) {
+				fprintf(stderr, "Error: Some system problem\n");
+				return -1;
+			}
+			clish_param_delete(param);
+			continue; /* Don't increment index */
+		}
+		if (prune_paramv(this, clish_param__get_paramv(param), access_fn) < 0)
+			return -1;
+		i++;
+	}
+
+	return 0;
+}
+
+/*-------------------------------------------------------- */
+/* Check access rights for the schema prepared with deferred
+ * access checking. It's used when the schema is prepared once
+ * and then executed on behalf of different users. The result is
+ * the same as clish_shell_prepare() with immediate access check.
+ */
+int clish_shell_prune_access(clish_shell_t *this)
+{
+	clish_command_t *cmd;
+	clish_view_t *view;
+	clish_nspace_t *nspace;
+	lub_list_t *view_tree, *nspace_tree;
+	lub_list_node_t *nspace_iter, *view_iter;
+	lub_bintree_t *cmd_tree;
+	lub_bintree_iterator_t cmd_iter;
+	clish_hook_access_fn_t *access_fn = NULL;
+
+	access_fn = clish_sym__get_func(clish_shell_get_hook(this, CLISH_SYM_TYPE_ACCESS));
+	if (!access_fn)
+		return 0;
+
+	/* The denied VIEWs are removed at the end only. NAMESPACEs
+	   and command links can reference them till that moment. */
+	view_tree = this->view_tree;
+	for (view_iter = lub_list__get_head(view_tree); view_iter;
+		view_iter = lub_list_node__get_next(view_iter)) {
+		view = (clish_view_t *)lub_list_node__get_data(view_iter);
+		if (check_access(this, access_fn, clish_view__get_access(view)))
+			continue;
+
+		/* Iterate the NAMESPACEs */
+		nspace_tree = clish_view__get_nspaces(view);
+		nspace_iter = lub_list__get_head(nspace_tree);
+		while(nspace_iter) {
+			clish_view_t *ref_view;
+			lub_list_node_t *old_nspace_iter;
+			nspace = (clish_nspace_t *)lub_list_node__get_data(nspace_iter);
+			old_nspace_iter = nspace_iter;
+			nspace_iter = lub_list_node__get_next(nspace_iter);
+			ref_view = clish_nspace__get_view(nspace);
+			if (check_access(this, access_fn, clish_nspace__get_access(nspace))
+				||
+				check_access(this, access_fn, clish_view__get_access(ref_view))
+				) {
+				lub_list_del(nspace_tree, old_nspace_iter);
+				lub_list_node_free(old_nspace_iter);
+				clish_nspace_delete(nspace);
+			}
+		}
+
+		/* Iterate the COMMANDs */
+		cmd_tree = clish_view__get_tree(view);
+		cmd = lub_bintree_findfirst(cmd_tree);
+		for (lub_bintree_iterator_init(&cmd_iter, cmd_tree, cmd);
+			cmd; cmd = lub_bintree_iterator_next(&cmd_iter)) {
+			const clish_command_t *orig;
+			clish_view_t *orig_view;
+
+			/* The link shares access string with referenced
+			   COMMAND. So the referenced COMMAND is alive if
+			   the link passes this check. */
+			if (!check_access(this, access_fn, clish_command__get_access(cmd))) {
+				orig = clish_command__get_orig(cmd);
+				if (orig == cmd) {
+					if (prune_paramv(this, clish_command__get_paramv(cmd), access_fn) < 0)
+						return -1;
+					continue;
+				}
+				orig_view = clish_command__get_pview(orig);
+				if (!check_access(this, access_fn, clish_view__get_access(orig_view)))
+					continue;
+			}
+			lub_bintree_remove(cmd_tree, cmd);
+			clish_command_delete(cmd);
+		}
+	}
+
+	/* Remove the denied VIEWs */
+	view_iter = lub_list__get_head(view_tree);
+	while(view_iter) {
+		lub_list_node_t *old_view_iter;
+		view = (clish_view_t *)lub_list_node__get_data(view_iter);
+		old_view_iter = view_iter;
+		view_iter = lub_list_node__get_next(view_iter);
+		if (check_access(this, access_fn, clish_view__get_access(view))) {
+			lub_list_del(view_tree, old_view_iter);
+			lub_list_node_free(old_view_iter);
+			clish_view_delete(view);
+		}
+	}
+	this->defer_access = BOOL_FALSE;
+
+	return 0;
+}
+
 CLISH_SET_STR(shell, default_shebang);
 CLISH_GET_STR(shell, default_shebang);
+CLISH_SET(shell, bool_t, defer_access);
+CLISH_GET(shell, bool_t, defer_access);
 
 
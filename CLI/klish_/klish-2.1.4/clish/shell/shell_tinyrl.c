@@ -10,9 +10,11 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <poll.h>
 #include <errno.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "tinyrl/tinyrl.h"
 #include "tinyrl/history.h"
@@ -304,6 +306,7 @@ static bool_t clish_shell_tinyrl_key_enter(tinyrl_t *this, int key)
 	int cmderrlen = 0;
 	int promtlen = 0;
 	int loopindex=0;
+	struct timespec start, end;
 
 	/* Inc line counter */
 	if (shell->current_file)
@@ -319,6 +322,7 @@ static bool_t clish_shell_tinyrl_key_enter(tinyrl_t *this, int key)
 		return BOOL_TRUE;
 	}
 
+	clock_gettime(CLOCK_MONOTONIC, &start);
 	clish_shell_tinyrl_complete_ignore_error(this);
 	line = tinyrl__get_line(this);
 
@@ -409,6 +413,9 @@ static bool_t clish_shell_tinyrl_key_enter(tinyrl_t *this, int key)
 		/* we've got a command so check the syntax */
 		arg_status = clish_shell_parse(shell,
 			line, &context->cmd, &context->pargv, context, &err_len);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		shell->parse_time = (end.tv_sec - start.tv_sec) * 1000000 +
+			(end.tv_nsec - start.tv_nsec) / 1000;
 
 		switch (arg_status) {
 		case CLISH_LINE_OK:
@@ -574,7 +581,10 @@ char **clish_shell_tinyrl_completion(tinyrl_t * tinyrl,
 	/* Matches were found */
 	if (lub_argv__get_count(matches) > 0) {
 		unsigned i;
-		char *subst = lub_string_dup(lub_argv__get_arg(matches, 0));
+		char *subst;
+		/* List the matches in the natural order like the help does */
+		lub_argv_natsort(matches);
+		subst = lub_string_dup(lub_argv__get_arg(matches, 0));
 		/* Find out substitution */
 		for (i = 1; i < lub_argv__get_count(matches); i++) {
 			char *p = subst;
@@ -750,6 +760,41 @@ FILE * clish_shell__get_istream(const clish_shell_t * this)
 	return tinyrl__get_istream(this->tinyrl);
 }
 
+/*-------------------------------------------------------- */
+/* Whether the next line is already available while the current one
+ * is executed. It's true for the pasted text and the files.
+ */
+bool_t clish_shell__get_input_pending(const clish_shell_t *this)
+{
+	FILE *istream = tinyrl__get_istream(this->tinyrl);
+	struct pollfd pfd;
+	int c;
+
+	if (!istream)
+		return BOOL_FALSE;
+	pfd.fd = fileno(istream);
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) <= 0)
+		return BOOL_FALSE;
+	/* The terminal is read unbuffered */
+	if (tinyrl__get_isatty(this->tinyrl))
+		return BOOL_TRUE;
+	/* The end of file is readable too */
+	if (EOF == (c = getc(istream)))
+		return BOOL_FALSE;
+	ungetc(c, istream);
+
+	return BOOL_TRUE;
+}
+
+/*-------------------------------------------------------- */
+/* The time of the completion and parsing of the last line, usec */
+unsigned long clish_shell__get_parse_time(const clish_shell_t *this)
+{
+	return this->parse_time;
+}
+
 /*-------------------------------------------------------- */
 void clish_shell__set_interactive(clish_shell_t * this, bool_t interactive)
 {
@@ -13,6 +13,7 @@
 #include "lub/system.h"
 #include "lub/conv.h"
 #include "lub/list.h"
+#include "lub/prof.h"
 #include "../toml.h"
 #include <stdlib.h>
 #include <string.h>
@@ -175,7 +176,9 @@ int clish_shell_load_scheme(clish_shell_t *this, const char *xml_path, const cha
 #endif
 
         /* Load capability list once */
+        lub_prof_begin("capability");
         clish_capability_load();
+        lub_prof_end();
 
         /* Use the default path */
         if (!path)
@@ -216,8 +219,12 @@ int clish_shell_load_scheme(clish_shell_t *this, const char *xml_path, const cha
 			fprintf(stderr, "Parse XML-file: %s\n", filename);
 #endif
 			/* Load current XML file */
+			lub_prof_begin(entry->d_name);
+			lub_prof_begin("parse");
 			doc = clish_xmldoc_read(filename);
+			lub_prof_end();
 			if (!clish_xmldoc_is_valid(doc)) {
+				lub_prof_end();
 				int errcaps = clish_xmldoc_error_caps(doc);
 				printf("Unable to open file '%s'", filename);
 				if ((errcaps & CLISH_XMLERR_LINE) == CLISH_XMLERR_LINE)
@@ -238,8 +245,11 @@ int clish_shell_load_scheme(clish_shell_t *this, const char *xml_path, const cha
 
 			if (clish_xslt_is_valid(xslt)) {
 				clish_xmldoc_t *tmp = NULL;
+				lub_prof_begin("xslt");
 				tmp = clish_xslt_apply(doc, xslt);
+				lub_prof_end();
 				if (!clish_xmldoc_is_valid(tmp)) {
+					lub_prof_end();
 					fprintf(stderr, CLISH_XML_ERROR_STR"Can't load XSLT file %s\n", xslt_path);
 					goto error;
 				}
@@ -251,9 +261,12 @@ int clish_shell_load_scheme(clish_shell_t *this, const char *xml_path, const cha
 				clish_xslt_release(xslt);
 #endif
 			root = clish_xmldoc_get_root(doc);
+			lub_prof_begin("process");
 			r = process_node(this, root, NULL);
+			lub_prof_end();
 			clish_xmldoc_release(doc);
 			doc = NULL;
+			lub_prof_end();
 
 			/* Error message */
 			if (r) {
@@ -1410,6 +1423,8 @@ static int process_hook(clish_shell_t *shell, clish_xmlnode_t *element,
 		type = CLISH_SYM_TYPE_CONFIG;
 	else if (!strcmp(name, "log"))
 		type = CLISH_SYM_TYPE_LOG;
+	else if (!strcmp(name, "stats"))
+		type = CLISH_SYM_TYPE_STATS;
 	if (CLISH_SYM_TYPE_NONE == type) {
 		fprintf(stderr, CLISH_XML_ERROR_STR"Unknown HOOK name %s.\n", name);
 		goto error;
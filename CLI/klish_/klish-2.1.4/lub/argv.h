@@ -74,6 +74,8 @@ void lub_argv__free_argv(char **argv);
 char *lub_argv__get_line(const lub_argv_t * instance);
 void lub_argv_add(lub_argv_t * instance, const char *text);
 bool_t lub_argv__swap_arg(const lub_argv_t * instance,unsigned index1, unsigned index2);
+/* Sort the arguments in the natural order, see lub_string_natcmp() */
+void lub_argv_natsort(lub_argv_t * instance);
 
 _END_C_DECL
 #endif				/* _lub_argv_h */
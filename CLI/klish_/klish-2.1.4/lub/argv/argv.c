@@ -218,3 +218,18 @@ bool_t lub_argv__swap_arg (const lub_argv_t *this, unsigned int index1, unsigned
 }
 
 /*--------------------------------------------------------- */
+static int lub_argv_natcmp(const void *first, const void *second)
+{
+	const lub_arg_t *a = first;
+	const lub_arg_t *b = second;
+
+	return lub_string_natcmp(a->arg, b->arg);
+}
+
+/*--------------------------------------------------------- */
+void lub_argv_natsort(lub_argv_t * this)
+{
+	if (!this || (this->argc < 2))
+		return;
+	qsort(this->argv, this->argc, sizeof(*this->argv), lub_argv_natcmp);
+}
@@ -0,0 +1,27 @@
+/*
+ * prof.h
+ *
+ * Simple phase profiler. The phases are nested by begin/end calls.
+ * The repeated phase with the same name and parent is accumulated.
+ * The calls are no-op until profiler is enabled.
+ */
+#ifndef _lub_prof_h
+#define _lub_prof_h
+
+#include <stdio.h>
+
+#include "lub/c_decl.h"
+#include "lub/types.h"
+
+_BEGIN_C_DECL
+
+void lub_prof_enable(void);
+bool_t lub_prof_enabled(void);
+void lub_prof_begin(const char *name);
+void lub_prof_end(void);
+void lub_prof_dump(FILE *out, bool_t json);
+void lub_prof_free(void);
+
+_END_C_DECL
+
+#endif
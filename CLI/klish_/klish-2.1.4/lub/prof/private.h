@@ -0,0 +1,16 @@
+/*
+ * prof private.h
+ */
+#include "lub/prof.h"
+
+/* Max nesting of the phases */
+#define LUB_PROF_DEPTH_MAX 16
+
+typedef struct {
+	char *name;
+	int parent; /* Index of parent phase or -1 */
+	unsigned int depth;
+	unsigned int count; /* Number of begin/end pairs */
+	double start; /* Offset of the first begin, ms */
+	double elapsed; /* Accumulated duration, ms */
+} lub_prof_phase_t;
@@ -0,0 +1,172 @@
+/*
+ * prof.c
+ */
+#include "private.h"
+#include "lub/string.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static bool_t enabled = BOOL_FALSE;
+static struct timespec origin;
+static lub_prof_phase_t *phases = NULL;
+static unsigned int phases_num = 0;
+static unsigned int phases_max = 0;
+/* Stack of the open phases */
+static int stack[LUB_PROF_DEPTH_MAX];
+static double stack_begin[LUB_PROF_DEPTH_MAX];
+static unsigned int stack_depth = 0;
+
+/*--------------------------------------------------------- */
+static double prof_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec - origin.tv_sec) * 1000.0 +
+		(ts.tv_nsec - origin.tv_nsec) / 1000000.0;
+}
+
+/*--------------------------------------------------------- */
+void lub_prof_enable(void)
+{
+	if (enabled)
+		return;
+	clock_gettime(CLOCK_MONOTONIC, &origin);
+	enabled = BOOL_TRUE;
+}
+
+/*--------------------------------------------------------- */
+bool_t lub_prof_enabled(void)
+{
+	return enabled;
+}
+
+/*--------------------------------------------------------- */
+void lub_prof_begin(const char *name)
+{
+	int parent;
+	int i;
+	lub_prof_phase_t *phase = NULL;
+
+	if (!enabled)
+		return;
+	/* Too deep phases are not measured but must be balanced */
+	if (stack_depth >= LUB_PROF_DEPTH_MAX) {
+		stack_depth++;
+		return;
+	}
+	parent = stack_depth ? stack[stack_depth - 1] : -1;
+
+	/* Accumulate the repeated phase */
+	for (i = (int)phases_num - 1; i > parent; i--) {
+		if ((phases[i].parent == parent) &&
+			!strcmp(phases[i].name, name)) {
+			phase = &phases[i];
+			break;
+		}
+	}
+	if (!phase) {
+		if (phases_num == phases_max) {
+			lub_prof_phase_t *tmp;
+			unsigned int max = phases_max ? phases_max * 2 : 64;
+			tmp = realloc(phases, max * sizeof(*phases));
+			if (!tmp) {
+				stack_depth++;
+				return;
+			}
+			phases = tmp;
+			phases_max = max;
+		}
+		i = phases_num++;
+		phase = &phases[i];
+		phase->name = lub_string_dup(name);
+		phase->parent = parent;
+		phase->depth = stack_depth;
+		phase->count = 0;
+		phase->start = prof_now();
+		phase->elapsed = 0;
+	}
+	stack[stack_depth] = i;
+	stack_begin[stack_depth] = prof_now();
+	stack_depth++;
+}
+
+/*--------------------------------------------------------- */
+void lub_prof_end(void)
+{
+	lub_prof_phase_t *phase;
+
+	if (!enabled || !stack_depth)
+		return;
+	stack_depth--;
+	if (stack_depth >= LUB_PROF_DEPTH_MAX)
+		return;
+	phase = &phases[stack[stack_depth]];
+	phase->elapsed += prof_now() - stack_begin[stack_depth];
+	phase->count++;
+}
+
+/*--------------------------------------------------------- */
+static void prof_dump_str(FILE *out, const char *str)
+{
+	fputc('"', out);
+	for (; *str; str++) {
+		if (('"' == *str) || ('\\' == *str))
+			fputc('\\', out);
+		if ((unsigned char)*str < 0x20)
+			continue;
+		fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+/*--------------------------------------------------------- */
+void lub_prof_dump(FILE *out, bool_t json)
+{
+	unsigned int i;
+
+	if (!enabled)
+		return;
+
+	if (json) {
+		fprintf(out, "{\"total_ms\": %.3f, \"phases\": [", prof_now());
+		for (i = 0; i < phases_num; i++) {
+			lub_prof_phase_t *phase = &phases[i];
+			fprintf(out, "%s\n  {\"name\": ", i ? "," : "");
+			prof_dump_str(out, phase->name);
+			fprintf(out, ", \"parent\": %d, \"depth\": %u, "
+				"\"count\": %u, \"start_ms\": %.3f, "
+				"\"elapsed_ms\": %.3f}",
+				phase->parent, phase->depth, phase->count,
+				phase->start, phase->elapsed);
+		}
+		fprintf(out, "\n]}\n");
+		return;
+	}
+
+	fprintf(out, "%10s %10s %6s  %s\n", "start,ms", "time,ms", "count", "phase");
+	for (i = 0; i < phases_num; i++) {
+		lub_prof_phase_t *phase = &phases[i];
+		fprintf(out, "%10.3f %10.3f %6u  %*s%s\n",
+			phase->start, phase->elapsed, phase->count,
+			phase->depth * 2, "", phase->name);
+	}
+	fprintf(out, "%10s %10.3f %6s  %s\n", "", prof_now(), "", "total");
+}
+
+/*--------------------------------------------------------- */
+void lub_prof_free(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < phases_num; i++)
+		lub_string_free(phases[i].name);
+	free(phases);
+	phases = NULL;
+	phases_num = 0;
+	phases_max = 0;
+	stack_depth = 0;
+	enabled = BOOL_FALSE;
+}
@@ -183,6 +183,34 @@ int lub_string_nocasecmp(
          * The second string for the comparison 
          */
 				const char *ct);
+/**
+ * This operation compares string cs to string ct in the natural order.
+ * The runs of digits are compared by their numeric value, the other
+ * characters are compared in a case insensitive manner. So "Ethernet4"
+ * goes before "Ethernet48" and "Eth1/2" goes before "Eth1/10".
+ * The strings equal in this order are ordered by the leading zeros
+ * of the numbers and then case sensitively, so the order is total.
+ *
+ * \pre 
+ * - none
+ * 
+ * \return 
+ * - < 0 if cs < ct
+ * -   0 if cs == ct
+ * - > 0 if cs > ct
+ *
+ * \post 
+ * - none
+ */
+int lub_string_natcmp(
+	/**
+         * The first string for the comparison
+         */
+				const char *cs,
+	/**
+         * The second string for the comparison 
+         */
+				const char *ct);
 /**
  * This operation performs a case insensitive search for a substring within
  * another string.
@@ -185,6 +185,54 @@ int lub_string_nocasecmp(const char *cs, const char *ct)
 	return result;
 }
 
+/*--------------------------------------------------------- */
+int lub_string_natcmp(const char *cs, const char *ct)
+{
+	const char *s = cs;
+	const char *t = ct;
+	int zeros = 0;
+
+	while (*s && *t) {
+		int a, b;
+
+		if (lub_ctype_isdigit(*s) && lub_ctype_isdigit(*t)) {
+			const char *ns = s;
+			const char *nt = t;
+			size_t ls, lt;
+			int result;
+
+			/* The longer number without leading zeros is bigger */
+			while ('0' == *ns)
+				ns++;
+			while ('0' == *nt)
+				nt++;
+			/* The first difference of leading zeros breaks the tie */
+			if (!zeros)
+				zeros = (int)(ns - s) - (int)(nt - t);
+			for (s = ns; lub_ctype_isdigit(*s); s++);
+			for (t = nt; lub_ctype_isdigit(*t); t++);
+			ls = s - ns;
+			lt = t - nt;
+			if (ls != lt)
+				return (ls < lt) ? -1 : 1;
+			result = strncmp(ns, nt, ls);
+			if (result)
+				return result;
+			continue;
+		}
+		a = (unsigned char)lub_ctype_tolower(*s++);
+		b = (unsigned char)lub_ctype_tolower(*t++);
+		if (a != b)
+			return a - b;
+	}
+	if (*s || *t)
+		return *s ? 1 : -1;
+	if (zeros)
+		return zeros;
+
+	return strcmp(cs, ct);
+}
+
 /*--------------------------------------------------------- */
 char *lub_string_tolower(const char *str)
 {
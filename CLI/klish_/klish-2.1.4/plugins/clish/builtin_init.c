@@ -19,6 +19,8 @@ CLISH_PLUGIN_INIT(clish)
 		"clish_hook_config", CLISH_SYM_TYPE_CONFIG);
 	clish_plugin_add_phook(plugin, clish_hook_log,
 		"clish_hook_log", CLISH_SYM_TYPE_LOG);
+	clish_plugin_add_phook(plugin, clish_hook_stats,
+		"clish_hook_stats", CLISH_SYM_TYPE_STATS);
 
 	/* Add builtin syms */
 	clish_plugin_add_psym(plugin, clish_close, "clish_close");
@@ -34,6 +36,9 @@ CLISH_PLUGIN_INIT(clish)
 	clish_plugin_add_psym(plugin, clish_restcl, "clish_restcl");
 	clish_plugin_add_psym(plugin, clish_pyobj, "clish_pyobj");
 	clish_plugin_add_psym(plugin, clish_setenv, "clish_setenv");
+	clish_plugin_add_psym(plugin, clish_stats, "clish_stats");
+
+	clish_plugin__set_fini(plugin, clish_plugin_clish_fini);
 
 	nos_extn_init();
 
@@ -43,3 +48,16 @@ CLISH_PLUGIN_INIT(clish)
 }
 
 /*----------------------------------------------------------- */
+/* The deferred config requests are done before the shell exits */
+CLISH_PLUGIN_FINI(clish_plugin_clish_fini)
+{
+	nos_extn_rest_barrier();
+	cli_stats_dump();
+
+	clish_shell = clish_shell; /* Happy compiler */
+	plugin = plugin; /* Happy compiler */
+
+	return 0;
+}
+
+/*----------------------------------------------------------- */
@@ -20,14 +20,74 @@
 #include "lub/dump.h"
 #include "private.h"
 #include "logging.h"
+#include "clish/plugin/mgmt_clish_utils.h"
 
 #include <stdio.h>
 #include <Python.h>
 #include <stdarg.h>
 #include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* The actioner modules and their run() callables are kept across the
+ * commands. The module is reloaded when its file changes if
+ * CLISH_PYOBJ_RELOAD is set, that is for development. */
+static PyObject *pyobj_cache = NULL;
+static int pyobj_reload = 0;
+
+/* The full collection and heap trim are done when the resident size
+ * grew by PYOBJ_TRIM_THRESHOLD since the last trim, not after every
+ * command. The cyclic GC runs by itself in between. */
+#define PYOBJ_TRIM_THRESHOLD (16 * 1024 * 1024)
+static long pyobj_rss_base = 0;
+
+static PyGILState_STATE fork_gstate;
+
+extern PyObject *PyInit_clish_rest(void);
+extern PyObject *PyInit_clish_natsort(void);
+extern PyObject *PyInit_clish_table(void);
+extern PyObject *PyInit_clish_cbor(void);
 
 void pyobj_init() {
+    PyImport_AppendInittab("clish_rest", PyInit_clish_rest);
+    PyImport_AppendInittab("clish_natsort", PyInit_clish_natsort);
+    PyImport_AppendInittab("clish_table", PyInit_clish_table);
+    PyImport_AppendInittab("clish_cbor", PyInit_clish_cbor);
     Py_Initialize();
+    pyobj_cache = PyDict_New();
+    pyobj_reload = (getenv("CLISH_PYOBJ_RELOAD") != NULL);
+    /* Release the GIL taken by the initialization. Every caller
+       takes it with PyGILState_Ensure(), so the background threads
+       can run Python code while the shell waits for input. */
+    PyEval_SaveThread();
+}
+
+static void pyobj_fork_prepare(void) {
+    fork_gstate = PyGILState_Ensure();
+    PyOS_BeforeFork();
+}
+
+static void pyobj_fork_parent(void) {
+    PyOS_AfterFork_Parent();
+    PyGILState_Release(fork_gstate);
+}
+
+static void pyobj_fork_child(void) {
+    PyOS_AfterFork_Child();
+    PyGILState_Release(fork_gstate);
+}
+
+/* The interpreter state must be fixed up in every process forked
+ * by the session server template, like os.fork() does it. */
+void pyobj_register_fork() {
+    pthread_atfork(pyobj_fork_prepare, pyobj_fork_parent, pyobj_fork_child);
+}
+
+/* Called by the SIGINT handler of the action. The KeyboardInterrupt
+ * is raised in the shell thread like by the handler of Python. */
+void pyobj_interrupt() {
+    PyErr_SetInterrupt();
 }
 
 static void pyobj_handle_error() {
@@ -42,6 +102,15 @@ static void pyobj_handle_error() {
     PyErr_Fetch(&type, &value, &traceback);
     PyErr_NormalizeException(&type, &value, &traceback);
 
+    /* The command interrupted by Ctrl-C just stops */
+    if (PyErr_GivenExceptionMatches(type, PyExc_KeyboardInterrupt)) {
+        syslog(LOG_DEBUG, "clish_pyobj: Interrupted");
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(traceback);
+        return;
+    }
+
     if (!PyErr_GivenExceptionMatches(type, PyExc_SystemExit)) {
        lub_dump_printf("%%Error: Internal error.\n");
     }
@@ -82,9 +151,13 @@ static void pyobj_handle_error() {
 
 int pyobj_update_environ(const char *key, const char *val) {
 
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+
     PyObject *module = PyImport_ImportModule("os");
     if (module == NULL) {
         pyobj_handle_error();
+        PyGILState_Release(gstate);
         return -1;
     }
 
@@ -104,6 +177,7 @@ int pyobj_update_environ(const char *key, const char *val) {
 
     if (PyErr_Occurred()) {
         pyobj_handle_error();
+        PyGILState_Release(gstate);
         return 1;
     }
 
@@ -113,114 +187,435 @@ int pyobj_update_environ(const char *key, const char *val) {
     Py_XDECREF(pMap);
     Py_XDECREF(args);
 
+    PyGILState_Release(gstate);
     return 0;
 }
 
+/* os.environ is a snapshot taken by Py_Initialize(). Bring it in
+ * line with the process environment of the forked session. */
+int pyobj_sync_environ() {
+    extern char **environ;
+    char **env;
+    Py_ssize_t i;
+
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+
+    PyObject *module = PyImport_ImportModule("os");
+    if (module == NULL) {
+        pyobj_handle_error();
+        PyGILState_Release(gstate);
+        return -1;
+    }
+
+    PyObject *env_obj = PyObject_GetAttrString(module, "environ");
+    PyObject *pMap = PyDict_New();
+    for (env = environ; *env; env++) {
+        const char *sep = strchr(*env, '=');
+        if (!sep)
+            continue;
+        PyObject *k_obj = PyUnicode_FromStringAndSize(*env, sep - *env);
+        PyObject *v_obj = PyUnicode_FromString(sep + 1);
+        if (k_obj && v_obj)
+            PyDict_SetItem(pMap, k_obj, v_obj);
+        Py_XDECREF(k_obj);
+        Py_XDECREF(v_obj);
+    }
+    PyErr_Clear();
+
+    /* Deleting a stale key unsets it in the process environment
+       too, that is harmless since it's not there anymore */
+    PyObject *keys = PySequence_List(env_obj);
+    for (i = 0; keys && i < PyList_Size(keys); i++) {
+        PyObject *key = PyList_GetItem(keys, i);
+        if (!PyDict_Contains(pMap, key))
+            PyObject_DelItem(env_obj, key);
+    }
+
+    PyObject *ret = PyObject_CallMethod(env_obj, "update", "(O)", pMap);
+    if (PyErr_Occurred()) {
+        pyobj_handle_error();
+    }
+
+    Py_XDECREF(ret);
+    Py_XDECREF(keys);
+    Py_XDECREF(pMap);
+    Py_XDECREF(env_obj);
+    Py_XDECREF(module);
+
+    PyGILState_Release(gstate);
+    return ret ? 0 : 1;
+}
+
+/* Import the module ahead of the first command which needs it.
+ * The module stays in sys.modules, so PyImport_Import() of
+ * call_pyobj() finds it there. */
+int pyobj_preload(const char *name) {
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+
+    PyObject *module = PyImport_ImportModule(name);
+    if (module == NULL) {
+        syslog(LOG_DEBUG, "clish_pyobj: Failed to preload module %s", name);
+        PyErr_Clear();
+    }
+    Py_XDECREF(module);
+
+    PyGILState_Release(gstate);
+    return module ? 0 : -1;
+}
+
+static double pyobj_module_mtime(PyObject *module) {
+    struct stat st;
+    const char *path;
+    double mtime = 0;
+
+    PyObject *file = PyObject_GetAttrString(module, "__file__");
+    if (file && PyUnicode_Check(file)) {
+        path = PyUnicode_AsUTF8(file);
+        if (path && !stat(path, &st))
+            mtime = st.st_mtim.tv_sec + st.st_mtim.tv_nsec / 1e9;
+    }
+    Py_XDECREF(file);
+    PyErr_Clear();
+
+    return mtime;
+}
+
+/* Check if run() takes **kwargs, it gets the command's parameters
+ * that way. */
+static int pyobj_func_kwargs(PyObject *func) {
+    long flags = 0;
+
+    PyObject *code = PyObject_GetAttrString(func, "__code__");
+    PyObject *co_flags = code ? PyObject_GetAttrString(code, "co_flags") : NULL;
+    if (co_flags && PyLong_Check(co_flags))
+        flags = PyLong_AsLong(co_flags);
+    Py_XDECREF(co_flags);
+    Py_XDECREF(code);
+    PyErr_Clear();
+
+    return (flags & CO_VARKEYWORDS) ? 1 : 0;
+}
+
+/* Get run() of the module, import the module if it's not cached yet.
+ * Returns new reference. */
+static PyObject *pyobj_lookup(const char *mod_name, int *kwargs) {
+    PyObject *module, *name, *func, *entry;
+    double mtime = 0;
+
+    entry = PyDict_GetItemString(pyobj_cache, mod_name);
+    if (entry) {
+        module = PyTuple_GET_ITEM(entry, 0);
+        func = PyTuple_GET_ITEM(entry, 1);
+        *kwargs = PyObject_IsTrue(PyTuple_GET_ITEM(entry, 3));
+        if (!pyobj_reload) {
+            Py_INCREF(func);
+            return func;
+        }
+        mtime = pyobj_module_mtime(module);
+        if (mtime == PyFloat_AsDouble(PyTuple_GET_ITEM(entry, 2))) {
+            Py_INCREF(func);
+            return func;
+        }
+        syslog(LOG_DEBUG, "clish_pyobj: Reload module %s", mod_name);
+        module = PyImport_ReloadModule(module);
+    } else {
+        name = PyUnicode_FromString(mod_name);
+        module = PyImport_Import(name);
+        Py_XDECREF(name);
+        if (module && pyobj_reload)
+            mtime = pyobj_module_mtime(module);
+    }
+    if (module == NULL) {
+        syslog(LOG_WARNING, "clish_pyobj: Failed to load module %s", mod_name);
+        pyobj_handle_error();
+        return NULL;
+    }
+
+    func = PyObject_GetAttrString(module, "run");
+
+    if (!func || !PyCallable_Check(func)) {
+        PyErr_Clear();
+        lub_dump_printf("%%Error: Internal error.\n");
+        syslog(LOG_WARNING, "clish_pyobj: Function run not found in module %s", mod_name);
+        Py_XDECREF(func);
+        Py_XDECREF(module);
+        return NULL;
+    }
+
+    *kwargs = pyobj_func_kwargs(func);
+    entry = Py_BuildValue("(OOdN)", module, func, mtime, PyBool_FromLong(*kwargs));
+    if (entry) {
+        PyDict_SetItemString(pyobj_cache, mod_name, entry);
+        Py_DECREF(entry);
+    }
+    PyErr_Clear();
+    Py_XDECREF(module);
+
+    return func;
+}
+
+static long pyobj_rss() {
+    long pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+
+    if (f) {
+        if (fscanf(f, "%*s %ld", &pages) != 1)
+            pages = 0;
+        fclose(f);
+    }
+
+    return pages * sysconf(_SC_PAGESIZE);
+}
+
+static void pyobj_trim() {
+    long rss = pyobj_rss();
+
+    if (!pyobj_rss_base) {
+        pyobj_rss_base = rss;
+        return;
+    }
+    if (rss - pyobj_rss_base < PYOBJ_TRIM_THRESHOLD) {
+        return;
+    }
+
+    PyGC_Collect();
+    malloc_trim(0);
+
+    pyobj_rss_base = pyobj_rss();
+}
+
 static int pyobj_set_user_cmd(const char *cmd) {
     return pyobj_update_environ("USER_COMMAND", cmd);
 }
 
+/* The klish output filter sets CLISH_TERM_LEN to 0 while it pages
+ * the modified output itself */
+static void pyobj_set_term_len() {
+    const char *term_len = getenv("CLISH_TERM_LEN");
+
+    if (term_len) {
+        pyobj_update_environ("CLISH_TERM_LEN", term_len);
+        return;
+    }
+
+    PyObject *module = PyImport_ImportModule("os");
+    if (module == NULL) {
+        pyobj_handle_error();
+        return;
+    }
+    PyObject *env_obj = PyObject_GetAttrString(module, "environ");
+    PyObject *ret = env_obj ?
+        PyObject_CallMethod(env_obj, "pop", "(sO)", "CLISH_TERM_LEN", Py_None) : NULL;
+    if (ret == NULL)
+        PyErr_Clear();
+
+    Py_XDECREF(ret);
+    Py_XDECREF(env_obj);
+    Py_XDECREF(module);
+}
+
+/* The output is buffered by Python, write it out before the klish
+ * restores the stdout */
+static void pyobj_flush_stdout() {
+    PyObject *py_stdout = PySys_GetObject("stdout");
+    PyObject *ret;
+
+    if (py_stdout == NULL)
+        return;
+    ret = PyObject_CallMethod(py_stdout, "flush", NULL);
+    if (ret == NULL)
+        PyErr_Clear();
+    Py_XDECREF(ret);
+}
+
 int pyobj_set_rest_token(const char *token) {
     return pyobj_update_environ("REST_API_TOKEN", token);
 }
 
-int call_pyobj(char *cmd, const char *arg, char **out) {
+/* Split the script text into the tokens in place. It follows the
+ * rules of the former parser: the tokens are separated by spaces
+ * only (tab and newline are a part of token) and the leading and
+ * trailing whitespace is trimmed. The token started by quote lasts
+ * till the closing quote if there is one, the rest of token after
+ * it is dropped. The backslash escapes quote and backslash; the
+ * escaped quote at the token start still opens the quoted token.
+ * Returns number of tokens, the array is allocated. */
+static size_t pyobj_tokenize(char *buf, char ***token) {
+    char *r = buf, *w, *end, *start = NULL;
+    size_t idx = 0, max = 0;
+    bool quoted = false;
+
+    *token = NULL;
+    end = buf + strlen(buf);
+    while (end > buf && isspace(end[-1])) end--;
+    while (r < end && isspace(*r)) r++;
+    w = r;
+
+    /* The write pointer can't overtake the read one */
+    while (r < end) {
+        char c = *r;
+        bool last = false;
+
+        if (!start)
+            start = w;
+        if (c == ' ' && !quoted) {
+            while (r + 1 < end && r[1] == ' ') r++;
+            c = '\0';
+            last = true;
+        } else if (c == '\"') {
+            if (!quoted && memchr(r + 1, '\"', end - r - 1)) {
+                if ((start == w ? c : *start) == '\"') {
+                    start++;
+                    quoted = true;
+                }
+            } else if (quoted) {
+                quoted = false;
+                c = '\0';
+            }
+        } else if (c == '\\' && r + 1 < end &&
+            (r[1] == '\\' || r[1] == '\"')) {
+            c = *++r;
+        }
+        *w++ = c;
+        r++;
+        if (last || r == end) {
+            if (idx == max) {
+                char **tmp;
+                max = max ? max * 2 : 16;
+                tmp = (char **)realloc(*token, max * sizeof(char *));
+                if (!tmp)
+                    break;
+                *token = tmp;
+            }
+            (*token)[idx++] = start;
+            start = NULL;
+        }
+    }
+    *w = '\0';
+
+    return idx;
+}
+
+static void pyobj_kwargs_set(PyObject *kwargs, const char *name, const char *value) {
+    PyObject *v_obj = PyUnicode_FromString(value ? value : "");
+    if (v_obj)
+        PyDict_SetItemString(kwargs, name, v_obj);
+    Py_XDECREF(v_obj);
+}
+
+/* The variables of the view id, like the interface of the interface
+ * view, the command's parameters by name and the command name */
+static PyObject *pyobj_pargv_kwargs(const void *context) {
+    clish_shell_t *shell = clish_context__get_shell(context);
+    const clish_command_t *cmd = clish_context__get_cmd(context);
+    clish_pargv_t *pargv = clish_context__get_pargv(context);
+    lub_bintree_t *viewid;
+    lub_bintree_iterator_t iter;
+    clish_var_t *var;
+    unsigned i;
+
+    PyObject *kwargs = PyDict_New();
+    if (!kwargs)
+        return NULL;
+
+    viewid = clish_shell__get_pwd_viewid(shell, clish_shell__get_depth(shell));
+    var = viewid ? (clish_var_t *)lub_bintree_findfirst(viewid) : NULL;
+    if (var) {
+        for (lub_bintree_iterator_init(&iter, viewid, var);
+            var; var = (clish_var_t *)lub_bintree_iterator_next(&iter))
+            pyobj_kwargs_set(kwargs, clish_var__get_name(var), clish_var__get_value(var));
+    }
+    for (i = 0; pargv && i < clish_pargv__get_count(pargv); i++) {
+        clish_parg_t *parg = clish_pargv__get_parg(pargv, i);
+        pyobj_kwargs_set(kwargs, clish_parg__get_name(parg), clish_parg__get_value(parg));
+    }
+    if (cmd)
+        pyobj_kwargs_set(kwargs, "__command__", clish_command__get_name(cmd));
+    PyErr_Clear();
+
+    return kwargs;
+}
+
+/* Cut the next word of the script text, like the module name. The
+ * text is moved after it. */
+static char *pyobj_next_word(char **text) {
+    char *word = *text;
+
+    while (isspace(*word)) word++;
+    *text = word;
+    while (**text && !isspace(**text)) (*text)++;
+    if (**text)
+        *(*text)++ = '\0';
+
+    return word;
+}
+
+int call_pyobj(const void *context, char *cmd, const char *arg, char **out) {
     int ret_code = 0;
-    char *token[128];
-    char *buf;
-    int i;
+    char **token = NULL;
+    size_t idx = 0;
+    char *buf, *rest, *mod_name;
+    size_t i;
+    int use_kwargs = 0;
 
     PyGILState_STATE gstate;
     gstate = PyGILState_Ensure();
 
     pyobj_set_user_cmd(cmd);
+    pyobj_set_term_len();
     syslog(LOG_DEBUG, "clish_pyobj: cmd=%s", cmd);
 
     buf = strdup(arg);
     if (!buf) {
         syslog(LOG_WARNING, "clish_pyobj: Failed to allocate memory");
+        PyGILState_Release(gstate);
         return -1;
     }
 
-    // trim leading and trailing whtespace
-    char *p = buf;
-    int len = strlen(buf);
-    while (isspace(p[len-1])) p[--len] = '\0';
-    while (*p && isspace(*p)) ++p, --len;
-
-    char *saved_ptr = '\0';
-    size_t idx = 0;
-    bool quoted = false;
-
-    while (*p) {
-	if (!saved_ptr) saved_ptr = p;
-	if (*p == ' ' && quoted == false) {
-	   while (*(p+1) && *(p+1)==' ') {
-	      memmove(p, p+1, strlen(p)-1);
-	      *(p+strlen(p)-1) = '\0';
-	   }
-	   *p = '\0';
-           token[idx++] = saved_ptr;
-	   saved_ptr = '\0';
-	} else if (*p == '\"') {
-	   if (!quoted && strchr((p+1), '\"')) {
-	      // open quote
-	      if (*saved_ptr == '\"') {
-		 saved_ptr++;
-	         quoted = true;
-	      }
-	   } else if (quoted) {
-	      // close quote
-	      quoted = false;
-	      *p = '\0';
-	   }
-	}
-	// escape chars
-	if (*p == '\\') {
-	   if (*(p+1) == '\\' || *(p+1) == '\"') {
-	      memmove(p, p+1, strlen(p)-1);
-	      *(p+strlen(p)-1) = '\0';
-	   }
-	}
-	if (*++p == '\0' && saved_ptr)
-           token[idx++] = saved_ptr;
-    }
-
-    PyObject *module, *name, *func, *args, *value;
-
-    name = PyUnicode_FromString(token[0]);
-    module = PyImport_Import(name);
-    if (module == NULL) {
-        syslog(LOG_WARNING, "clish_pyobj: Failed to load module %s", token[0]);
-        pyobj_handle_error();
+    rest = buf;
+    mod_name = pyobj_next_word(&rest);
+    if (!*mod_name) {
+        syslog(LOG_WARNING, "clish_pyobj: No module in [args:%s]", arg);
         free(buf);
-        Py_XDECREF(name);
         PyGILState_Release(gstate);
         return -1;
     }
 
-    func = PyObject_GetAttrString(module, "run");
+    PyObject *func, *args, *kwargs = NULL, *value;
 
-    if (!func || !PyCallable_Check(func)) {
-        lub_dump_printf("%%Error: Internal error.\n");
-        syslog(LOG_WARNING, "clish_pyobj: Function run not found in module %s", token[0]);
-        Py_XDECREF(module);
-        Py_XDECREF(name);
+    func = pyobj_lookup(mod_name, &use_kwargs);
+    if (func == NULL) {
         free(buf);
         PyGILState_Release(gstate);
         return -1;
     }
 
     args = PyTuple_New(2);
-    PyTuple_SetItem(args, 0, PyUnicode_FromString(token[1]));
-
     PyObject *args_list = PyList_New(0);
-    for (i=1; i< idx-1; i++) {
-	PyList_Append(args_list, PyUnicode_FromString(token[i+1]));
+    if (use_kwargs && context) {
+        /* run(func, args, **kwargs) gets the parameters without
+           parsing, the script text is just "module func" */
+        PyTuple_SetItem(args, 0, PyUnicode_FromString(pyobj_next_word(&rest)));
+        kwargs = pyobj_pargv_kwargs(context);
+    } else {
+        idx = pyobj_tokenize(rest, &token);
+        PyTuple_SetItem(args, 0, PyUnicode_FromString(idx ? token[0] : ""));
+        for (i = 1; i < idx; i++) {
+            PyObject *v_obj = PyUnicode_FromString(token[i]);
+            PyList_Append(args_list, v_obj);
+            Py_XDECREF(v_obj);
+        }
     }
     PyTuple_SetItem(args, 1, args_list);
 
-    value = PyObject_CallObject(func, args);
+    /* Drop the Ctrl-C of the previous command not seen by Python */
+    if (!is_ctrlc_pressed() && PyErr_CheckSignals() < 0) {
+        PyErr_Clear();
+    }
+
+    value = PyObject_Call(func, args, kwargs);
     if (value == NULL) {
        pyobj_handle_error();
        syslog(LOG_WARNING, "clish_pyobj: Failed [cmd=%s][args:%s]", cmd, arg);
@@ -244,16 +639,17 @@ int call_pyobj(char *cmd, const char *arg, char **out) {
         }
     }
 
-    Py_XDECREF(module);
-    Py_XDECREF(name);
+    pyobj_flush_stdout();
+
     Py_XDECREF(func);
     Py_XDECREF(args);
+    Py_XDECREF(kwargs);
     Py_XDECREF(value);
 
+    free(token);
     free(buf);
 
-    PyGC_Collect();
-    malloc_trim(0);
+    pyobj_trim();
 
     PyGILState_Release(gstate);
     return ret_code;
@@ -0,0 +1,449 @@
+/*
+###########################################################################
+#
+# Copyright 2019 Dell, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###########################################################################
+*/
+
+/*
+ * The timing statistics of the commands. The parse, action, REST and
+ * render times of every command run are recorded in the histograms
+ * of the command. They're shown by "show cli statistics" and dumped
+ * as JSON to CLISH_STATS_FILE when the shell exits.
+ *
+ * The actioner scripts started by the actions report their times
+ * through the file of CLISH_STATS_FD, a "<stage> <seconds>" line per
+ * time. A "rest" line is one REST request.
+ */
+
+#include "private.h"
+#include "nos_extn.h"
+#include "lub/string.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/* The log-linear buckets like in the HDR histogram. The values below
+ * STATS_SUB have their own bucket, every power of two above is split
+ * into STATS_SUB buckets, so the error is below 1/STATS_SUB. The
+ * values are in usec, up to 2^40 usec. */
+#define STATS_SUB_BITS 3
+#define STATS_SUB (1 << STATS_SUB_BITS)
+#define STATS_MAX_BITS 40
+#define STATS_BUCKETS ((STATS_MAX_BITS - STATS_SUB_BITS + 1) * STATS_SUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint32_t buckets[STATS_BUCKETS];
+} cli_hist_t;
+
+typedef struct {
+    char *name;
+    uint64_t runs;
+    uint64_t requests;
+    cli_hist_t hist[CLI_STATS_MAX];
+} cli_stats_cmd_t;
+
+static const char *stats_stage_names[CLI_STATS_MAX] = {
+    "total", "parse", "action", "rest", "connect", "server", "render"
+};
+
+/* The statistics are updated by the shell and by the REST transfers,
+ * apart from the lock of the commands */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static cli_stats_cmd_t **stats_cmds = NULL;
+static size_t stats_num = 0;
+
+/* The command being run and its times so far */
+static char *stats_cur = NULL;
+static uint64_t stats_cur_time[CLI_STATS_MAX];
+static unsigned int stats_cur_set = 0;
+static uint64_t stats_cur_requests = 0;
+
+/* The file of the times reported by the scripts. It's private to the
+ * process, the sessions forked by the session server open their own. */
+static int stats_fd = -1;
+static pid_t stats_fd_pid = 0;
+
+static unsigned int stats_bucket(uint64_t value) {
+    unsigned int exp;
+
+    if (value < STATS_SUB) {
+        return value;
+    }
+    exp = 63 - __builtin_clzll(value);
+    if (exp >= STATS_MAX_BITS) {
+        return STATS_BUCKETS - 1;
+    }
+    return (exp - STATS_SUB_BITS + 1) * STATS_SUB +
+        ((value >> (exp - STATS_SUB_BITS)) & (STATS_SUB - 1));
+}
+
+/* The highest value of the bucket */
+static uint64_t stats_bucket_value(unsigned int bucket) {
+    unsigned int exp;
+
+    if (bucket < STATS_SUB) {
+        return bucket;
+    }
+    exp = bucket / STATS_SUB + STATS_SUB_BITS - 1;
+    return ((uint64_t)(STATS_SUB + bucket % STATS_SUB) << (exp - STATS_SUB_BITS)) +
+        ((uint64_t)1 << (exp - STATS_SUB_BITS)) - 1;
+}
+
+static void stats_hist_add(cli_hist_t *hist, uint64_t value) {
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+    hist->buckets[stats_bucket(value)]++;
+}
+
+/* The value below which the percent of the values are */
+static uint64_t stats_hist_percentile(const cli_hist_t *hist, double percent) {
+    uint64_t rank = (uint64_t)(hist->count * percent / 100.0 + 0.5);
+    uint64_t seen = 0;
+    unsigned int i;
+
+    if (rank < 1) {
+        rank = 1;
+    }
+    for (i = 0; i < STATS_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint64_t value = stats_bucket_value(i);
+            return value < hist->max ? value : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+static cli_stats_cmd_t *stats_find(const char *name) {
+    cli_stats_cmd_t **cmds;
+    cli_stats_cmd_t *cmd;
+    size_t i;
+
+    for (i = 0; i < stats_num; i++) {
+        if (!strcmp(stats_cmds[i]->name, name)) {
+            return stats_cmds[i];
+        }
+    }
+    cmd = calloc(1, sizeof(*cmd));
+    cmds = realloc(stats_cmds, (stats_num + 1) * sizeof(*cmds));
+    if (!cmd || !cmds) {
+        free(cmd);
+        if (cmds) {
+            stats_cmds = cmds;
+        }
+        return NULL;
+    }
+    cmd->name = lub_string_dup(name);
+    stats_cmds = cmds;
+    stats_cmds[stats_num++] = cmd;
+
+    return cmd;
+}
+
+/* Add the time of the stage to the current command */
+static void stats_add(cli_stats_stage_e stage, unsigned long usec) {
+    if (!stats_cur || stage >= CLI_STATS_MAX) {
+        return;
+    }
+    stats_cur_time[stage] += usec;
+    stats_cur_set |= 1 << stage;
+}
+
+/* Empty the file, it's not used anymore if it can't be */
+static void stats_script_clear() {
+    if (ftruncate(stats_fd, 0) < 0) {
+        close(stats_fd);
+        stats_fd = -1;
+        unsetenv("CLISH_STATS_FD");
+    }
+}
+
+/* Open the file for the times of the scripts, or empty it. The times
+ * reported since the last command, like by the completion scripts,
+ * are dropped. */
+static void stats_script_begin() {
+    char path[] = "/tmp/clish.stats.XXXXXX";
+    char fd_str[16];
+
+    if (stats_fd >= 0 && stats_fd_pid == getpid()) {
+        if (lseek(stats_fd, 0, SEEK_END) > 0) {
+            stats_script_clear();
+        }
+        return;
+    }
+    if (stats_fd >= 0) {
+        close(stats_fd);
+    }
+    stats_fd = mkstemp(path);
+    if (stats_fd < 0) {
+        return;
+    }
+    unlink(path);
+    /* The scripts and their children append to it */
+    fcntl(stats_fd, F_SETFL, O_APPEND);
+    stats_fd_pid = getpid();
+    snprintf(fd_str, sizeof(fd_str), "%d", stats_fd);
+    setenv("CLISH_STATS_FD", fd_str, 1);
+}
+
+/* Add the times reported by the scripts of the command */
+static void stats_script_end() {
+    char buf[4096];
+    char line[64];
+    size_t len = 0;
+    off_t off = 0;
+    ssize_t n;
+
+    if (stats_fd < 0 || stats_fd_pid != getpid()) {
+        return;
+    }
+    while ((n = pread(stats_fd, buf, sizeof(buf), off)) > 0) {
+        ssize_t i;
+
+        off += n;
+        for (i = 0; i < n; i++) {
+            char stage[16];
+            double seconds;
+            int idx;
+
+            if (buf[i] != '\n') {
+                if (len < sizeof(line) - 1) {
+                    line[len++] = buf[i];
+                }
+                continue;
+            }
+            line[len] = '\0';
+            len = 0;
+            /* The parse and action times are the shell's own */
+            if (sscanf(line, "%15s %lf", stage, &seconds) != 2 || seconds <= 0 ||
+                (idx = cli_stats_stage(stage)) < CLI_STATS_REST) {
+                continue;
+            }
+            if (idx == CLI_STATS_REST) {
+                stats_cur_requests++;
+            }
+            stats_add((cli_stats_stage_e)idx, (unsigned long)(seconds * 1000000));
+        }
+    }
+    if (off) {
+        stats_script_clear();
+    }
+}
+
+/*--------------------------------------------------------- */
+/* Start the run of the command, the line was parsed in parse_usec */
+void cli_stats_begin(const char *name, unsigned long parse_usec) {
+    pthread_mutex_lock(&stats_lock);
+    stats_script_begin();
+    lub_string_free(stats_cur);
+    stats_cur = lub_string_dup(name);
+    memset(stats_cur_time, 0, sizeof(stats_cur_time));
+    stats_cur_set = 0;
+    stats_cur_requests = 0;
+    stats_add(CLI_STATS_PARSE, parse_usec);
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void cli_stats_add(cli_stats_stage_e stage, unsigned long usec) {
+    pthread_mutex_lock(&stats_lock);
+    stats_add(stage, usec);
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/* Add the timings of the REST request of the current command */
+void cli_stats_request(unsigned long connect_usec, unsigned long server_usec,
+                       unsigned long total_usec) {
+    pthread_mutex_lock(&stats_lock);
+    if (stats_cur) {
+        stats_cur_requests++;
+        stats_add(CLI_STATS_CONNECT, connect_usec);
+        stats_add(CLI_STATS_SERVER, server_usec);
+        stats_add(CLI_STATS_REST, total_usec);
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/* Record the run of the current command, the action took action_usec */
+void cli_stats_end(unsigned long action_usec) {
+    cli_stats_cmd_t *cmd;
+    unsigned int i;
+
+    pthread_mutex_lock(&stats_lock);
+    if (!stats_cur) {
+        pthread_mutex_unlock(&stats_lock);
+        return;
+    }
+    stats_script_end();
+    stats_add(CLI_STATS_ACTION, action_usec);
+    stats_add(CLI_STATS_TOTAL,
+                  stats_cur_time[CLI_STATS_PARSE] + stats_cur_time[CLI_STATS_ACTION]);
+
+    cmd = stats_find(stats_cur);
+    if (cmd) {
+        cmd->runs++;
+        cmd->requests += stats_cur_requests;
+        for (i = 0; i < CLI_STATS_MAX; i++) {
+            if (stats_cur_set & (1 << i)) {
+                stats_hist_add(&cmd->hist[i], stats_cur_time[i]);
+            }
+        }
+    }
+    lub_string_free(stats_cur);
+    stats_cur = NULL;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+int cli_stats_stage(const char *name) {
+    int i;
+
+    for (i = 0; i < CLI_STATS_MAX; i++) {
+        if (!strcmp(stats_stage_names[i], name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+unsigned long cli_stats_elapsed(const struct timespec *since) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000 +
+        (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static int stats_cmp(const void *a, const void *b) {
+    return lub_string_natcmp((*(cli_stats_cmd_t * const *)a)->name,
+                             (*(cli_stats_cmd_t * const *)b)->name);
+}
+
+#define MSEC(usec) ((double)(usec) / 1000.0)
+
+/*--------------------------------------------------------- */
+/* Builtin: show the statistics of the commands run so far */
+CLISH_PLUGIN_SYM(clish_stats)
+{
+    size_t i;
+    unsigned int j;
+
+    pthread_mutex_lock(&stats_lock);
+    if (stats_num) {
+        qsort(stats_cmds, stats_num, sizeof(*stats_cmds), stats_cmp);
+    }
+    for (i = 0; i < stats_num; i++) {
+        const cli_stats_cmd_t *cmd = stats_cmds[i];
+
+        printf("Command: %s\n", cmd->name);
+        printf("Runs: %llu, REST requests: %llu\n",
+               (unsigned long long)cmd->runs, (unsigned long long)cmd->requests);
+        printf("  %-8s %8s %10s %10s %10s %10s %10s\n", "Stage", "Count",
+               "Mean(ms)", "P50(ms)", "P90(ms)", "P99(ms)", "Max(ms)");
+        for (j = 0; j < CLI_STATS_MAX; j++) {
+            const cli_hist_t *hist = &cmd->hist[j];
+
+            if (!hist->count) {
+                continue;
+            }
+            printf("  %-8s %8llu %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                   stats_stage_names[j], (unsigned long long)hist->count,
+                   MSEC(hist->sum) / hist->count,
+                   MSEC(stats_hist_percentile(hist, 50)),
+                   MSEC(stats_hist_percentile(hist, 90)),
+                   MSEC(stats_hist_percentile(hist, 99)),
+                   MSEC(hist->max));
+        }
+        printf("\n");
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    script = script; /* Happy compiler */
+    out = out; /* Happy compiler */
+
+    return 0;
+}
+
+static void stats_json_string(FILE *file, const char *str) {
+    fputc('"', file);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', file);
+        }
+        if ((unsigned char)*str < 0x20) {
+            fprintf(file, "\\u%04x", *str);
+        } else {
+            fputc(*str, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/* Write the statistics as JSON to CLISH_STATS_FILE if it's set */
+void cli_stats_dump() {
+    const char *path = getenv("CLISH_STATS_FILE");
+    FILE *file;
+    size_t i;
+    unsigned int j;
+
+    if (!path || !*path || !(file = fopen(path, "w"))) {
+        return;
+    }
+    pthread_mutex_lock(&stats_lock);
+    fprintf(file, "{\"commands\": [");
+    for (i = 0; i < stats_num; i++) {
+        const cli_stats_cmd_t *cmd = stats_cmds[i];
+        const char *sep = "";
+
+        fprintf(file, "%s\n  {\"command\": ", i ? "," : "");
+        stats_json_string(file, cmd->name);
+        fprintf(file, ", \"runs\": %llu, \"requests\": %llu, \"stages\": {",
+                (unsigned long long)cmd->runs, (unsigned long long)cmd->requests);
+        for (j = 0; j < CLI_STATS_MAX; j++) {
+            const cli_hist_t *hist = &cmd->hist[j];
+
+            if (!hist->count) {
+                continue;
+            }
+            fprintf(file, "%s\"%s\": {\"count\": %llu, \"mean_ms\": %.3f, "
+                    "\"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, "
+                    "\"max_ms\": %.3f}", sep, stats_stage_names[j],
+                    (unsigned long long)hist->count,
+                    MSEC(hist->sum) / hist->count,
+                    MSEC(stats_hist_percentile(hist, 50)),
+                    MSEC(stats_hist_percentile(hist, 90)),
+                    MSEC(stats_hist_percentile(hist, 99)),
+                    MSEC(hist->max));
+            sep = ", ";
+        }
+        fprintf(file, "}}");
+    }
+    fprintf(file, "\n]}\n");
+    pthread_mutex_unlock(&stats_lock);
+    fclose(file);
+}
@@ -21,27 +21,80 @@
 #endif
 
 #include "lub/string.h"
+#include "lub/list.h"
 #include "lub/db.h"
 #include "clish/shell.h"
 
-/*--------------------------------------------------------- */
-/* Return values:
- *    0 - access granted
- *    !=0 - access denied
+#ifdef HAVE_GRP_H
+/* Verdict for one distinct access string */
+typedef struct {
+	char *access;
+	int allowed;
+} access_entry_t;
+
+/* The group names of the current user. Resolved once per process
+ * because every lookup may go to NSS (TACACS, LDAP etc.).
  */
-CLISH_HOOK_ACCESS(clish_hook_access)
+static lub_list_t *user_groups = NULL;
+/* Memoized verdicts. The schema repeats a handful of access strings
+ * over thousands of VIEWs, COMMANDs and PARAMs.
+ */
+static lub_list_t *access_cache = NULL;
+
+/*--------------------------------------------------------- */
+static int access_entry_compare(const void *first, const void *second)
 {
-	int allowed = -1; /* assume the user is not allowed */
-#ifdef HAVE_GRP_H
+	const access_entry_t *f = (const access_entry_t *)first;
+	const access_entry_t *s = (const access_entry_t *)second;
+
+	return strcmp(f->access, s->access);
+}
+
+/*--------------------------------------------------------- */
+static int access_entry_match(const void *key, const void *data)
+{
+	const access_entry_t *entry = (const access_entry_t *)data;
+
+	return strcmp((const char *)key, entry->access);
+}
+
+/*--------------------------------------------------------- */
+static void access_entry_free(void *data)
+{
+	access_entry_t *entry = (access_entry_t *)data;
+
+	lub_string_free(entry->access);
+	free(entry);
+}
+
+/*--------------------------------------------------------- */
+static int group_compare(const void *first, const void *second)
+{
+	return strcmp((const char *)first, (const char *)second);
+}
+
+/*--------------------------------------------------------- */
+static int group_match(const void *key, const void *data)
+{
+	return strcmp((const char *)key, (const char *)data);
+}
+
+/*--------------------------------------------------------- */
+static void group_free(void *data)
+{
+	lub_string_free((char *)data);
+}
+
+/*--------------------------------------------------------- */
+static lub_list_t *resolve_user_groups(void)
+{
+	lub_list_t *groups;
 	int num_groups;
 	long ngroups_max;
 	gid_t *group_list;
 	int i;
-	char *tmp_access, *full_access;
-	char *saveptr = NULL;
 
-	assert(access);
-	full_access = lub_string_dup(access);
+	groups = lub_list_new(group_compare, group_free);
 	ngroups_max = sysconf(_SC_NGROUPS_MAX) + 1;
 	group_list = (gid_t *)malloc(ngroups_max * sizeof(gid_t));
 
@@ -49,8 +102,28 @@ CLISH_HOOK_ACCESS(clish_hook_access)
 	num_groups = getgroups(ngroups_max, group_list);
 	assert(num_groups != -1);
 
-	/* Now check these against the access provided */
-	/* The external loop goes trough the list of valid groups */
+	for (i = 0; i < num_groups; i++) {
+		struct group *ptr = lub_db_getgrgid(group_list[i]);
+		if (!ptr)
+			continue;
+		if (!lub_list_find(groups, group_match, ptr->gr_name))
+			lub_list_add(groups, lub_string_dup(ptr->gr_name));
+		free(ptr);
+	}
+	free(group_list);
+
+	return groups;
+}
+
+/*--------------------------------------------------------- */
+static int check_access(const char *access)
+{
+	int allowed = -1; /* assume the user is not allowed */
+	char *tmp_access, *full_access;
+	char *saveptr = NULL;
+
+	full_access = lub_string_dup(access);
+
 	/* The allowed groups are indicated by a colon-separated (:) list. */
 	for (tmp_access = strtok_r(full_access, ":", &saveptr);
 		tmp_access; tmp_access = strtok_r(NULL, ":", &saveptr)) {
@@ -59,25 +132,45 @@ CLISH_HOOK_ACCESS(clish_hook_access)
 			allowed = 0;
 			break;
 		}
-		/* The internal loop goes trough the system group list */
-		for (i = 0; i < num_groups; i++) {
-			struct group *ptr = lub_db_getgrgid(group_list[i]);
-			if (!ptr)
-				continue;
-			if (0 == strcmp(ptr->gr_name, tmp_access)) {
-				/* The current user is permitted to use this command */
-				allowed = 0;
-				free(ptr);
-				break;
-			}
-			free(ptr);
-		}
-		if (!allowed)
+		/* The current user is permitted to use this command */
+		if (lub_list_find(user_groups, group_match, tmp_access)) {
+			allowed = 0;
 			break;
+		}
 	}
-
 	lub_string_free(full_access);
-	free(group_list);
+
+	return allowed;
+}
+
+#endif
+
+/*--------------------------------------------------------- */
+/* Return values:
+ *    0 - access granted
+ *    !=0 - access denied
+ */
+CLISH_HOOK_ACCESS(clish_hook_access)
+{
+	int allowed = -1; /* assume the user is not allowed */
+#ifdef HAVE_GRP_H
+	access_entry_t *entry;
+
+	assert(access);
+	if (!user_groups)
+		user_groups = resolve_user_groups();
+	if (!access_cache)
+		access_cache = lub_list_new(access_entry_compare,
+			access_entry_free);
+
+	entry = lub_list_find(access_cache, access_entry_match, access);
+	if (!entry) {
+		entry = malloc(sizeof(*entry));
+		entry->access = lub_string_dup(access);
+		entry->allowed = check_access(access);
+		lub_list_add(access_cache, entry);
+	}
+	allowed = entry->allowed;
 #endif
 
 	clish_shell = clish_shell; /* Happy compiler */
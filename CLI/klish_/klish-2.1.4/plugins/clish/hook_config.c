@@ -20,6 +20,7 @@
 #include "lub/string.h"
 #include "lub/conv.h"
 #include "clish/shell.h"
+#include "nos_extn.h"
 
 static int send_request(konf_client_t * client, char *command);
 
@@ -55,6 +56,11 @@ CLISH_HOOK_CONFIG(clish_hook_config)
 	if (!this)
 		return 0;
 
+	/* The command moved into another view, like "end". The deferred
+	 * config of the view is done before the next command. */
+	if (clish_command__get_viewname(cmd))
+		nos_extn_rest_barrier();
+
 	client = clish_shell__get_client(this);
 	if (!client)
 		return 0;
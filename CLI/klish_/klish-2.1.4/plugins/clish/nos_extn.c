@@ -21,6 +21,8 @@
 #include "private.h"
 #include "nos_extn.h"
 #include "lub/string.h"
+#include "lub/prof.h"
+#include "clish/plugin/mgmt_clish_utils.h"
 
 #include <pthread.h>
 #include <unistd.h>
@@ -29,12 +31,39 @@
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <sched.h>
+#include <time.h>
 
 pthread_mutex_t lock;
 
+static int auth_ena;
+/* Set in a process forked by the session server template. The
+ * per-user part of the initialization is done on the first use. */
+static int session_pending = 0;
+
+static void nos_extn_fork_child(void) {
+    session_pending = 1;
+}
+
+/* The signals are for the shell thread, the plugin's threads block
+ * them all */
+void nos_extn_block_signals() {
+    sigset_t sigs;
+
+    sigfillset(&sigs);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+}
+
+/* The token is fetched without the command lock. The commands
+ * pick up the new token by rest_token_sync(). */
 void *rest_token_refresh(void *vargp){
     int expiry  = (intptr_t)vargp;
     int interval;
+
+    nos_extn_block_signals();
+
+    rest_token_fetch(&expiry);
+
     while(1) {
         interval = 0.8 * expiry; 
         syslog(LOG_DEBUG, "Token update - sleeping for %d of %d", interval, expiry);
@@ -42,32 +71,191 @@ void *rest_token_refresh(void *vargp){
         /* Sleep for 80% of the interval */
         sleep(interval);
 
-        pthread_mutex_lock(&lock);
-
         rest_token_fetch(&expiry);
-
-        pthread_mutex_unlock(&lock);
     }
 }
 
+/* The initial fetch is done by the refresh thread as well, so the
+ * prompt doesn't wait for it. The first command does. */
 int clish_rest_thread_init() {
     pthread_t thread_id;
 
-
     int expiry = 30;
-    rest_token_fetch(&expiry);
-    
-    pthread_create(&thread_id, NULL, rest_token_refresh, (void*)(long)expiry);
+
+    rest_token_start();
+    if (pthread_create(&thread_id, NULL, rest_token_refresh, (void*)(long)expiry)) {
+        syslog(LOG_WARNING, "Failed to start token refresh thread");
+        rest_token_fetch(&expiry);
+        return -1;
+    }
+    pthread_detach(thread_id);
+    return 0;
+}
+
+/* Import the Python modules listed by CLISH_PYOBJ_PRELOAD, one
+ * module per lock hold. A command waits for one import at most. */
+static void pyobj_preload_all(int locked) {
+    char *list = lub_string_dup(getenv("CLISH_PYOBJ_PRELOAD"));
+    char *saveptr = NULL;
+    char *name;
+
+    if (!list)
+        return;
+    for (name = strtok_r(list, " :,", &saveptr); name;
+        name = strtok_r(NULL, " :,", &saveptr)) {
+        if (locked)
+            pthread_mutex_lock(&lock);
+        pyobj_preload(name);
+        if (locked) {
+            pthread_mutex_unlock(&lock);
+            sched_yield();
+        }
+    }
+    lub_string_free(list);
+}
+
+static void *pyobj_preload_thread(void *vargp) {
+    nos_extn_block_signals();
+
+    pyobj_preload_all(1);
+    return NULL;
+}
+
+/* Connect to the remote REST server while the shell starts */
+static void *rest_prewarm_thread(void *vargp) {
+    nos_extn_block_signals();
+
+    pthread_mutex_lock(&lock);
+    rest_prewarm();
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+static void nos_extn_session_check() {
+    if (!session_pending)
+        return;
+    session_pending = 0;
+
+    pyobj_sync_environ();
+    rest_session_start();
+    if (auth_ena) {
+        clish_rest_thread_init();
+    }
+}
+
+/* Whether the command moves into another view. The lines of the view
+ * may depend on the object it configures. */
+static int nos_extn_changes_view(clish_context_t *context) {
+    const clish_command_t *cmd = clish_context__get_cmd(context);
+    clish_pargv_t *pargv = clish_context__get_pargv(context);
+    unsigned int i, cnt;
+
+    if (!cmd)
+        return 0;
+    if (clish_command__get_viewname(cmd))
+        return 1;
+    cnt = clish_pargv__get_count(pargv);
+    for (i = 0; i < cnt; i++) {
+        if (clish_param__get_viewname(clish_pargv__get_param(pargv, i)))
+            return 1;
+    }
     return 0;
 }
 
+/* Whether the action is not of the command, but of a variable, like
+ * the ones of the completion. Its requests get the short timeout. */
+static int nos_extn_is_lookup(clish_context_t *context) {
+    const clish_command_t *cmd = clish_context__get_cmd(context);
+
+    return !cmd || clish_context__get_action(context) != clish_command__get_action(cmd);
+}
+
+/* The lookups of the completion have the short timeout */
+static void nos_extn_request_class(clish_context_t *context) {
+    rest_request_class(nos_extn_is_lookup(context) ?
+                       REST_CLASS_COMPLETION : REST_CLASS_COMMAND);
+}
+
+/* Hook: the shell times every run of the ACTION. The times of the
+ * command are recorded by its name, the parse time of the line is
+ * measured by the shell. The lookups aren't recorded. */
+CLISH_HOOK_STATS(clish_hook_stats) {
+    clish_context_t *context = clish_context;
+
+    if (nos_extn_is_lookup(context)) {
+        return 0;
+    }
+    if (!done) {
+        cli_stats_begin(clish_command__get_name(clish_context__get_cmd(context)),
+                        clish_shell__get_parse_time(clish_context__get_shell(context)));
+        return 0;
+    }
+    cli_stats_end(usec);
+    return 0;
+}
+
+/* Ctrl-C while the action runs. The REST transfers check the flag
+ * set by clish_interrupt_handler() and Python code gets the
+ * KeyboardInterrupt. */
+static void nos_extn_sigint(int signo) {
+    clish_interrupt_handler(signo);
+    pyobj_interrupt();
+}
+
+/* The shell blocks SIGINT during the actions, these handle it. It's
+ * installed without SA_RESTART, so the waits return at once. */
+static void nos_extn_intr_begin(struct sigaction *old, sigset_t *old_sigs) {
+    struct sigaction sa;
+    sigset_t sigs;
+
+    flush_ctrlc_pipe();
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = nos_extn_sigint;
+    sigaction(SIGINT, &sa, old);
+
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigprocmask(SIG_UNBLOCK, &sigs, old_sigs);
+}
+
+static void nos_extn_intr_end(const struct sigaction *old, const sigset_t *old_sigs) {
+    sigprocmask(SIG_SETMASK, old_sigs, NULL);
+    sigaction(SIGINT, old, NULL);
+}
+
+/* Wait for the deferred config requests and report their errors.
+ * It's the barrier before the actions which don't go through the
+ * plugin's REST client. Ctrl-C aborts the replay of the failed
+ * coalesced requests. */
+void nos_extn_rest_barrier() {
+    struct sigaction old_sigint;
+    sigset_t old_sigs;
+
+    pthread_mutex_lock(&lock);
+    nos_extn_intr_begin(&old_sigint, &old_sigs);
+    rest_async_barrier();
+    nos_extn_intr_end(&old_sigint, &old_sigs);
+    pthread_mutex_unlock(&lock);
+}
+
 CLISH_PLUGIN_SYM(clish_restcl)
 {
     char *cmd = clish_shell__get_full_line(clish_context);
-    
+    struct sigaction old_sigint;
+    sigset_t old_sigs;
+
+    nos_extn_session_check();
+
     pthread_mutex_lock(&lock);
 
+    nos_extn_intr_begin(&old_sigint, &old_sigs);
+    rest_token_sync();
+    rest_async_barrier();
+    nos_extn_request_class(clish_context);
     int ret = rest_cl(cmd, script);
+    nos_extn_intr_end(&old_sigint, &old_sigs);
+    rest_session_save();
 
     pthread_mutex_unlock(&lock);
 
@@ -78,15 +266,33 @@ CLISH_PLUGIN_SYM(clish_restcl)
 
 CLISH_PLUGIN_SYM(clish_pyobj)
 {
+    clish_shell_t *shell = clish_context__get_shell(clish_context);
     char *cmd = clish_shell__get_full_line(clish_context);
+    struct sigaction old_sigint;
+    sigset_t old_sigs;
+    int async;
 
-    sigset_t sigs;
-    sigemptyset(&sigs);
-    sigaddset(&sigs, SIGINT);
-    sigprocmask(SIG_UNBLOCK, &sigs, NULL);
+    nos_extn_session_check();
+
+    /* The config of the pasted or sourced lines is sent without
+       waiting for the replies, while the next line is already
+       read. The view change and the last line wait for them. */
+    async = !clish_shell__get_stop_on_error(shell) &&
+        !nos_extn_changes_view(clish_context) &&
+        clish_shell__get_input_pending(shell);
 
     pthread_mutex_lock(&lock);
-    int ret = call_pyobj(cmd, script, out);
+    nos_extn_intr_begin(&old_sigint, &old_sigs);
+    rest_token_sync();
+    if (async)
+        rest_async_begin(clish_shell__get_line_num(shell), cmd);
+    else
+        rest_async_barrier();
+    nos_extn_request_class(clish_context);
+    int ret = call_pyobj(clish_context, cmd, script, out);
+    rest_async_end();
+    nos_extn_intr_end(&old_sigint, &old_sigs);
+    rest_session_save();
     pthread_mutex_unlock(&lock);
 
     return ret;
@@ -95,6 +301,9 @@ CLISH_PLUGIN_SYM(clish_pyobj)
 CLISH_PLUGIN_SYM(clish_setenv)
 {
     char *key, *value;
+
+    nos_extn_session_check();
+
     key = strtok_r((char*)script, "=", &value);
 
     if (key) {
@@ -109,14 +318,40 @@ CLISH_PLUGIN_SYM(clish_setenv)
 void nos_extn_init() {
     
     pthread_mutex_init(&lock, NULL);
+    clish_interrupt_init();
 
-    int auth_ena = (getenv("CLISH_NOAUTH") == NULL);
+    auth_ena = (getenv("CLISH_NOAUTH") == NULL);
 
+    lub_prof_begin("rest client init");
     rest_client_init();
+    lub_prof_end();
+    lub_prof_begin("python init");
     pyobj_init();
-    
-    if (auth_ena) {
-        clish_rest_thread_init();
+    lub_prof_end();
+
+    /* The session server template must stay single threaded and
+       must not hold the token of its own user. It imports the
+       modules in place, the forked sessions inherit them. */
+    if (getenv("CLISHD_TEMPLATE")) {
+        lub_prof_begin("python preload");
+        pyobj_preload_all(0);
+        lub_prof_end();
+        pyobj_register_fork();
+        pthread_atfork(NULL, NULL, nos_extn_fork_child);
+    } else {
+        pthread_t thread_id;
+
+        rest_session_start();
+        if (!pthread_create(&thread_id, NULL, rest_prewarm_thread, NULL))
+            pthread_detach(thread_id);
+        if (auth_ena) {
+            lub_prof_begin("token thread");
+            clish_rest_thread_init();
+            lub_prof_end();
+        }
+        if (getenv("CLISH_PYOBJ_PRELOAD") &&
+            !pthread_create(&thread_id, NULL, pyobj_preload_thread, NULL))
+            pthread_detach(thread_id);
     }
     
     if (!auth_ena) {
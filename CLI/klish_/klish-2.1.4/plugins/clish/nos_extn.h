@@ -8,14 +8,96 @@ extern "C" {
 
 extern void pyobj_init();
 extern void nos_extn_init();
+extern void nos_extn_rest_barrier();
+extern void nos_extn_block_signals();
 
-extern int call_pyobj(char *cmd, const char *buff, char **out);
+struct timespec;
+
+extern int call_pyobj(const void *context, char *cmd, const char *buff, char **out);
 extern int pyobj_set_rest_token(const char*);
 extern int pyobj_update_environ(const char *key, const char *val);
+extern int pyobj_sync_environ();
+extern void pyobj_register_fork();
+extern int pyobj_preload(const char *name);
+extern void pyobj_interrupt();
+
+/* Reply of rest_request() */
+typedef struct {
+    long status;
+    char *content_type;
+    char *body;
+    size_t len;
+    const char *error;
+} rest_reply_t;
+
+/* Request of rest_request_many() */
+typedef struct {
+    const char *method;
+    const char *path;
+    const char **headers;
+    const char *body;
+    size_t body_len;
+} rest_req_t;
+
+/* Class of the REST requests, sets their timeout */
+typedef enum {
+    REST_CLASS_COMPLETION,
+    REST_CLASS_COMMAND,
+    REST_CLASS_RPC,
+    REST_CLASS_MAX
+} rest_class_e;
+
+/* Error of the requests failed while the server doesn't respond */
+extern const char rest_error_unavailable[];
+/* Error of the requests aborted by Ctrl-C */
+extern const char rest_error_interrupted[];
+
+/* Reply body read while it's received */
+typedef struct rest_stream_s rest_stream_t;
 
 extern void rest_client_init();
 extern int rest_token_fetch(int *interval);
+extern void rest_token_start();
+extern void rest_token_sync();
+extern void rest_session_start();
+extern void rest_session_save();
+extern void rest_prewarm();
 extern int rest_cl(char *cmd, const char *buff);
+extern int rest_request(const char *method, const char *path, const char **headers,
+    const char *body, size_t body_len, rest_reply_t *reply);
+extern int rest_request_many(const rest_req_t *reqs, rest_reply_t *replies,
+    size_t num);
+extern void rest_request_class(rest_class_e cls);
+extern void rest_breaker_export();
+extern void rest_async_begin(unsigned int lineno, const char *line);
+extern void rest_async_end();
+extern int rest_async_barrier();
+extern rest_stream_t *rest_stream_open(const char *method, const char *path,
+    const char **headers, const char *body, size_t body_len, rest_reply_t *reply);
+extern int rest_stream_read(rest_stream_t *stream, const char **data, size_t *len,
+    const char **error);
+extern void rest_stream_close(rest_stream_t *stream);
+
+/* Stages of the command timed by cli_stats */
+typedef enum {
+    CLI_STATS_TOTAL,
+    CLI_STATS_PARSE,
+    CLI_STATS_ACTION,
+    CLI_STATS_REST,
+    CLI_STATS_CONNECT,
+    CLI_STATS_SERVER,
+    CLI_STATS_RENDER,
+    CLI_STATS_MAX
+} cli_stats_stage_e;
+
+extern void cli_stats_begin(const char *name, unsigned long parse_usec);
+extern void cli_stats_add(cli_stats_stage_e stage, unsigned long usec);
+extern void cli_stats_request(unsigned long connect_usec, unsigned long server_usec,
+    unsigned long total_usec);
+extern void cli_stats_end(unsigned long action_usec);
+extern int cli_stats_stage(const char *name);
+extern unsigned long cli_stats_elapsed(const struct timespec *since);
+extern void cli_stats_dump();
 
 #ifdef __cplusplus
 }
@@ -5,10 +5,13 @@
 #include "clish/plugin.h"
 #include "clish/shell.h"
 
+CLISH_PLUGIN_FINI(clish_plugin_clish_fini);
+
 /* Hooks */
 CLISH_HOOK_ACCESS(clish_hook_access);
 CLISH_HOOK_CONFIG(clish_hook_config);
 CLISH_HOOK_LOG(clish_hook_log);
+CLISH_HOOK_STATS(clish_hook_stats);
 
 /* Navy, etc. syms */
 CLISH_PLUGIN_SYM(clish_close);
@@ -24,3 +27,4 @@ CLISH_PLUGIN_SYM(clish_macros);
 CLISH_PLUGIN_SYM(clish_restcl);
 CLISH_PLUGIN_SYM(clish_pyobj);
 CLISH_PLUGIN_SYM(clish_setenv);
+CLISH_PLUGIN_SYM(clish_stats);
@@ -0,0 +1,567 @@
+/*
+###########################################################################
+#
+# Copyright 2019 Dell, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###########################################################################
+*/
+
+/*
+ * The clish_cbor Python module. The application/yang-data+cbor
+ * (RFC 9254) replies are decoded into the same objects as their JSON
+ * by json.loads() with the OrderedDict hook, the request data is
+ * encoded like json.dumps(). The data nodes are named like in JSON,
+ * the YANG SIDs are not used.
+ */
+
+#include "private.h"
+
+#include <Python.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_TAG 6
+#define CBOR_SIMPLE 7
+
+#define CBOR_INDEFINITE 31
+#define CBOR_BREAK 0xff
+
+/* The nesting limit of the data, like the one of the REST server */
+#define CBOR_MAX_DEPTH 512
+
+static PyObject *CborError;
+static PyObject *OrderedDictType;
+
+/*--------------------------------------------------------- */
+/* Decoding */
+
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+    size_t pos;
+} cbor_decoder_t;
+
+static PyObject *cbor_truncated(void) {
+    PyErr_SetString(CborError, "truncated cbor data");
+    return NULL;
+}
+
+/* The initial bytes of the data item. Returns 0 on success. */
+static int cbor_head(cbor_decoder_t *dec, int *major, int *info, uint64_t *arg) {
+    unsigned int size, i;
+
+    if (dec->pos >= dec->len) {
+        cbor_truncated();
+        return -1;
+    }
+    *major = dec->data[dec->pos] >> 5;
+    *info = dec->data[dec->pos] & 0x1f;
+    dec->pos++;
+
+    if (*info < 24 || *info == CBOR_INDEFINITE) {
+        *arg = (*info < 24) ? *info : 0;
+        return 0;
+    }
+    if (*info > 27) {
+        PyErr_Format(CborError, "bad cbor additional info %d", *info);
+        return -1;
+    }
+    size = 1 << (*info - 24);
+    if (dec->len - dec->pos < size) {
+        cbor_truncated();
+        return -1;
+    }
+    *arg = 0;
+    for (i = 0; i < size; i++) {
+        *arg = (*arg << 8) | dec->data[dec->pos++];
+    }
+    return 0;
+}
+
+static int cbor_is_break(cbor_decoder_t *dec) {
+    if (dec->pos < dec->len && dec->data[dec->pos] == CBOR_BREAK) {
+        dec->pos++;
+        return 1;
+    }
+    return 0;
+}
+
+/* The byte or text string as bytes, the chunks of the indefinite
+ * length one are concatenated */
+static PyObject *cbor_string(cbor_decoder_t *dec, int major, int info, uint64_t arg) {
+    PyObject *str, *chunk;
+
+    if (info != CBOR_INDEFINITE) {
+        if (arg > dec->len - dec->pos) {
+            return cbor_truncated();
+        }
+        str = PyBytes_FromStringAndSize((const char *)dec->data + dec->pos, arg);
+        dec->pos += arg;
+        return str;
+    }
+
+    str = PyBytes_FromStringAndSize(NULL, 0);
+    while (str && !cbor_is_break(dec)) {
+        int m, i;
+        uint64_t n;
+
+        if (cbor_head(dec, &m, &i, &n) < 0) {
+            Py_CLEAR(str);
+            break;
+        }
+        if (m != major || i == CBOR_INDEFINITE) {
+            PyErr_SetString(CborError, "bad cbor string chunk");
+            Py_CLEAR(str);
+            break;
+        }
+        chunk = cbor_string(dec, m, i, n);
+        PyBytes_ConcatAndDel(&str, chunk);
+    }
+    return str;
+}
+
+/* The text of the string, byte strings are base64 like the YANG
+ * binary type in JSON */
+static PyObject *cbor_text(cbor_decoder_t *dec, int major, int info, uint64_t arg) {
+    static const char b64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    PyObject *bytes, *text;
+    const unsigned char *in;
+    Py_ssize_t len, i;
+    char *out;
+
+    bytes = cbor_string(dec, major, info, arg);
+    if (!bytes) {
+        return NULL;
+    }
+    in = (const unsigned char *)PyBytes_AS_STRING(bytes);
+    len = PyBytes_GET_SIZE(bytes);
+    if (major == CBOR_TEXT) {
+        text = PyUnicode_DecodeUTF8((const char *)in, len, NULL);
+        Py_DECREF(bytes);
+        return text;
+    }
+
+    text = PyBytes_FromStringAndSize(NULL, (len + 2) / 3 * 4);
+    if (!text) {
+        Py_DECREF(bytes);
+        return NULL;
+    }
+    out = PyBytes_AS_STRING(text);
+    for (i = 0; i < len; i += 3) {
+        uint32_t v = in[i] << 16;
+
+        if (i + 1 < len) {
+            v |= in[i + 1] << 8;
+        }
+        if (i + 2 < len) {
+            v |= in[i + 2];
+        }
+        *out++ = b64[(v >> 18) & 0x3f];
+        *out++ = b64[(v >> 12) & 0x3f];
+        *out++ = (i + 1 < len) ? b64[(v >> 6) & 0x3f] : '=';
+        *out++ = (i + 2 < len) ? b64[v & 0x3f] : '=';
+    }
+    Py_DECREF(bytes);
+    Py_SETREF(text, PyUnicode_FromEncodedObject(text, "ascii", NULL));
+    return text;
+}
+
+static PyObject *cbor_item(cbor_decoder_t *dec, int depth);
+
+static PyObject *cbor_container(cbor_decoder_t *dec, int major, int info,
+                                uint64_t arg, int depth) {
+    PyObject *obj;
+    uint64_t i;
+
+    if (major == CBOR_MAP) {
+        obj = PyObject_CallObject(OrderedDictType, NULL);
+    } else {
+        obj = PyList_New(0);
+    }
+
+    for (i = 0; obj; i++) {
+        PyObject *key = NULL, *value;
+
+        if (info == CBOR_INDEFINITE ? cbor_is_break(dec) : i == arg) {
+            break;
+        }
+        if (major == CBOR_MAP) {
+            int m, ki;
+            uint64_t n;
+
+            if (cbor_head(dec, &m, &ki, &n) < 0) {
+                Py_CLEAR(obj);
+                break;
+            }
+            if (m != CBOR_TEXT) {
+                PyErr_SetString(CborError, "cbor map key is not a text string");
+                Py_CLEAR(obj);
+                break;
+            }
+            key = cbor_text(dec, m, ki, n);
+            if (!key) {
+                Py_CLEAR(obj);
+                break;
+            }
+        }
+
+        value = cbor_item(dec, depth + 1);
+        if (!value ||
+            (key ? PyObject_SetItem(obj, key, value) : PyList_Append(obj, value)) < 0) {
+            Py_CLEAR(obj);
+        }
+        Py_XDECREF(key);
+        Py_XDECREF(value);
+    }
+    return obj;
+}
+
+static double cbor_half(uint16_t half) {
+    int exp = (half >> 10) & 0x1f;
+    double mant = half & 0x3ff;
+    double value;
+
+    if (exp == 0) {
+        value = ldexp(mant, -24);
+    } else if (exp == 31) {
+        value = mant ? Py_NAN : Py_HUGE_VAL;
+    } else {
+        value = ldexp(mant + 1024, exp - 25);
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+static PyObject *cbor_simple(int info, uint64_t arg) {
+    union {
+        uint32_t u;
+        float f;
+    } f32;
+    union {
+        uint64_t u;
+        double d;
+    } f64;
+
+    switch (info) {
+    case 20:
+        Py_RETURN_FALSE;
+    case 21:
+        Py_RETURN_TRUE;
+    case 22: /* null */
+    case 23: /* undefined */
+        Py_RETURN_NONE;
+    case 25:
+        return PyFloat_FromDouble(cbor_half(arg));
+    case 26:
+        f32.u = arg;
+        return PyFloat_FromDouble(f32.f);
+    case 27:
+        f64.u = arg;
+        return PyFloat_FromDouble(f64.d);
+    }
+    PyErr_Format(CborError, "unsupported cbor simple value %d", info);
+    return NULL;
+}
+
+static PyObject *cbor_item(cbor_decoder_t *dec, int depth) {
+    PyObject *value, *neg;
+    int major, info;
+    uint64_t arg;
+
+    if (depth > CBOR_MAX_DEPTH) {
+        PyErr_SetString(CborError, "cbor data nested too deep");
+        return NULL;
+    }
+    if (cbor_head(dec, &major, &info, &arg) < 0) {
+        return NULL;
+    }
+
+    switch (major) {
+    case CBOR_UINT:
+        return PyLong_FromUnsignedLongLong(arg);
+    case CBOR_NEGINT:
+        if (arg <= INT64_MAX) {
+            return PyLong_FromLongLong(-1 - (int64_t)arg);
+        }
+        /* -1 - arg beyond int64 */
+        value = PyLong_FromUnsignedLongLong(arg);
+        neg = value ? PyNumber_Invert(value) : NULL;
+        Py_XDECREF(value);
+        return neg;
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+        return cbor_text(dec, major, info, arg);
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+        return cbor_container(dec, major, info, arg, depth);
+    case CBOR_TAG:
+        /* The tags carry no meaning for the JSON objects */
+        return cbor_item(dec, depth + 1);
+    }
+    return cbor_simple(info, arg);
+}
+
+/* loads(data)
+ * Returns the objects of the CBOR data item in the bytes-like data */
+static PyObject *py_cbor_loads(PyObject *self, PyObject *args) {
+    Py_buffer buf;
+    cbor_decoder_t dec;
+    PyObject *result;
+
+    if (!PyArg_ParseTuple(args, "y*:loads", &buf)) {
+        return NULL;
+    }
+    dec.data = (const unsigned char *)buf.buf;
+    dec.len = buf.len;
+    dec.pos = 0;
+
+    result = cbor_item(&dec, 0);
+    if (result && dec.pos != dec.len) {
+        PyErr_SetString(CborError, "extra data after cbor item");
+        Py_CLEAR(result);
+    }
+    PyBuffer_Release(&buf);
+    return result;
+}
+
+/*--------------------------------------------------------- */
+/* Encoding */
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t size;
+} cbor_encoder_t;
+
+static int cbor_write(cbor_encoder_t *enc, const void *data, size_t len) {
+    if (enc->len + len > enc->size) {
+        size_t size = enc->size * 2 + len;
+        char *grown = PyMem_Realloc(enc->data, size);
+
+        if (!grown) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        enc->data = grown;
+        enc->size = size;
+    }
+    memcpy(enc->data + enc->len, data, len);
+    enc->len += len;
+    return 0;
+}
+
+/* The initial bytes with the argument in the shortest form */
+static int cbor_write_head(cbor_encoder_t *enc, int major, uint64_t arg) {
+    unsigned char head[9];
+    unsigned int size, i;
+
+    if (arg < 24) {
+        head[0] = (major << 5) | arg;
+        return cbor_write(enc, head, 1);
+    }
+    if (arg <= UINT8_MAX) {
+        head[0] = (major << 5) | 24;
+        size = 1;
+    } else if (arg <= UINT16_MAX) {
+        head[0] = (major << 5) | 25;
+        size = 2;
+    } else if (arg <= UINT32_MAX) {
+        head[0] = (major << 5) | 26;
+        size = 4;
+    } else {
+        head[0] = (major << 5) | 27;
+        size = 8;
+    }
+    for (i = 0; i < size; i++) {
+        head[size - i] = arg >> (8 * i);
+    }
+    return cbor_write(enc, head, size + 1);
+}
+
+static int cbor_write_text(cbor_encoder_t *enc, PyObject *obj) {
+    Py_ssize_t len;
+    const char *text = PyUnicode_AsUTF8AndSize(obj, &len);
+
+    if (!text || cbor_write_head(enc, CBOR_TEXT, len) < 0) {
+        return -1;
+    }
+    return cbor_write(enc, text, len);
+}
+
+static int cbor_write_int(cbor_encoder_t *enc, PyObject *obj) {
+    int overflow;
+    long long value = PyLong_AsLongLongAndOverflow(obj, &overflow);
+    unsigned long long uvalue;
+
+    if (value == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (!overflow) {
+        return (value < 0) ? cbor_write_head(enc, CBOR_NEGINT, -1 - value) :
+            cbor_write_head(enc, CBOR_UINT, value);
+    }
+    /* The negative integer is encoded as -1 - value */
+    obj = (overflow < 0) ? PyNumber_Invert(obj) : (Py_INCREF(obj), obj);
+    if (!obj) {
+        return -1;
+    }
+    uvalue = PyLong_AsUnsignedLongLong(obj);
+    Py_DECREF(obj);
+    if (uvalue == (unsigned long long)-1 && PyErr_Occurred()) {
+        PyErr_SetString(CborError, "integer out of cbor range");
+        return -1;
+    }
+    return cbor_write_head(enc, overflow < 0 ? CBOR_NEGINT : CBOR_UINT, uvalue);
+}
+
+static int cbor_write_item(cbor_encoder_t *enc, PyObject *obj, int depth) {
+    Py_ssize_t pos = 0, i;
+    PyObject *key, *value;
+    union {
+        uint64_t u;
+        double d;
+    } f64;
+    unsigned char simple;
+    int ret = 0;
+
+    if (depth > CBOR_MAX_DEPTH) {
+        PyErr_SetString(CborError, "data nested too deep");
+        return -1;
+    }
+
+    if (obj == Py_None || PyBool_Check(obj)) {
+        simple = (CBOR_SIMPLE << 5) | (obj == Py_None ? 22 : (obj == Py_True ? 21 : 20));
+        return cbor_write(enc, &simple, 1);
+    }
+    if (PyLong_Check(obj)) {
+        return cbor_write_int(enc, obj);
+    }
+    if (PyFloat_Check(obj)) {
+        unsigned char head[9];
+
+        f64.d = PyFloat_AS_DOUBLE(obj);
+        head[0] = (CBOR_SIMPLE << 5) | 27;
+        for (i = 0; i < 8; i++) {
+            head[8 - i] = f64.u >> (8 * i);
+        }
+        return cbor_write(enc, head, sizeof(head));
+    }
+    if (PyUnicode_Check(obj)) {
+        return cbor_write_text(enc, obj);
+    }
+    if (PyBytes_Check(obj)) {
+        if (cbor_write_head(enc, CBOR_BYTES, PyBytes_GET_SIZE(obj)) < 0) {
+            return -1;
+        }
+        return cbor_write(enc, PyBytes_AS_STRING(obj), PyBytes_GET_SIZE(obj));
+    }
+    if (PyDict_Check(obj)) {
+        if (cbor_write_head(enc, CBOR_MAP, PyDict_GET_SIZE(obj)) < 0) {
+            return -1;
+        }
+        while (!ret && PyDict_Next(obj, &pos, &key, &value)) {
+            if (!PyUnicode_Check(key)) {
+                PyErr_SetString(PyExc_TypeError, "keys must be str");
+                return -1;
+            }
+            ret = cbor_write_text(enc, key);
+            if (!ret) {
+                ret = cbor_write_item(enc, value, depth + 1);
+            }
+        }
+        return ret;
+    }
+    if (PyList_Check(obj) || PyTuple_Check(obj)) {
+        PyObject *fast = PySequence_Fast(obj, "not a sequence");
+
+        if (!fast) {
+            return -1;
+        }
+        ret = cbor_write_head(enc, CBOR_ARRAY, PySequence_Fast_GET_SIZE(fast));
+        for (i = 0; !ret && i < PySequence_Fast_GET_SIZE(fast); i++) {
+            ret = cbor_write_item(enc, PySequence_Fast_GET_ITEM(fast, i), depth + 1);
+        }
+        Py_DECREF(fast);
+        return ret;
+    }
+
+    PyErr_Format(PyExc_TypeError, "Object of type %s is not CBOR serializable",
+                 Py_TYPE(obj)->tp_name);
+    return -1;
+}
+
+/* dumps(obj)
+ * Returns the CBOR data item of the JSON-like objects as bytes */
+static PyObject *py_cbor_dumps(PyObject *self, PyObject *obj) {
+    cbor_encoder_t enc = {NULL, 0, 0};
+    PyObject *result = NULL;
+
+    if (cbor_write_item(&enc, obj, 0) == 0) {
+        result = PyBytes_FromStringAndSize(enc.data, enc.len);
+    }
+    PyMem_Free(enc.data);
+    return result;
+}
+
+static PyMethodDef py_cbor_methods[] = {
+    {"loads", py_cbor_loads, METH_VARARGS,
+     "loads(data) -> object, maps are decoded as OrderedDict"},
+    {"dumps", py_cbor_dumps, METH_O,
+     "dumps(obj) -> bytes"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef py_cbor_module = {
+    PyModuleDef_HEAD_INIT,
+    "clish_cbor",
+    "CBOR encoding of the YANG data",
+    -1,
+    py_cbor_methods,
+};
+
+PyMODINIT_FUNC PyInit_clish_cbor(void) {
+    PyObject *module, *collections;
+
+    collections = PyImport_ImportModule("collections");
+    if (!collections) {
+        return NULL;
+    }
+    Py_XSETREF(OrderedDictType, PyObject_GetAttrString(collections, "OrderedDict"));
+    Py_DECREF(collections);
+    if (!OrderedDictType) {
+        return NULL;
+    }
+
+    module = PyModule_Create(&py_cbor_module);
+    if (!module) {
+        return NULL;
+    }
+    CborError = PyErr_NewException("clish_cbor.error", PyExc_ValueError, NULL);
+    Py_XINCREF(CborError);
+    if (PyModule_AddObject(module, "error", CborError) < 0) {
+        Py_XDECREF(CborError);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    return module;
+}
@@ -0,0 +1,186 @@
+/*
+###########################################################################
+#
+# Copyright 2019 Dell, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###########################################################################
+*/
+
+/*
+ * The clish_natsort Python module. The actioners sort the interface
+ * names in the same natural order as the help and completion listings,
+ * the comparison is done by lub_string_natcmp() without splitting the
+ * names into Python lists. The module exists only inside clish,
+ * outside it the actioners import natsorted() of the natsort package.
+ */
+
+#include "private.h"
+#include "lub/string.h"
+
+#include <Python.h>
+
+/* The sort key. The non-string values are compared by their str(),
+ * the item is the element of the sorted sequence for natsorted(). */
+typedef struct {
+    PyObject_HEAD
+    PyObject *str;
+    const char *text;
+    PyObject *item;
+} NatKeyObject;
+
+static void natkey_dealloc(PyObject *self) {
+    NatKeyObject *key = (NatKeyObject *)self;
+
+    Py_XDECREF(key->str);
+    Py_XDECREF(key->item);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PyTypeObject NatKeyType;
+
+static PyObject *natkey_richcompare(PyObject *self, PyObject *other, int op) {
+    int result;
+
+    if (!PyObject_TypeCheck(other, &NatKeyType)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    result = lub_string_natcmp(((NatKeyObject *)self)->text,
+                               ((NatKeyObject *)other)->text);
+    Py_RETURN_RICHCOMPARE(result, 0, op);
+}
+
+static PyTypeObject NatKeyType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "clish_natsort.NatKey",
+    .tp_basicsize = sizeof(NatKeyObject),
+    .tp_dealloc = natkey_dealloc,
+    .tp_richcompare = natkey_richcompare,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Natural order sort key",
+};
+
+static PyObject *natkey_new(PyObject *value, PyObject *item) {
+    NatKeyObject *key;
+
+    key = PyObject_New(NatKeyObject, &NatKeyType);
+    if (!key) {
+        return NULL;
+    }
+    key->item = NULL;
+    key->str = PyObject_Str(value);
+    key->text = key->str ? PyUnicode_AsUTF8(key->str) : NULL;
+    if (!key->text) {
+        Py_DECREF(key);
+        return NULL;
+    }
+    Py_XINCREF(item);
+    key->item = item;
+
+    return (PyObject *)key;
+}
+
+static PyObject *py_natsort_key(PyObject *self, PyObject *value) {
+    return natkey_new(value, NULL);
+}
+
+static PyObject *py_natsort_natsorted(PyObject *self, PyObject *args,
+                                      PyObject *kwargs) {
+    static char *kwlist[] = {"seq", "key", "reverse", NULL};
+    PyObject *seq, *key = Py_None;
+    int reverse = 0;
+    PyObject *list, *sort = NULL, *sort_args = NULL, *sort_kwargs = NULL;
+    PyObject *ret;
+    Py_ssize_t i;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Op:natsorted", kwlist,
+                                     &seq, &key, &reverse)) {
+        return NULL;
+    }
+    list = PySequence_List(seq);
+    if (!list) {
+        return NULL;
+    }
+
+    /* Decorate the items with their keys, sort and undecorate */
+    for (i = 0; i < PyList_GET_SIZE(list); i++) {
+        PyObject *item = PyList_GET_ITEM(list, i);
+        PyObject *value, *natkey;
+
+        value = (key == Py_None) ? (Py_INCREF(item), item) :
+                PyObject_CallOneArg(key, item);
+        if (!value) {
+            goto error;
+        }
+        natkey = natkey_new(value, item);
+        Py_DECREF(value);
+        if (!natkey) {
+            goto error;
+        }
+        PyList_SetItem(list, i, natkey);
+    }
+
+    sort = PyObject_GetAttrString(list, "sort");
+    sort_args = PyTuple_New(0);
+    sort_kwargs = Py_BuildValue("{s:O}", "reverse", reverse ? Py_True : Py_False);
+    if (!sort || !sort_args || !sort_kwargs) {
+        goto error;
+    }
+    ret = PyObject_Call(sort, sort_args, sort_kwargs);
+    if (!ret) {
+        goto error;
+    }
+    Py_DECREF(ret);
+
+    for (i = 0; i < PyList_GET_SIZE(list); i++) {
+        PyObject *item = ((NatKeyObject *)PyList_GET_ITEM(list, i))->item;
+
+        Py_INCREF(item);
+        PyList_SetItem(list, i, item);
+    }
+    Py_DECREF(sort);
+    Py_DECREF(sort_args);
+    Py_DECREF(sort_kwargs);
+    return list;
+
+error:
+    Py_XDECREF(sort);
+    Py_XDECREF(sort_args);
+    Py_XDECREF(sort_kwargs);
+    Py_DECREF(list);
+    return NULL;
+}
+
+static PyMethodDef py_natsort_methods[] = {
+    {"key", py_natsort_key, METH_O,
+     "key(value) -> sort key in the natural order"},
+    {"natsorted", (PyCFunction)(void(*)(void))py_natsort_natsorted, METH_VARARGS | METH_KEYWORDS,
+     "natsorted(seq, key=None, reverse=False) -> list sorted in the natural order"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef py_natsort_module = {
+    PyModuleDef_HEAD_INIT,
+    "clish_natsort",
+    "Natural order sorting of the interface names like in the clish help",
+    -1,
+    py_natsort_methods,
+};
+
+PyMODINIT_FUNC PyInit_clish_natsort(void) {
+    if (PyType_Ready(&NatKeyType) < 0) {
+        return NULL;
+    }
+    return PyModule_Create(&py_natsort_module);
+}
@@ -0,0 +1,495 @@
+/*
+###########################################################################
+#
+# Copyright 2019 Dell, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###########################################################################
+*/
+
+/*
+ * The clish_rest Python module. The actioners issue the REST requests
+ * through the curl handle of the plugin, so they share its kept-alive
+ * connection and token.
+ */
+
+#include "private.h"
+#include "nos_extn.h"
+
+#include <Python.h>
+#include <structmember.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The reply body. It exports the buffer received by curl, so the
+ * memoryview over it needs no copy. */
+typedef struct {
+    PyObject_HEAD
+    char *data;
+    Py_ssize_t len;
+} BodyObject;
+
+static int body_getbuffer(PyObject *self, Py_buffer *view, int flags) {
+    BodyObject *body = (BodyObject *)self;
+
+    return PyBuffer_FillInfo(view, self, body->data, body->len, 1, flags);
+}
+
+static void body_dealloc(PyObject *self) {
+    BodyObject *body = (BodyObject *)self;
+
+    free(body->data);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PyBufferProcs body_as_buffer = {
+    body_getbuffer,
+    NULL,
+};
+
+static PyTypeObject BodyType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "clish_rest.Body",
+    .tp_basicsize = sizeof(BodyObject),
+    .tp_dealloc = body_dealloc,
+    .tp_as_buffer = &body_as_buffer,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "REST reply body",
+};
+
+static PyObject *RestError;
+/* Raised while the breaker of the server is open */
+static PyObject *RestUnavailable;
+
+static PyObject *py_rest_error(const char *error) {
+    /* Ctrl-C stops the command like in Python code */
+    if (error == rest_error_interrupted) {
+        return PyExc_KeyboardInterrupt;
+    }
+    return (error == rest_error_unavailable) ? RestUnavailable : RestError;
+}
+
+/* The reply body read while it's received. Iteration returns the
+ * received parts of the body as bytes. */
+typedef struct {
+    PyObject_HEAD
+    rest_stream_t *stream;
+    long status;
+    PyObject *content_type;
+} StreamObject;
+
+static void stream_close(StreamObject *obj) {
+    if (obj->stream) {
+        rest_stream_close(obj->stream);
+        obj->stream = NULL;
+    }
+}
+
+static void stream_dealloc(PyObject *self) {
+    StreamObject *obj = (StreamObject *)self;
+
+    stream_close(obj);
+    Py_XDECREF(obj->content_type);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PyObject *stream_next(PyObject *self) {
+    StreamObject *obj = (StreamObject *)self;
+    const char *data = NULL, *error = NULL;
+    size_t len = 0;
+    int ret;
+
+    if (!obj->stream) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = rest_stream_read(obj->stream, &data, &len, &error);
+    Py_END_ALLOW_THREADS
+
+    if (ret > 0) {
+        return PyBytes_FromStringAndSize(data, len);
+    }
+    stream_close(obj);
+    if (ret < 0) {
+        PyErr_SetString(py_rest_error(error), error ? error : "read failed");
+    }
+    return NULL;
+}
+
+static PyObject *stream_close_method(PyObject *self, PyObject *unused) {
+    stream_close((StreamObject *)self);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef stream_methods[] = {
+    {"close", stream_close_method, METH_NOARGS,
+     "close() aborts the transfer if the body is not read till the end"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyMemberDef stream_members[] = {
+    {"status", T_LONG, offsetof(StreamObject, status), READONLY, "HTTP status"},
+    {"content_type", T_OBJECT, offsetof(StreamObject, content_type), READONLY,
+     "Content-Type of the reply"},
+    {NULL}
+};
+
+static PyTypeObject StreamType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "clish_rest.Stream",
+    .tp_basicsize = sizeof(StreamObject),
+    .tp_dealloc = stream_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "REST reply body read while it's received",
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = stream_next,
+    .tp_methods = stream_methods,
+    .tp_members = stream_members,
+};
+
+
+/* Convert the headers sequence to the NULL terminated array. The
+ * strings are owned by the sequence which is replaced by the fast
+ * sequence, the caller releases it. */
+static const char **py_rest_headers(PyObject **headers) {
+    const char **hdrs;
+    Py_ssize_t i, num = 0;
+
+    if (*headers && *headers != Py_None) {
+        *headers = PySequence_Fast(*headers, "headers must be a sequence");
+        if (!*headers) {
+            return NULL;
+        }
+        num = PySequence_Fast_GET_SIZE(*headers);
+    } else {
+        *headers = NULL;
+    }
+    hdrs = (const char **)calloc(num + 1, sizeof(char *));
+    if (!hdrs) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    for (i = 0; i < num; i++) {
+        hdrs[i] = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(*headers, i));
+        if (!hdrs[i]) {
+            free(hdrs);
+            return NULL;
+        }
+    }
+
+    return hdrs;
+}
+
+/* The reply tuple of request() */
+static PyObject *py_rest_reply(rest_reply_t *reply) {
+    PyObject *view, *result = NULL;
+    BodyObject *obj;
+
+    obj = PyObject_New(BodyObject, &BodyType);
+    if (!obj) {
+        free(reply->body);
+        free(reply->content_type);
+        return NULL;
+    }
+    obj->data = reply->body;
+    obj->len = reply->len;
+
+    view = PyMemoryView_FromObject((PyObject *)obj);
+    Py_DECREF(obj);
+    if (view) {
+        result = Py_BuildValue("(lzN)", reply->status, reply->content_type, view);
+    }
+    free(reply->content_type);
+
+    return result;
+}
+
+/* request(method, path, headers=None, body=None)
+ * Returns (status, content_type, memoryview of body) */
+static PyObject *py_rest_request(PyObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"method", "path", "headers", "body", NULL};
+    const char *method, *path;
+    PyObject *headers = NULL;
+    Py_buffer body = {0};
+    const char **hdrs = NULL;
+    rest_reply_t reply;
+    PyObject *result = NULL;
+    int ret;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|Oz*", kwlist,
+            &method, &path, &headers, &body)) {
+        return NULL;
+    }
+
+    hdrs = py_rest_headers(&headers);
+    if (!hdrs) {
+        goto out;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = rest_request(method, path, hdrs, (const char *)body.buf,
+        body.buf ? (size_t)body.len : 0, &reply);
+    Py_END_ALLOW_THREADS
+
+    if (ret < 0) {
+        PyErr_SetString(py_rest_error(reply.error),
+            reply.error ? reply.error : "request failed");
+        goto out;
+    }
+
+    result = py_rest_reply(&reply);
+
+out:
+    free(hdrs);
+    Py_XDECREF(headers);
+    PyBuffer_Release(&body);
+    return result;
+}
+
+/* request_many(requests)
+ * The requests are (method, path, headers=None, body=None) tuples.
+ * They are issued concurrently, the replies are returned in their
+ * order. A failed request gets the clish_rest.error instance in
+ * place of the reply tuple. */
+static PyObject *py_rest_request_many(PyObject *self, PyObject *args) {
+    PyObject *seq, *fast;
+    Py_ssize_t num, i, parsed = 0;
+    rest_req_t *reqs = NULL;
+    rest_reply_t *replies = NULL;
+    PyObject **headers = NULL;
+    Py_buffer *bodies = NULL;
+    PyObject *result = NULL;
+    int ret;
+
+    if (!PyArg_ParseTuple(args, "O:request_many", &seq)) {
+        return NULL;
+    }
+    fast = PySequence_Fast(seq, "requests must be a sequence");
+    if (!fast) {
+        return NULL;
+    }
+    num = PySequence_Fast_GET_SIZE(fast);
+
+    reqs = (rest_req_t *)calloc(num + 1, sizeof(*reqs));
+    replies = (rest_reply_t *)calloc(num + 1, sizeof(*replies));
+    headers = (PyObject **)calloc(num + 1, sizeof(*headers));
+    bodies = (Py_buffer *)calloc(num + 1, sizeof(*bodies));
+    if (!reqs || !replies || !headers || !bodies) {
+        PyErr_NoMemory();
+        goto out;
+    }
+
+    for (i = 0; i < num; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+
+        if (!PyTuple_Check(item)) {
+            PyErr_SetString(PyExc_TypeError, "request must be a tuple");
+            goto out;
+        }
+        if (!PyArg_ParseTuple(item, "ss|Oz*:request_many", &reqs[i].method,
+                &reqs[i].path, &headers[i], &bodies[i])) {
+            goto out;
+        }
+        parsed++;
+        reqs[i].headers = py_rest_headers(&headers[i]);
+        if (!reqs[i].headers) {
+            goto out;
+        }
+        reqs[i].body = (const char *)bodies[i].buf;
+        reqs[i].body_len = bodies[i].buf ? (size_t)bodies[i].len : 0;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = rest_request_many(reqs, replies, num);
+    Py_END_ALLOW_THREADS
+
+    if (ret < 0) {
+        PyErr_SetString(py_rest_error(replies[0].error),
+            replies[0].error ? replies[0].error : "request failed");
+        goto out;
+    }
+
+    /* The interrupted requests fail the whole call */
+    for (i = 0; i < num && replies[i].error != rest_error_interrupted; i++) {
+    }
+    if (i < num) {
+        PyErr_SetString(PyExc_KeyboardInterrupt, rest_error_interrupted);
+    } else {
+        result = PyList_New(num);
+    }
+    for (i = 0; i < num; i++) {
+        PyObject *reply;
+
+        if (!result) {
+            free(replies[i].body);
+            free(replies[i].content_type);
+            continue;
+        }
+        if (replies[i].error) {
+            reply = PyObject_CallFunction(py_rest_error(replies[i].error), "s",
+                replies[i].error);
+        } else {
+            reply = py_rest_reply(&replies[i]);
+        }
+        if (!reply) {
+            Py_CLEAR(result);
+            continue;
+        }
+        PyList_SET_ITEM(result, i, reply);
+    }
+
+out:
+    /* The parsed headers are replaced by the new references */
+    for (i = 0; i < parsed; i++) {
+        free((void *)reqs[i].headers);
+        Py_XDECREF(headers[i]);
+        PyBuffer_Release(&bodies[i]);
+    }
+    free(reqs);
+    free(replies);
+    free(headers);
+    free(bodies);
+    Py_DECREF(fast);
+    return result;
+}
+
+/* stream(method, path, headers=None, body=None)
+ * Returns the Stream once the reply headers are received */
+static PyObject *py_rest_stream(PyObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"method", "path", "headers", "body", NULL};
+    const char *method, *path;
+    PyObject *headers = NULL;
+    Py_buffer body = {0};
+    const char **hdrs = NULL;
+    rest_reply_t reply;
+    rest_stream_t *stream;
+    StreamObject *obj = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|Oz*", kwlist,
+            &method, &path, &headers, &body)) {
+        return NULL;
+    }
+
+    hdrs = py_rest_headers(&headers);
+    if (!hdrs) {
+        goto out;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    stream = rest_stream_open(method, path, hdrs, (const char *)body.buf,
+        body.buf ? (size_t)body.len : 0, &reply);
+    Py_END_ALLOW_THREADS
+
+    if (!stream) {
+        PyErr_SetString(py_rest_error(reply.error),
+            reply.error ? reply.error : "request failed");
+        goto out;
+    }
+
+    obj = PyObject_New(StreamObject, &StreamType);
+    if (!obj) {
+        rest_stream_close(stream);
+        free(reply.content_type);
+        goto out;
+    }
+    obj->stream = stream;
+    obj->status = reply.status;
+    if (reply.content_type) {
+        obj->content_type = PyUnicode_FromString(reply.content_type);
+    } else {
+        Py_INCREF(Py_None);
+        obj->content_type = Py_None;
+    }
+    free(reply.content_type);
+    if (!obj->content_type) {
+        Py_CLEAR(obj);
+    }
+
+out:
+    free(hdrs);
+    Py_XDECREF(headers);
+    PyBuffer_Release(&body);
+    return (PyObject *)obj;
+}
+
+/* add_time(stage, seconds)
+ * Adds the time of the stage, like "render", to the statistics of
+ * the command being run */
+static PyObject *py_rest_add_time(PyObject *self, PyObject *args) {
+    const char *name;
+    double seconds;
+    int stage;
+
+    if (!PyArg_ParseTuple(args, "sd", &name, &seconds)) {
+        return NULL;
+    }
+    stage = cli_stats_stage(name);
+    if (stage < 0) {
+        PyErr_Format(PyExc_ValueError, "unknown stage %s", name);
+        return NULL;
+    }
+    if (seconds > 0) {
+        cli_stats_add((cli_stats_stage_e)stage, (unsigned long)(seconds * 1000000));
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef py_rest_methods[] = {
+    {"request", (PyCFunction)(void(*)(void))py_rest_request, METH_VARARGS | METH_KEYWORDS,
+     "request(method, path, headers=None, body=None) -> (status, content_type, body)"},
+    {"stream", (PyCFunction)(void(*)(void))py_rest_stream, METH_VARARGS | METH_KEYWORDS,
+     "stream(method, path, headers=None, body=None) -> Stream"},
+    {"request_many", py_rest_request_many, METH_VARARGS,
+     "request_many(requests) -> list of (status, content_type, body) or error"},
+    {"add_time", py_rest_add_time, METH_VARARGS,
+     "add_time(stage, seconds) -> None"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef py_rest_module = {
+    PyModuleDef_HEAD_INIT,
+    "clish_rest",
+    "REST requests through the clish plugin's curl handle",
+    -1,
+    py_rest_methods,
+};
+
+PyMODINIT_FUNC PyInit_clish_rest(void) {
+    PyObject *module;
+
+    if (PyType_Ready(&BodyType) < 0 || PyType_Ready(&StreamType) < 0) {
+        return NULL;
+    }
+    module = PyModule_Create(&py_rest_module);
+    if (!module) {
+        return NULL;
+    }
+    RestError = PyErr_NewException("clish_rest.error", PyExc_OSError, NULL);
+    Py_XINCREF(RestError);
+    if (PyModule_AddObject(module, "error", RestError) < 0) {
+        Py_XDECREF(RestError);
+        Py_DECREF(module);
+        return NULL;
+    }
+    RestUnavailable = PyErr_NewException("clish_rest.unavailable", RestError, NULL);
+    Py_XINCREF(RestUnavailable);
+    if (PyModule_AddObject(module, "unavailable", RestUnavailable) < 0) {
+        Py_XDECREF(RestUnavailable);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    return module;
+}
@@ -0,0 +1,744 @@
+/*
+###########################################################################
+#
+# Copyright 2019 Dell, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###########################################################################
+*/
+
+/*
+ * The clish_table Python module. The renderer prints the plain tables
+ * by the declarative column spec instead of the Jinja template. The
+ * spec is compiled once, the rows are formatted one by one as the
+ * pager pulls the lines.
+ *
+ * The spec is the dict:
+ *   "rows"    - path to the list of rows, "*" stands for every key
+ *   "filter"  - {"path": ..., "contains": text}, the rows to print
+ *   "rule"    - the line printed above and below the header
+ *   "columns" - list of the columns:
+ *     "header"  - the column title
+ *     "path"    - path to the value in the row, the keys joined by "/"
+ *     "width"   - the value is padded to the width, it's not cut
+ *     "align"   - "left" (default) or "right"
+ *     "replace" - list of [old, new] substitutions
+ *     "map"     - {value: text}, the "*" entry maps the other values
+ *     "case"    - "lower" or "upper"
+ *     "empty"   - the text printed instead of the empty string
+ *     "format"  - "datetime" prints the epoch seconds as local time
+ * The missing value is printed as the empty cell.
+ */
+
+#include "private.h"
+
+#include <Python.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    PyObject *path;
+    PyObject *header;
+    Py_ssize_t width;
+    int right;
+    PyObject *replace;
+    PyObject *map;
+    PyObject *map_other;
+    const char *text_case;
+    PyObject *empty;
+    int datetime;
+} table_column_t;
+
+/* The compiled spec */
+typedef struct {
+    PyObject_HEAD
+    PyObject *rows;
+    PyObject *filter_path;
+    PyObject *filter_contains;
+    PyObject *rule;
+    table_column_t *columns;
+    Py_ssize_t columns_num;
+} TableObject;
+
+/* The lines of the table being rendered */
+typedef struct {
+    PyObject_HEAD
+    TableObject *table;
+    PyObject *sources;
+    Py_ssize_t source;
+    PyObject *rows;
+    int heading;
+} RenderObject;
+
+static PyTypeObject TableType;
+static PyTypeObject RenderType;
+
+/*--------------------------------------------------------- */
+static PyObject *table_split_path(PyObject *path) {
+    PyObject *sep, *keys;
+
+    if (!PyUnicode_Check(path)) {
+        PyErr_SetString(PyExc_ValueError, "table path must be a string");
+        return NULL;
+    }
+    if (!PyUnicode_GET_LENGTH(path)) {
+        return PyTuple_New(0);
+    }
+    sep = PyUnicode_FromString("/");
+    if (!sep) {
+        return NULL;
+    }
+    keys = PyUnicode_Split(path, sep, -1);
+    Py_DECREF(sep);
+    if (!keys) {
+        return NULL;
+    }
+    Py_SETREF(keys, PyList_AsTuple(keys));
+
+    return keys;
+}
+
+/* Returns the borrowed value at the path or NULL if it's missing */
+static PyObject *table_lookup(PyObject *obj, PyObject *path) {
+    Py_ssize_t i;
+
+    for (i = 0; obj && (i < PyTuple_GET_SIZE(path)); i++) {
+        if (!PyDict_Check(obj)) {
+            return NULL;
+        }
+        obj = PyDict_GetItemWithError(obj, PyTuple_GET_ITEM(path, i));
+    }
+
+    return obj;
+}
+
+/*--------------------------------------------------------- */
+static void table_dealloc(PyObject *self) {
+    TableObject *table = (TableObject *)self;
+    Py_ssize_t i;
+
+    for (i = 0; i < table->columns_num; i++) {
+        table_column_t *col = &table->columns[i];
+
+        Py_XDECREF(col->path);
+        Py_XDECREF(col->header);
+        Py_XDECREF(col->replace);
+        Py_XDECREF(col->map);
+        Py_XDECREF(col->map_other);
+        Py_XDECREF(col->empty);
+    }
+    PyMem_Free(table->columns);
+    Py_XDECREF(table->rows);
+    Py_XDECREF(table->filter_path);
+    Py_XDECREF(table->filter_contains);
+    Py_XDECREF(table->rule);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PyObject *spec_string(PyObject *spec, const char *name) {
+    PyObject *value = PyDict_GetItemString(spec, name);
+
+    if (!value) {
+        return NULL;
+    }
+    if (!PyUnicode_Check(value)) {
+        PyErr_Format(PyExc_ValueError, "table spec \"%s\" must be a string", name);
+        return NULL;
+    }
+    Py_INCREF(value);
+    return value;
+}
+
+static int table_compile_column(table_column_t *col, PyObject *spec) {
+    PyObject *value;
+
+    if (!PyDict_Check(spec)) {
+        PyErr_SetString(PyExc_ValueError, "table column must be a dict");
+        return -1;
+    }
+    value = PyDict_GetItemString(spec, "path");
+    if (!value) {
+        PyErr_SetString(PyExc_ValueError, "table column has no path");
+        return -1;
+    }
+    col->path = table_split_path(value);
+    if (!col->path) {
+        return -1;
+    }
+    col->header = spec_string(spec, "header");
+    if (!col->header) {
+        if (PyErr_Occurred()) {
+            return -1;
+        }
+        col->header = PyUnicode_FromString("");
+    }
+    value = PyDict_GetItemString(spec, "width");
+    if (value) {
+        col->width = PyLong_AsSsize_t(value);
+        if (PyErr_Occurred()) {
+            return -1;
+        }
+    }
+    value = PyDict_GetItemString(spec, "align");
+    if (value) {
+        col->right = PyUnicode_Check(value) &&
+                     !PyUnicode_CompareWithASCIIString(value, "right");
+    }
+    value = PyDict_GetItemString(spec, "replace");
+    if (value) {
+        PyObject *pairs = PySequence_Fast(value, "table column replace must be a list");
+        Py_ssize_t i;
+
+        if (!pairs) {
+            return -1;
+        }
+        col->replace = PyTuple_New(PySequence_Fast_GET_SIZE(pairs));
+        if (!col->replace) {
+            Py_DECREF(pairs);
+            return -1;
+        }
+        for (i = 0; i < PyTuple_GET_SIZE(col->replace); i++) {
+            PyObject *pair = PySequence_Tuple(PySequence_Fast_GET_ITEM(pairs, i));
+
+            if (!pair || (PyTuple_GET_SIZE(pair) != 2) ||
+                !PyUnicode_Check(PyTuple_GET_ITEM(pair, 0)) ||
+                !PyUnicode_Check(PyTuple_GET_ITEM(pair, 1))) {
+                Py_XDECREF(pair);
+                Py_DECREF(pairs);
+                if (!PyErr_Occurred()) {
+                    PyErr_SetString(PyExc_ValueError,
+                                    "table column replace must be [old, new] pairs");
+                }
+                return -1;
+            }
+            PyTuple_SET_ITEM(col->replace, i, pair);
+        }
+        Py_DECREF(pairs);
+    }
+    value = PyDict_GetItemString(spec, "map");
+    if (value) {
+        if (!PyDict_Check(value)) {
+            PyErr_SetString(PyExc_ValueError, "table column map must be a dict");
+            return -1;
+        }
+        col->map = PyDict_Copy(value);
+        if (!col->map) {
+            return -1;
+        }
+        col->map_other = PyDict_GetItemString(col->map, "*");
+        Py_XINCREF(col->map_other);
+    }
+    value = PyDict_GetItemString(spec, "case");
+    if (value && PyUnicode_Check(value)) {
+        if (!PyUnicode_CompareWithASCIIString(value, "lower")) {
+            col->text_case = "lower";
+        } else if (!PyUnicode_CompareWithASCIIString(value, "upper")) {
+            col->text_case = "upper";
+        }
+    }
+    col->empty = spec_string(spec, "empty");
+    if (!col->empty && PyErr_Occurred()) {
+        return -1;
+    }
+    value = PyDict_GetItemString(spec, "format");
+    if (value) {
+        col->datetime = PyUnicode_Check(value) &&
+                        !PyUnicode_CompareWithASCIIString(value, "datetime");
+    }
+
+    return 0;
+}
+
+static PyObject *py_table_compile(PyObject *self, PyObject *spec) {
+    TableObject *table;
+    PyObject *value, *columns = NULL;
+    Py_ssize_t i;
+
+    if (!PyDict_Check(spec)) {
+        PyErr_SetString(PyExc_ValueError, "table spec must be a dict");
+        return NULL;
+    }
+    table = PyObject_New(TableObject, &TableType);
+    if (!table) {
+        return NULL;
+    }
+    table->rows = NULL;
+    table->filter_path = NULL;
+    table->filter_contains = NULL;
+    table->rule = NULL;
+    table->columns = NULL;
+    table->columns_num = 0;
+
+    value = PyDict_GetItemString(spec, "rows");
+    table->rows = value ? table_split_path(value) : PyTuple_New(0);
+    if (!table->rows) {
+        goto error;
+    }
+    value = PyDict_GetItemString(spec, "filter");
+    if (value) {
+        if (!PyDict_Check(value) || !PyDict_GetItemString(value, "path")) {
+            PyErr_SetString(PyExc_ValueError, "table filter has no path");
+            goto error;
+        }
+        table->filter_path = table_split_path(PyDict_GetItemString(value, "path"));
+        if (!table->filter_path) {
+            goto error;
+        }
+        table->filter_contains = spec_string(value, "contains");
+        if (!table->filter_contains) {
+            if (!PyErr_Occurred()) {
+                PyErr_SetString(PyExc_ValueError, "table filter has no contains");
+            }
+            goto error;
+        }
+    }
+    table->rule = spec_string(spec, "rule");
+    if (!table->rule && PyErr_Occurred()) {
+        goto error;
+    }
+
+    value = PyDict_GetItemString(spec, "columns");
+    columns = value ? PySequence_Fast(value, "table columns must be a list") : NULL;
+    if (!columns) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError, "table spec has no columns");
+        }
+        goto error;
+    }
+    table->columns = PyMem_Calloc(PySequence_Fast_GET_SIZE(columns) + 1,
+                                  sizeof(*table->columns));
+    if (!table->columns) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    for (i = 0; i < PySequence_Fast_GET_SIZE(columns); i++) {
+        table->columns_num++;
+        if (table_compile_column(&table->columns[i],
+                                 PySequence_Fast_GET_ITEM(columns, i)) < 0) {
+            goto error;
+        }
+    }
+    Py_DECREF(columns);
+
+    return (PyObject *)table;
+
+error:
+    Py_XDECREF(columns);
+    Py_DECREF(table);
+    return NULL;
+}
+
+/*--------------------------------------------------------- */
+static PyObject *table_datetime(PyObject *value) {
+    long long seconds;
+    time_t t;
+    struct tm tm;
+    char buf[32];
+
+    if (PyUnicode_Check(value)) {
+        PyObject *num = PyLong_FromUnicodeObject(value, 10);
+
+        if (!num) {
+            return NULL;
+        }
+        seconds = PyLong_AsLongLong(num);
+        Py_DECREF(num);
+    } else {
+        seconds = PyLong_AsLongLong(value);
+    }
+    if ((-1 == seconds) && PyErr_Occurred()) {
+        return NULL;
+    }
+    t = (time_t)seconds;
+    if (!localtime_r(&t, &tm) ||
+        !strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm)) {
+        PyErr_SetString(PyExc_ValueError, "invalid timestamp");
+        return NULL;
+    }
+
+    return PyUnicode_FromString(buf);
+}
+
+/* Returns the new reference to the text of the cell */
+static PyObject *table_cell(const table_column_t *col, PyObject *row) {
+    PyObject *value = table_lookup(row, col->path);
+    PyObject *text;
+    Py_ssize_t i;
+
+    if (!value) {
+        if (PyErr_Occurred()) {
+            return NULL;
+        }
+        text = PyUnicode_FromString("");
+    } else if (col->datetime) {
+        text = table_datetime(value);
+    } else {
+        text = PyObject_Str(value);
+    }
+    if (!text) {
+        return NULL;
+    }
+
+    for (i = 0; col->replace && (i < PyTuple_GET_SIZE(col->replace)); i++) {
+        PyObject *pair = PyTuple_GET_ITEM(col->replace, i);
+
+        Py_SETREF(text, PyUnicode_Replace(text, PyTuple_GET_ITEM(pair, 0),
+                                          PyTuple_GET_ITEM(pair, 1), -1));
+        if (!text) {
+            return NULL;
+        }
+    }
+    if (col->map) {
+        PyObject *mapped = PyDict_GetItemWithError(col->map, text);
+
+        if (!mapped && PyErr_Occurred()) {
+            Py_DECREF(text);
+            return NULL;
+        }
+        if (!mapped) {
+            mapped = col->map_other;
+        }
+        if (mapped) {
+            Py_SETREF(text, PyObject_Str(mapped));
+            if (!text) {
+                return NULL;
+            }
+        }
+    }
+    if (col->text_case) {
+        Py_SETREF(text, PyObject_CallMethod(text, col->text_case, NULL));
+        if (!text) {
+            return NULL;
+        }
+    }
+    if (col->empty && !PyUnicode_GET_LENGTH(text)) {
+        Py_INCREF(col->empty);
+        Py_SETREF(text, col->empty);
+    }
+
+    return text;
+}
+
+/* Joins the cells padded to the column widths into one line.
+ * The cells are stolen. */
+static PyObject *table_line(const TableObject *table, PyObject **cells) {
+    Py_ssize_t len = 0, pos = 0;
+    Py_UCS4 maxchar = 127;
+    PyObject *line = NULL;
+    Py_ssize_t i;
+
+    for (i = 0; i < table->columns_num; i++) {
+        Py_ssize_t cell_len = PyUnicode_GET_LENGTH(cells[i]);
+
+        len += (cell_len > table->columns[i].width) ?
+               cell_len : table->columns[i].width;
+        if (PyUnicode_MAX_CHAR_VALUE(cells[i]) > maxchar) {
+            maxchar = PyUnicode_MAX_CHAR_VALUE(cells[i]);
+        }
+    }
+    line = PyUnicode_New(len, maxchar);
+    if (!line) {
+        goto out;
+    }
+    for (i = 0; i < table->columns_num; i++) {
+        Py_ssize_t cell_len = PyUnicode_GET_LENGTH(cells[i]);
+        Py_ssize_t pad = table->columns[i].width - cell_len;
+
+        if (pad < 0) {
+            pad = 0;
+        }
+        if (table->columns[i].right && pad) {
+            PyUnicode_Fill(line, pos, pad, ' ');
+            pos += pad;
+            pad = 0;
+        }
+        PyUnicode_CopyCharacters(line, pos, cells[i], 0, cell_len);
+        pos += cell_len;
+        if (pad) {
+            PyUnicode_Fill(line, pos, pad, ' ');
+            pos += pad;
+        }
+    }
+
+out:
+    for (i = 0; i < table->columns_num; i++) {
+        Py_DECREF(cells[i]);
+    }
+    return line;
+}
+
+static PyObject *table_row(const TableObject *table, PyObject *row) {
+    PyObject **cells;
+    PyObject *line;
+    Py_ssize_t i;
+
+    cells = PyMem_Calloc(table->columns_num + 1, sizeof(*cells));
+    if (!cells) {
+        return PyErr_NoMemory();
+    }
+    for (i = 0; i < table->columns_num; i++) {
+        cells[i] = table_cell(&table->columns[i], row);
+        if (!cells[i]) {
+            while (i--) {
+                Py_DECREF(cells[i]);
+            }
+            PyMem_Free(cells);
+            return NULL;
+        }
+    }
+    line = table_line(table, cells);
+    PyMem_Free(cells);
+
+    return line;
+}
+
+static PyObject *table_header(const TableObject *table) {
+    PyObject **cells;
+    PyObject *line;
+    Py_ssize_t i;
+
+    cells = PyMem_Calloc(table->columns_num + 1, sizeof(*cells));
+    if (!cells) {
+        return PyErr_NoMemory();
+    }
+    for (i = 0; i < table->columns_num; i++) {
+        cells[i] = table->columns[i].header;
+        Py_INCREF(cells[i]);
+    }
+    line = table_line(table, cells);
+    PyMem_Free(cells);
+
+    return line;
+}
+
+/* Returns 1 if the row passes the filter, 0 if not and -1 on error */
+static int table_filter(const TableObject *table, PyObject *row) {
+    PyObject *value, *text;
+    int result;
+
+    if (!table->filter_path) {
+        return 1;
+    }
+    value = table_lookup(row, table->filter_path);
+    if (!value) {
+        return PyErr_Occurred() ? -1 : 0;
+    }
+    text = PyObject_Str(value);
+    if (!text) {
+        return -1;
+    }
+    result = PyUnicode_Contains(text, table->filter_contains);
+    Py_DECREF(text);
+
+    return result;
+}
+
+/*--------------------------------------------------------- */
+/* Collects the objects at the rows path. The "*" goes through
+ * every value of the dict. */
+static int table_sources(PyObject *obj, PyObject *path, Py_ssize_t depth,
+                         PyObject *sources) {
+    PyObject *key;
+
+    if (depth == PyTuple_GET_SIZE(path)) {
+        return PyList_Append(sources, obj);
+    }
+    if (!PyDict_Check(obj)) {
+        return 0;
+    }
+    key = PyTuple_GET_ITEM(path, depth);
+    if (!PyUnicode_CompareWithASCIIString(key, "*")) {
+        PyObject *values = PyDict_Values(obj);
+        Py_ssize_t i;
+
+        if (!values) {
+            return -1;
+        }
+        for (i = 0; i < PyList_GET_SIZE(values); i++) {
+            if (table_sources(PyList_GET_ITEM(values, i), path, depth + 1,
+                              sources) < 0) {
+                Py_DECREF(values);
+                return -1;
+            }
+        }
+        Py_DECREF(values);
+        return 0;
+    }
+    obj = PyDict_GetItemWithError(obj, key);
+    if (!obj) {
+        return PyErr_Occurred() ? -1 : 0;
+    }
+
+    return table_sources(obj, path, depth + 1, sources);
+}
+
+static PyObject *table_render(PyObject *self, PyObject *data) {
+    TableObject *table = (TableObject *)self;
+    RenderObject *render;
+    int empty;
+
+    render = PyObject_New(RenderObject, &RenderType);
+    if (!render) {
+        return NULL;
+    }
+    Py_INCREF(table);
+    render->table = table;
+    render->source = 0;
+    render->rows = NULL;
+    render->heading = 0;
+    render->sources = PyList_New(0);
+    if (!render->sources) {
+        Py_DECREF(render);
+        return NULL;
+    }
+    /* Nothing is printed for the empty reply, like the templates do */
+    empty = PyObject_Not(data);
+    if (empty < 0) {
+        Py_DECREF(render);
+        return NULL;
+    }
+    if (empty) {
+        render->heading = 3;
+        return (PyObject *)render;
+    }
+    if (table_sources(data, table->rows, 0, render->sources) < 0) {
+        Py_DECREF(render);
+        return NULL;
+    }
+
+    return (PyObject *)render;
+}
+
+static void render_dealloc(PyObject *self) {
+    RenderObject *render = (RenderObject *)self;
+
+    Py_XDECREF(render->rows);
+    Py_XDECREF(render->sources);
+    Py_XDECREF(render->table);
+    Py_TYPE(self)->tp_free(self);
+}
+
+/* Returns the new reference to the next row or NULL at the end */
+static PyObject *render_next_row(RenderObject *render) {
+    PyObject *row;
+
+    for (;;) {
+        if (render->rows) {
+            row = PyIter_Next(render->rows);
+            if (row || PyErr_Occurred()) {
+                return row;
+            }
+            Py_CLEAR(render->rows);
+        }
+        if (render->source >= PyList_GET_SIZE(render->sources)) {
+            return NULL;
+        }
+        row = PyList_GET_ITEM(render->sources, render->source++);
+        /* The single object is the only row */
+        if (PyDict_Check(row)) {
+            Py_INCREF(row);
+            return row;
+        }
+        render->rows = PyObject_GetIter(row);
+        if (!render->rows) {
+            return NULL;
+        }
+    }
+}
+
+static PyObject *render_next(PyObject *self) {
+    RenderObject *render = (RenderObject *)self;
+    TableObject *table = render->table;
+    PyObject *row, *line;
+
+    /* The header is the rule, the titles and the rule again */
+    while (render->heading < 3) {
+        int part = render->heading++;
+
+        if (1 == part) {
+            return table_header(table);
+        }
+        if (table->rule) {
+            Py_INCREF(table->rule);
+            return table->rule;
+        }
+    }
+
+    while ((row = render_next_row(render))) {
+        int pass = table_filter(table, row);
+
+        if (pass < 0) {
+            Py_DECREF(row);
+            return NULL;
+        }
+        if (!pass) {
+            Py_DECREF(row);
+            continue;
+        }
+        line = table_row(table, row);
+        Py_DECREF(row);
+        return line;
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------- */
+static PyMethodDef table_methods[] = {
+    {"render", table_render, METH_O,
+     "render(data) -> iterator over the lines of the table"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject TableType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "clish_table.Table",
+    .tp_basicsize = sizeof(TableObject),
+    .tp_dealloc = table_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Compiled table spec",
+    .tp_methods = table_methods,
+};
+
+static PyTypeObject RenderType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "clish_table.Render",
+    .tp_basicsize = sizeof(RenderObject),
+    .tp_dealloc = render_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Lines of the rendered table",
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = render_next,
+};
+
+static PyMethodDef py_table_methods[] = {
+    {"compile", py_table_compile, METH_O,
+     "compile(spec) -> Table"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef py_table_module = {
+    PyModuleDef_HEAD_INIT,
+    "clish_table",
+    "Plain tables rendered by the column spec instead of the template",
+    -1,
+    py_table_methods,
+};
+
+PyMODINIT_FUNC PyInit_clish_table(void) {
+    if (PyType_Ready(&TableType) < 0 || PyType_Ready(&RenderType) < 0) {
+        return NULL;
+    }
+    return PyModule_Create(&py_table_module);
+}
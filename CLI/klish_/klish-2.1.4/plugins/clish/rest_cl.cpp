@@ -23,6 +23,7 @@ extern "C" {
 #include "lub/dump.h"
 #include "nos_extn.h"
 #include "logging.h"
+#include "clish/plugin/mgmt_clish_utils.h"
 
 #include <stdio.h>
 #include <fcntl.h>
@@ -30,14 +31,22 @@ extern "C" {
 #include <curl/curl.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <pwd.h>
 #include <cJSON.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <time.h>
+#include <math.h>
 }
 
 #include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
 
 std::string REST_API_ROOT;
 
@@ -81,57 +90,58 @@ static size_t write_callback(void *data, size_t size,
 
 }
 
-int print_error(const char *str) {
+/* The message of the first error in the ietf-restconf errors */
+static bool rest_error_message(const char *str, std::string &msg) {
 
     cJSON *ret_json = cJSON_Parse(str);
     if (!ret_json) {
         syslog(LOG_DEBUG, "clish_restcl: Failed parsing error string\r\n");
-        return 0;
+        return false;
     }
 
     cJSON *ietf_err = cJSON_GetObjectItemCaseSensitive(ret_json, "ietf-restconf:errors");
-    if (!ietf_err) {
-        syslog(LOG_DEBUG, "clish_restcl: No errors\r\n");
-        return 0;
-    }
+    cJSON *errors = ietf_err ? cJSON_GetObjectItemCaseSensitive(ietf_err, "error") : NULL;
+    cJSON *error;
+    bool found = false;
 
-    cJSON *errors = cJSON_GetObjectItemCaseSensitive(ietf_err, "error");
     if (!errors) {
-        syslog(LOG_DEBUG, "clish_restcl: No error\r\n");
-        return 0;
+        syslog(LOG_DEBUG, "clish_restcl: No errors\r\n");
     }
-
-    cJSON *error;
     cJSON_ArrayForEach(error, errors) {
         cJSON *err_msg = cJSON_GetObjectItemCaseSensitive(error, "error-message");
-        if (err_msg) {
-            lub_dump_printf("%% Error: %s\r\n", err_msg->valuestring);
-        /* Since error-message is an optional attribute, we need to check for "error-tag"
-           and print the error-message accordingly */
+        cJSON *err_tag = cJSON_GetObjectItemCaseSensitive(error, "error-tag");
+
+        /* Since error-message is an optional attribute, the message
+           is chosen by the "error-tag" otherwise */
+        if (err_msg && err_msg->valuestring) {
+            msg = err_msg->valuestring;
+        } else if (!err_tag || !err_tag->valuestring) {
+            msg = "operation failed";
+        } else if (!strcmp(err_tag->valuestring, "invalid-value")) {
+            msg = "validation failed";
+        } else if (!strcmp(err_tag->valuestring, "operation-not-supported")) {
+            msg = "not supported";
+        } else if (!strcmp(err_tag->valuestring, "access-denied")) {
+            msg = "not authorized";
         } else {
-            std::string err_msg = "operation failed";
-
-            cJSON* err_tag = cJSON_GetObjectItemCaseSensitive(error, "error-tag");
-            if(err_tag == NULL) {
-                lub_dump_printf("%% Error: %s\r\n", err_msg.c_str());
-                return 1;
-            }
-            std::string err_tag_str = std::string {err_tag->valuestring};
-
-            if(err_tag_str == "invalid-value") {
-                err_msg = "validation failed";
-            } else if (err_tag_str == "operation-not-supported") {
-                err_msg = "not supported";
-            } else if (err_tag_str == "access-denied") {
-                err_msg = "not authorized";
-            } else {
-                err_msg = "operation failed";
-            }
-            lub_dump_printf("%% Error: %s\r\n", err_msg.c_str());
+            msg = "operation failed";
         }
-        return 1;
+        found = true;
+        break;
     }
-    return 0;
+    cJSON_Delete(ret_json);
+
+    return found;
+}
+
+int print_error(const char *str) {
+    std::string err_msg;
+
+    if (!rest_error_message(str, err_msg)) {
+        return 0;
+    }
+    lub_dump_printf("%% Error: %s\r\n", err_msg.c_str());
+    return 1;
 }
 
 
@@ -139,6 +149,23 @@ std::string rest_token;
 
 CURL *curl =  NULL;
 
+/* The token is fetched by the refresh thread with its own curl
+ * handle, so the network round trip doesn't hold the command lock.
+ * The new token is swapped into token_pending and the command thread
+ * applies it to rest_token, the curl headers and the environment
+ * before the next command. */
+static CURL *token_curl = NULL;
+static std::string token_pending;
+static unsigned int token_gen = 0;
+static unsigned int token_applied = 0;
+static bool token_started = false;
+static bool token_done = false;
+static pthread_mutex_t token_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t token_cond = PTHREAD_COND_INITIALIZER;
+
+/* Headers of the command handle */
+static struct curl_slist *rest_headers = NULL;
+
 static int rest_set_curl_headers(bool use_token) {
     struct curl_slist* headerList = NULL;
     headerList = curl_slist_append(headerList, "accept: application/yang-data+json");
@@ -151,17 +178,84 @@ static int rest_set_curl_headers(bool use_token) {
     }
 
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+    curl_slist_free_all(rest_headers);
+    rest_headers = headerList;
 
     return 0;
 }
 
-static int _init_curl() {
+/* The compression is asked for all the encodings of libcurl, like
+ * gzip and zstd. It pays off over the network only, so it's on for
+ * a remote REST_API_ROOT unless CLISH_REST_COMPRESS says otherwise. */
+static bool rest_compress = false;
 
-    curl_global_init(CURL_GLOBAL_ALL);
+/* The JSON request bodies are sent as application/yang-data+cbor
+ * (RFC 9254) if CLISH_REST_CBOR is set. The server which rejects them
+ * with 415 turns it off, the request is sent again as JSON. */
+static bool rest_cbor = false;
+#define REST_CBOR_CONTENT_TYPE "Content-Type: application/yang-data+cbor"
+
+/* Ctrl-C aborts the transfers of the command. The SIGINT handler of
+ * the action sets the flag checked by curl at least once a second. */
+const char rest_error_interrupted[] = "Interrupted";
+
+static int rest_progress_callback(void *, curl_off_t, curl_off_t,
+                                  curl_off_t, curl_off_t) {
+    return is_ctrlc_pressed() ? 1 : 0;
+}
+
+/* The deferred writes of the pasted config and the background
+ * requests are not aborted */
+static void rest_set_cancel(CURL *handle, bool cancel) {
+    curl_easy_setopt(handle, CURLOPT_XFERINFOFUNCTION,
+                     cancel ? rest_progress_callback : NULL);
+    curl_easy_setopt(handle, CURLOPT_NOPROGRESS, cancel ? 0L : 1L);
+}
+
+static const char *rest_strerror(CURLcode res) {
+    if (res == CURLE_ABORTED_BY_CALLBACK) {
+        return rest_error_interrupted;
+    }
+    return curl_easy_strerror(res);
+}
+
+/* The handles of a remote REST_API_ROOT share the TLS sessions and
+ * the DNS cache, so the token thread, the concurrent requests and the
+ * streams resume the session of the first handshake. The connections
+ * stay per handle, libcurl doesn't support sharing them between the
+ * threads. */
+static CURLSH *rest_share = NULL;
+static pthread_mutex_t share_mutex[CURL_LOCK_DATA_LAST];
+
+static void rest_share_lock(CURL *, curl_lock_data data, curl_lock_access, void *) {
+    pthread_mutex_lock(&share_mutex[data]);
+}
+
+static void rest_share_unlock(CURL *, curl_lock_data data, void *) {
+    pthread_mutex_unlock(&share_mutex[data]);
+}
+
+static void rest_share_init() {
+    int i;
 
-    curl = curl_easy_init();
+    rest_share = curl_share_init();
+    if (!rest_share) {
+        return;
+    }
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&share_mutex[i], NULL);
+    }
+    curl_share_setopt(rest_share, CURLSHOPT_LOCKFUNC, rest_share_lock);
+    curl_share_setopt(rest_share, CURLSHOPT_UNLOCKFUNC, rest_share_unlock);
+    curl_share_setopt(rest_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(rest_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+}
+
+static CURL *_new_curl() {
+
+    CURL *curl = curl_easy_init();
     if (!curl) {
-        return 1;
+        return NULL;
     }
     
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "CLI");
@@ -169,40 +263,162 @@ static int _init_curl() {
     curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
 
+    /* The replies are decoded before the write callbacks */
+    if (rest_compress) {
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    }
+
     if (REST_API_ROOT.find("https://") == 0) {
         curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
         curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        if (rest_share) {
+            curl_easy_setopt(curl, CURLOPT_SHARE, rest_share);
+        }
     } else {
         curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, "/var/run/rest-local.sock");
     }
 
+    return curl;
+}
+
+static int _init_curl() {
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    if (REST_API_ROOT.find("https://") == 0) {
+        rest_share_init();
+    }
+    curl = _new_curl();
+    if (!curl) {
+        return 1;
+    }
+    rest_set_cancel(curl, true);
+
     return 0;
 }
 
+static void rest_breaker_init();
+static void rest_cache_init();
+static void rest_async_init();
+static long rest_token_timeout();
+static void rest_set_token_timeout(CURL *handle);
+static bool rest_breaker_tripped();
+static void rest_breaker_result(CURLcode res);
+
 void rest_client_init() {
     char *root = getenv("REST_API_ROOT");
 
     REST_API_ROOT.assign(root ? root : "http://localhost");
+    char *compress = getenv("CLISH_REST_COMPRESS");
+    if (compress && *compress) {
+        rest_compress = strcmp(compress, "0");
+    } else {
+        rest_compress = REST_API_ROOT.find("https://") == 0;
+    }
+    char *cbor = getenv("CLISH_REST_CBOR");
+    rest_cbor = cbor && *cbor && strcmp(cbor, "0");
 
     _init_curl();
 
     rest_set_curl_headers(true);
+
+    rest_breaker_init();
+    rest_cache_init();
+    rest_async_init();
+}
+
+/* Called before the refresh thread is started. The commands wait
+ * for the first fetch since then. */
+void rest_token_start() {
+    pthread_mutex_lock(&token_mutex);
+    token_started = true;
+    token_done = false;
+    pthread_mutex_unlock(&token_mutex);
+}
+
+static void rest_token_publish(std::string &token) {
+    pthread_mutex_lock(&token_mutex);
+    if (token.size()) {
+        token_pending.swap(token);
+        token_gen++;
+    }
+    token_done = true;
+    pthread_cond_broadcast(&token_cond);
+    pthread_mutex_unlock(&token_mutex);
+}
+
+/* Apply the last fetched token. Must be called with the command
+ * lock held and Ctrl-C enabled. Waits for the first fetch if it's
+ * still in progress, the command goes on without the token once the
+ * fetch times out, on Ctrl-C or while the breaker is open. */
+void rest_token_sync() {
+    std::string token;
+    struct timespec deadline, now, wake;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += rest_token_timeout() / 1000 + 1;
+
+    pthread_mutex_lock(&token_mutex);
+    while (token_started && !token_done) {
+        clock_gettime(CLOCK_REALTIME, &now);
+        if (now.tv_sec >= deadline.tv_sec || is_ctrlc_pressed() || rest_breaker_tripped()) {
+            syslog(LOG_WARNING, "No REST token yet, sending the request without it");
+            break;
+        }
+        /* Ctrl-C is checked every 100ms */
+        wake = now;
+        wake.tv_nsec += 100000000;
+        if (wake.tv_nsec >= 1000000000) {
+            wake.tv_sec++;
+            wake.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&token_cond, &token_mutex, &wake);
+    }
+    if (token_applied != token_gen) {
+        token = token_pending;
+        token_applied = token_gen;
+    }
+    pthread_mutex_unlock(&token_mutex);
+
+    if (!token.size()) {
+        return;
+    }
+
+    rest_token.swap(token);
+
+    setenv("REST_API_TOKEN", rest_token.c_str(), 1);
+
+    pyobj_set_rest_token(rest_token.c_str());
+
+    rest_set_curl_headers(true);
 }
 
+/* Fetch the new token. It's called by the refresh thread only and
+ * doesn't touch the handle used by the commands. */
 int rest_token_fetch(int *interval) {
 
     CURLcode res;
     std::string url;
+    std::string new_token;
+
+    if (!token_curl) {
+        token_curl = _new_curl();
+    }
+    CURL *curl = token_curl;
 
     if (!curl) {
         syslog(LOG_WARNING, "curl handle is not yet initialized.");
+        rest_token_publish(new_token);
         return 1;
     }
     
     url  = REST_API_ROOT;
     url.append("/authenticate");
 
-    rest_set_curl_headers(false);
+    struct curl_slist* headerList = NULL;
+    headerList = curl_slist_append(headerList, "accept: application/yang-data+json");
+    headerList = curl_slist_append(headerList, "Content-Type: application/yang-data+json");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
    
     RestResponse ret = {};
     ret.size = 0;
@@ -214,8 +430,10 @@ int rest_token_fetch(int *interval) {
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
         
         curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
+        rest_set_token_timeout(curl);
 
         res = curl_easy_perform(curl);
+        rest_breaker_result(res);
         /* Check for errors */
         if(res != CURLE_OK) {
             syslog(LOG_WARNING, "curl_easy_perform() for rest_token_fetch failed: %s\n",
@@ -225,14 +443,8 @@ int rest_token_fetch(int *interval) {
                 cJSON *ret_json = cJSON_Parse(ret.body.c_str());
                 if (ret_json) {
                     cJSON *token = cJSON_GetObjectItemCaseSensitive(ret_json, "access_token");
-                    if (token) {
-                        rest_token.assign(token->valuestring);
-
-                        setenv("REST_API_TOKEN", rest_token.c_str(), 1);
-
-                        pyobj_set_rest_token(rest_token.c_str());
-
-                        rest_set_curl_headers(true);
+                    if (token && token->valuestring) {
+                        new_token.assign(token->valuestring);
 
                         cJSON  *expiry = cJSON_GetObjectItemCaseSensitive(ret_json, "expires_in");
                         if (expiry) {
@@ -249,99 +461,2023 @@ int rest_token_fetch(int *interval) {
             }
         }
     }
+    curl_slist_free_all(headerList);
+
+    rest_token_publish(new_token);
+
     return 0;
 }
 
-std::string& rtrim(std::string& str, const std::string& chars = "\t\n\v\f\r ")
-{
-    str.erase(str.find_last_not_of(chars) + 1);
-    return str;
+/* The reply body buffer. It's passed to the caller as is. The
+ * validators of the reply are kept for the response cache. */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t size;
+    char etag[128];
+    char modified[64];
+} RestBuffer;
+
+static bool buffer_reserve(RestBuffer *buf, size_t size) {
+    if (size <= buf->size) {
+        return true;
+    }
+    char *data = reinterpret_cast<char *>(realloc(buf->data, size));
+    if (!data) {
+        return false;
+    }
+    buf->data = data;
+    buf->size = size;
+    return true;
 }
 
-int _parse_args (std::string &input, std::string &oper_s, std::string &url_s, std::string &body_s){
+static size_t buffer_write_callback(void *data, size_t size,
+                                    size_t nmemb, void *userdata) {
+    RestBuffer *buf = reinterpret_cast<RestBuffer *>(userdata);
+    size_t realsize = size * nmemb;
 
-    size_t oper_pos = input.find("oper=");
-    if (oper_pos != std::string::npos) {
-        oper_pos += strlen("oper=");
+    if (buf->len + realsize > buf->size &&
+        !buffer_reserve(buf, (buf->len + realsize) * 2)) {
+        return 0;
     }
+    memcpy(buf->data + buf->len, data, realsize);
+    buf->len += realsize;
 
-    size_t url_pos = input.find("url=");
-    if (url_pos == std::string::npos) {
-        syslog(LOG_ERR, "url= missing in %s\r\n", input.c_str());
-        return 1;
+    return realsize;
+}
+
+/* Copy the value of the header if it's the named one */
+static void header_value(const char *hdr, size_t len, const char *name,
+                         char *value, size_t size) {
+    size_t name_len = strlen(name);
+
+    if (len <= name_len || strncasecmp(hdr, name, name_len)) {
+        return;
+    }
+    hdr += name_len;
+    len -= name_len;
+    while (len && (*hdr == ' ' || *hdr == '\t')) {
+        hdr++;
+        len--;
+    }
+    while (len && strchr(" \t\r\n", hdr[len - 1])) {
+        len--;
+    }
+    if (len < size) {
+        memcpy(value, hdr, len);
+        value[len] = '\0';
+    }
+}
+
+/* Allocate the body buffer at once if the length is known */
+static size_t buffer_header_callback(char *hdr, size_t size,
+                                     size_t nitems, void *userdata) {
+    RestBuffer *buf = reinterpret_cast<RestBuffer *>(userdata);
+    size_t realsize = size * nitems;
+    const char *name = "Content-Length:";
+
+    if (realsize > strlen(name) && !strncasecmp(hdr, name, strlen(name))) {
+        size_t len = strtoul(hdr + strlen(name), NULL, 10);
+        buffer_reserve(buf, len + 1);
+    }
+    header_value(hdr, realsize, "ETag:", buf->etag, sizeof(buf->etag));
+    header_value(hdr, realsize, "Last-Modified:", buf->modified, sizeof(buf->modified));
+
+    return realsize;
+}
+
+static void rest_cbor_head(std::string &out, unsigned char major, uint64_t arg) {
+    unsigned char head[9];
+    unsigned int size, i;
+
+    major <<= 5;
+    if (arg < 24) {
+        out += (char)(major | arg);
+        return;
+    }
+    if (arg <= UINT8_MAX) {
+        head[0] = major | 24;
+        size = 1;
+    } else if (arg <= UINT16_MAX) {
+        head[0] = major | 25;
+        size = 2;
+    } else if (arg <= UINT32_MAX) {
+        head[0] = major | 26;
+        size = 4;
     } else {
-        /* 'oper' terminates just before 'url=' */
-        oper_s = input.substr(oper_pos, url_pos - oper_pos);
-        rtrim(oper_s);
-    
-        url_pos += strlen("url=");
+        head[0] = major | 27;
+        size = 8;
     }
+    for (i = 0; i < size; i++) {
+        head[size - i] = arg >> (8 * i);
+    }
+    out.append((const char *)head, size + 1);
+}
 
-    url_s = REST_API_ROOT;
-    
-    size_t body_pos = input.find("body=");
+/* Encode the JSON item, the numbers without fraction as integers */
+static void rest_cbor_item(std::string &out, const cJSON *item) {
+    const cJSON *child;
 
-    /* If "body=" doesnt exist, 'url' extends till end of string */
-    if (body_pos == std::string::npos) {
-        url_s += input.substr(url_pos);
+    if (cJSON_IsObject(item) || cJSON_IsArray(item)) {
+        uint64_t num = 0;
+
+        cJSON_ArrayForEach(child, item) {
+            num++;
+        }
+        rest_cbor_head(out, cJSON_IsObject(item) ? 5 : 4, num);
+        cJSON_ArrayForEach(child, item) {
+            if (cJSON_IsObject(item)) {
+                rest_cbor_head(out, 3, strlen(child->string));
+                out += child->string;
+            }
+            rest_cbor_item(out, child);
+        }
+    } else if (cJSON_IsString(item)) {
+        rest_cbor_head(out, 3, strlen(item->valuestring));
+        out += item->valuestring;
+    } else if (cJSON_IsNumber(item)) {
+        double value = item->valuedouble;
+
+        if (fabs(value) < 9007199254740992.0 && value == (double)(int64_t)value) {
+            if (value < 0) {
+                rest_cbor_head(out, 1, (uint64_t)(-1 - (int64_t)value));
+            } else {
+                rest_cbor_head(out, 0, (uint64_t)value);
+            }
+        } else {
+            uint64_t bits;
+
+            memcpy(&bits, &value, sizeof(bits));
+            out += (char)0xfb;
+            for (int i = 7; i >= 0; i--) {
+                out += (char)(bits >> (8 * i));
+            }
+        }
+    } else if (cJSON_IsBool(item)) {
+        out += (char)(cJSON_IsTrue(item) ? 0xf5 : 0xf4);
     } else {
-        /* 'url' terminates just before 'body=' */
-        url_s += input.substr(url_pos, body_pos - url_pos);
+        out += (char)0xf6;
+    }
+}
 
-        body_pos += strlen("body=");
-        body_s = input.substr(body_pos);
+/* The CBOR of the JSON body. Returns false if the body is sent as is,
+ * it's not JSON or CBOR is off. */
+static bool rest_cbor_body(const char **headers, const char *body, size_t len,
+                           std::string &cbor) {
+    bool json = false;
+    const char **hdr;
 
-        rtrim(body_s);
+    if (!rest_cbor || !body) {
+        return false;
+    }
+    for (hdr = headers; hdr && *hdr; hdr++) {
+        if (!strncasecmp(*hdr, "Content-Type:", strlen("Content-Type:"))) {
+            json = (strstr(*hdr, "json") != NULL);
+        }
+    }
+    if (!json) {
+        return false;
     }
 
-    rtrim(url_s);
-    
-    return 0;
+    std::string text(body, len);
+    cJSON *root = cJSON_Parse(text.c_str());
+    if (!root) {
+        return false;
+    }
+    cbor.clear();
+    rest_cbor_item(cbor, root);
+    cJSON_Delete(root);
+
+    return true;
 }
 
-int rest_cl(char *cmd, const char *buff)
-{
-    CURLcode res;
+/* Whether the server rejected the CBOR body. The requests are sent
+ * as JSON from then on. */
+static bool rest_cbor_rejected(bool cbor, long status) {
+    if (!cbor || status != 415) {
+        return false;
+    }
+    if (rest_cbor) {
+        syslog(LOG_WARNING, "REST server does not accept CBOR, using JSON");
+        rest_cbor = false;
+    }
+    return true;
+}
 
-    int ret_code = 1;
-    std::string url, body, oper;
-    std::string arg = buff;
+/* The "Name: value" headers of the request and the token unless the
+ * caller authorizes itself. The Content-Type is replaced by the CBOR
+ * one if cbor is set. */
+static struct curl_slist *rest_request_headers(const char **headers, bool cbor) {
+    struct curl_slist* headerList = NULL;
+    bool auth = false;
+    const char **hdr;
+
+    for (hdr = headers; hdr && *hdr; hdr++) {
+        if (!strncasecmp(*hdr, "Authorization:", strlen("Authorization:"))) {
+            auth = true;
+        } else if (cbor && !strncasecmp(*hdr, "Content-Type:", strlen("Content-Type:"))) {
+            headerList = curl_slist_append(headerList, REST_CBOR_CONTENT_TYPE);
+            continue;
+        }
+        headerList = curl_slist_append(headerList, *hdr);
+    }
+    if (rest_token.size() && !auth) {
+        std::string auth_hdr = "Authorization: Bearer ";
+        auth_hdr += rest_token;
+        headerList = curl_slist_append(headerList, auth_hdr.c_str());
+    }
 
-    setenv("USER_COMMAND", cmd, 1);
-    syslog(LOG_DEBUG, "clish_restcl: cmd=%s", cmd);
+    return headerList;
+}
 
-    _parse_args(arg, oper, url, body);
-    syslog(LOG_DEBUG, "clish_restcl: [oper:%s][path:%s][body:%s]", oper.c_str(), url.c_str(), body.c_str());
+/* The TLS sessions of the remote REST_API_ROOT are saved in
+ * CLISH_REST_TLS_CACHE (default ~/.clish_tls_sessions, "0" turns it
+ * off), so the new clish processes resume them as well. It needs the
+ * SSL session export of libcurl 8.12 or later. The actioner scripts
+ * started by the actions use requests and don't share them. */
+#define REST_SESSION_MAGIC "CLISH-TLS-1\n"
+#define REST_SESSION_MAX (64 * 1024)
+
+static std::string session_file;
+static bool session_dirty = false;
+
+/* The timings of the finished transfer are added to the statistics
+ * of the command. The connect time is zero on a reused connection. */
+static void rest_timing(CURL *handle) {
+    curl_off_t lookup = 0, connect = 0, appconnect = 0;
+    curl_off_t pretransfer = 0, starttransfer = 0, total = 0;
+
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &lookup);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+    curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+
+    /* The new TLS session is saved after the command */
+    if (appconnect > 0) {
+        session_dirty = true;
+    }
 
-    RestResponse ret = {};
-    ret.size = 0;
+    /* The times are from the start of the transfer, the name lookup
+     * is included in the connect time */
+    if (appconnect > connect) {
+        connect = appconnect;
+    }
+    if (lookup > connect) {
+        connect = lookup;
+    }
+    cli_stats_request(connect, starttransfer > pretransfer ? starttransfer - pretransfer : 0,
+                      total);
+}
 
-    if(curl) {
+/* The timeouts of the requests depend on their class. The lookups
+ * of the completion must not hang the terminal, the RPCs like the
+ * techsupport may run for minutes. They're set in seconds by
+ * CLISH_REST_TIMEOUT_COMPLETION, CLISH_REST_TIMEOUT and
+ * CLISH_REST_TIMEOUT_RPC. */
+#define REST_CONNECT_TIMEOUT_MS 2000
+#define REST_PROBE_INTERVAL 1
+#define REST_PROBE_PATH "/restconf/yang-library-version"
+
+static long breaker_timeouts[REST_CLASS_MAX];
+static rest_class_e breaker_class = REST_CLASS_COMMAND;
+
+/* The circuit breaker. After CLISH_REST_BREAKER (default 3, 0 turns
+ * it off) consecutive connect failures or timeouts the requests fail
+ * at once. A thread probes the server with a cheap GET and the first
+ * reply closes the breaker. */
+static unsigned int breaker_limit = 0;
+static unsigned int breaker_failures = 0;
+static bool breaker_open = false;
+static pthread_mutex_t breaker_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The scripts of the actions send their requests themselves. The file
+ * of CLISH_REST_BREAKER_FD has the error while the breaker is open, it
+ * is private to the process like the breaker. */
+static int breaker_fd = -1;
+static pid_t breaker_fd_pid = 0;
+
+const char rest_error_unavailable[] = "Management REST Server is not responding";
+
+static long rest_env_long(const char *name, long def) {
+    const char *val = getenv(name);
+
+    return (val && *val) ? strtol(val, NULL, 10) : def;
+}
 
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, oper.c_str());
+static void rest_breaker_init() {
+    breaker_limit = rest_env_long("CLISH_REST_BREAKER", 3);
+    breaker_timeouts[REST_CLASS_COMPLETION] =
+        rest_env_long("CLISH_REST_TIMEOUT_COMPLETION", 3) * 1000;
+    breaker_timeouts[REST_CLASS_COMMAND] = rest_env_long("CLISH_REST_TIMEOUT", 120) * 1000;
+    breaker_timeouts[REST_CLASS_RPC] = rest_env_long("CLISH_REST_TIMEOUT_RPC", 900) * 1000;
+}
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+/* The class of the following requests, the RPCs are found by the path */
+void rest_request_class(rest_class_e cls) {
+    breaker_class = cls;
+}
 
-        PayloadData up_obj = {};
-        if (body.size()) {
+static long rest_timeout(const char *path) {
+    if (breaker_class == REST_CLASS_COMMAND &&
+        !strncmp(path, "/restconf/operations/", strlen("/restconf/operations/"))) {
+        return breaker_timeouts[REST_CLASS_RPC];
+    }
+    return breaker_timeouts[breaker_class];
+}
 
-            up_obj.data = body.c_str();
-            up_obj.length = body.size(); 
-            curl_easy_setopt(curl, CURLOPT_READDATA, &up_obj);
+static void rest_set_timeout(CURL *handle, const char *path) {
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, (long)REST_CONNECT_TIMEOUT_MS);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, rest_timeout(path));
+}
 
-            curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE,
-                    (curl_off_t)up_obj.length);
+/* The first command waits for the token, so its fetch times out like
+ * the commands */
+static long rest_token_timeout() {
+    return breaker_timeouts[REST_CLASS_COMMAND];
+}
 
-            curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+static void rest_set_token_timeout(CURL *handle) {
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, (long)REST_CONNECT_TIMEOUT_MS);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, rest_token_timeout());
+}
+
+/* Writes the state to the file of the scripts, with breaker_mutex held */
+static void rest_breaker_publish() {
+    ssize_t res;
+
+    if (breaker_fd < 0 || breaker_fd_pid != getpid()) {
+        return;
+    }
+    if (breaker_open) {
+        res = pwrite(breaker_fd, rest_error_unavailable, strlen(rest_error_unavailable), 0);
+    } else {
+        res = ftruncate(breaker_fd, 0);
+    }
+    if (res < 0) {
+        syslog(LOG_WARNING, "Failed to write the REST breaker state: %s", strerror(errno));
+    }
+}
+
+/* Passes the state of the breaker to the script an action starts */
+void rest_breaker_export() {
+    char path[] = "/tmp/clish.breaker.XXXXXX";
+    char fd_str[16];
+
+    pthread_mutex_lock(&breaker_mutex);
+    if (breaker_fd < 0 || breaker_fd_pid != getpid()) {
+        /* The session forked by the session server has its own */
+        if (breaker_fd >= 0) {
+            close(breaker_fd);
+        }
+        breaker_fd = mkstemp(path);
+        if (breaker_fd >= 0) {
+            unlink(path);
+            breaker_fd_pid = getpid();
+            snprintf(fd_str, sizeof(fd_str), "%d", breaker_fd);
+            setenv("CLISH_REST_BREAKER_FD", fd_str, 1);
         } else {
-            curl_easy_setopt(curl, CURLOPT_UPLOAD, 0L);
+            unsetenv("CLISH_REST_BREAKER_FD");
         }
+    }
+    rest_breaker_publish();
+    pthread_mutex_unlock(&breaker_mutex);
+}
 
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
+static bool rest_breaker_tripped() {
+    bool open;
 
-        res = curl_easy_perform(curl);
-        /* Check for errors */
-        if(res != CURLE_OK) {
+    pthread_mutex_lock(&breaker_mutex);
+    open = breaker_open;
+    pthread_mutex_unlock(&breaker_mutex);
+
+    return open;
+}
+
+/* Fails the request at once while the breaker is open */
+static bool rest_breaker_check(rest_reply_t *reply) {
+    if (!rest_breaker_tripped()) {
+        return false;
+    }
+    reply->error = rest_error_unavailable;
+    return true;
+}
+
+static void *rest_breaker_probe(void *arg) {
+    std::string url = REST_API_ROOT + REST_PROBE_PATH;
+    CURL *handle = _new_curl();
+    RestBuffer buf = {};
+
+    nos_extn_block_signals();
+
+    if (handle) {
+        curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, buffer_write_callback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &buf);
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, (long)REST_CONNECT_TIMEOUT_MS);
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, (long)REST_CONNECT_TIMEOUT_MS);
+    }
+    while (1) {
+        sleep(REST_PROBE_INTERVAL);
+        /* Any reply, even without the token, shows it's serving */
+        if (handle && curl_easy_perform(handle) == CURLE_OK) {
+            break;
+        }
+        free(buf.data);
+        memset(&buf, 0, sizeof(buf));
+    }
+    free(buf.data);
+    curl_easy_cleanup(handle);
+
+    syslog(LOG_NOTICE, "REST server is responding again");
+    pthread_mutex_lock(&breaker_mutex);
+    breaker_open = false;
+    breaker_failures = 0;
+    rest_breaker_publish();
+    pthread_mutex_unlock(&breaker_mutex);
+
+    arg = arg; /* Happy compiler */
+    return NULL;
+}
+
+/* Count the failures of the server. The other errors, like of a bad
+ * request, don't tell about the server. */
+static void rest_breaker_result(CURLcode res) {
+    pthread_t thread_id;
+    unsigned int failures;
+
+    switch (res) {
+    case CURLE_OK:
+        pthread_mutex_lock(&breaker_mutex);
+        breaker_failures = 0;
+        pthread_mutex_unlock(&breaker_mutex);
+        return;
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_GOT_NOTHING:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+        break;
+    default:
+        return;
+    }
+    /* The token thread counts its failures as well */
+    pthread_mutex_lock(&breaker_mutex);
+    if (!breaker_limit || ++breaker_failures < breaker_limit || breaker_open) {
+        pthread_mutex_unlock(&breaker_mutex);
+        return;
+    }
+    failures = breaker_failures;
+    breaker_open = true;
+    rest_breaker_publish();
+    pthread_mutex_unlock(&breaker_mutex);
+
+    syslog(LOG_WARNING, "REST server failed %u times: %s, failing requests till it responds",
+            failures, curl_easy_strerror(res));
+    if (pthread_create(&thread_id, NULL, rest_breaker_probe, NULL)) {
+        syslog(LOG_WARNING, "Failed to create the REST probe thread");
+        pthread_mutex_lock(&breaker_mutex);
+        breaker_open = false;
+        rest_breaker_publish();
+        pthread_mutex_unlock(&breaker_mutex);
+        return;
+    }
+    pthread_detach(thread_id);
+}
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+static void rest_session_put(std::string &out, const unsigned char *data, size_t len) {
+    uint32_t n = len;
+
+    out.append((const char *)&n, sizeof(n));
+    out.append((const char *)data, len);
+}
+
+static bool rest_session_get(const std::string &in, size_t &pos,
+                             const unsigned char **data, size_t *len) {
+    uint32_t n;
+
+    if (in.size() - pos < sizeof(n)) {
+        return false;
+    }
+    memcpy(&n, in.data() + pos, sizeof(n));
+    pos += sizeof(n);
+    if (in.size() - pos < n) {
+        return false;
+    }
+    *data = (const unsigned char *)in.data() + pos;
+    *len = n;
+    pos += n;
+    return true;
+}
+
+static CURLcode rest_session_export(CURL *, void *userptr, const char *,
+                                    const unsigned char *shmac, size_t shmac_len,
+                                    const unsigned char *sdata, size_t sdata_len,
+                                    curl_off_t, int, const char *, size_t) {
+    std::string *out = reinterpret_cast<std::string *>(userptr);
+
+    if (out->size() + shmac_len + sdata_len > REST_SESSION_MAX) {
+        return CURLE_OK;
+    }
+    rest_session_put(*out, shmac, shmac_len);
+    rest_session_put(*out, sdata, sdata_len);
+    return CURLE_OK;
+}
+#endif
+
+/* Import the saved TLS sessions. It's called before the first request
+ * of the user's session. */
+void rest_session_start() {
+    const char *path = getenv("CLISH_REST_TLS_CACHE");
+    const char *home = getenv("HOME");
+
+    if (!rest_share || !curl || (path && !strcmp(path, "0"))) {
+        return;
+    }
+    if (path && *path) {
+        session_file = path;
+    } else if (home) {
+        session_file = std::string(home) + "/.clish_tls_sessions";
+    } else {
+        return;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    std::string in;
+    char data[4096];
+    ssize_t len;
+    int fd = open(session_file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return;
+    }
+    while ((len = read(fd, data, sizeof(data))) > 0 && in.size() < REST_SESSION_MAX) {
+        in.append(data, len);
+    }
+    close(fd);
+    if (in.compare(0, strlen(REST_SESSION_MAGIC), REST_SESSION_MAGIC)) {
+        return;
+    }
+
+    size_t pos = strlen(REST_SESSION_MAGIC);
+    const unsigned char *shmac, *sdata;
+    size_t shmac_len, sdata_len;
+    while (rest_session_get(in, pos, &shmac, &shmac_len) &&
+           rest_session_get(in, pos, &sdata, &sdata_len)) {
+        /* The expired ones are dropped by libcurl */
+        curl_easy_ssls_import(curl, NULL, shmac, shmac_len, sdata, sdata_len);
+    }
+#endif
+}
+
+/* Save the TLS sessions if a handshake was done since the last save.
+ * It's called with the command lock held after the commands. */
+void rest_session_save() {
+    if (!session_dirty || session_file.empty()) {
+        return;
+    }
+    session_dirty = false;
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    std::string out = REST_SESSION_MAGIC;
+    CURLcode res = curl_easy_ssls_export(curl, rest_session_export, &out);
+
+    if (res != CURLE_OK) {
+        /* Like libcurl built without the SSL session export */
+        syslog(LOG_DEBUG, "TLS sessions not saved: %s", curl_easy_strerror(res));
+        session_file.clear();
+        return;
+    }
+
+    /* The sessions are secrets, they're written to a private file
+     * and renamed over the old one */
+    std::string tmp = session_file + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return;
+    }
+    bool ok = write(fd, out.data(), out.size()) == (ssize_t)out.size();
+    if (close(fd) || !ok || rename(tmp.c_str(), session_file.c_str())) {
+        unlink(tmp.c_str());
+    }
+#endif
+}
+
+/* Connect the command handle to the remote REST_API_ROOT while the
+ * shell starts, the first command reuses the connection. Any reply,
+ * even without the token, leaves it open. CLISH_REST_PREWARM=0 turns
+ * it off. The caller holds the command lock. */
+void rest_prewarm() {
+    std::string url = REST_API_ROOT + REST_PROBE_PATH;
+    const char *prewarm = getenv("CLISH_REST_PREWARM");
+    RestBuffer buf = {};
+    CURLcode res;
+
+    if (!curl || REST_API_ROOT.find("https://") != 0 ||
+        (prewarm && !strcmp(prewarm, "0"))) {
+        return;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
+    curl_easy_setopt(curl, CURLOPT_UPLOAD, 0L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, buffer_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)REST_CONNECT_TIMEOUT_MS);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)REST_CONNECT_TIMEOUT_MS);
+
+    res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+        syslog(LOG_INFO, "REST connection pre-warm failed: %s", curl_easy_strerror(res));
+    } else {
+        session_dirty = true;
+    }
+    free(buf.data);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+
+    rest_session_save();
+}
+
+/* The GET replies with an ETag or Last-Modified are cached by the
+ * path and the token. The request is sent with If-None-Match or
+ * If-Modified-Since and the cached body is served on 304. The least
+ * recently used replies are evicted over CLISH_REST_CACHE KB and the
+ * ones older than CLISH_REST_CACHE_AGE seconds aren't used. The request
+ * keeps a copy of the entry it validates, sharing the body, so it's
+ * served on 304 even if the other replies evicted it meanwhile. */
+typedef struct {
+    std::string key;
+    std::string etag;
+    std::string modified;
+    std::string content_type;
+    std::shared_ptr<const std::string> body;
+    time_t stored;
+} RestCacheEntry;
+
+typedef std::list<RestCacheEntry> RestCacheList;
+typedef std::unordered_map<std::string, RestCacheList::iterator> RestCacheIndex;
+
+static RestCacheList cache_entries;
+static RestCacheIndex cache_index;
+static size_t cache_size = 0;
+static size_t cache_limit = 0;
+static time_t cache_age = 0;
+
+static void rest_cache_init() {
+    char *limit = getenv("CLISH_REST_CACHE");
+    char *age = getenv("CLISH_REST_CACHE_AGE");
+
+    cache_limit = (limit ? strtoul(limit, NULL, 10) : 2048) * 1024;
+    cache_age = age ? strtol(age, NULL, 10) : 300;
+}
+
+/* The replies differ by the path, the representation and the user.
+ * The empty key isn't cached. */
+static std::string rest_cache_key(const char *method, const char *path,
+                                  const char **headers) {
+    std::string auth = rest_token, accept;
+    const char **hdr;
+
+    if (!cache_limit || strcmp(method, "GET")) {
+        return "";
+    }
+    for (hdr = headers; hdr && *hdr; hdr++) {
+        if (!strncasecmp(*hdr, "Authorization:", strlen("Authorization:"))) {
+            auth = *hdr;
+        } else if (!strncasecmp(*hdr, "Accept:", strlen("Accept:"))) {
+            accept = *hdr;
+        }
+    }
+    return auth + "\n" + accept + "\n" + path;
+}
+
+static void rest_cache_erase(RestCacheList::iterator entry) {
+    cache_size -= entry->body->size();
+    cache_index.erase(entry->key);
+    cache_entries.erase(entry);
+}
+
+/* The validators of the cached reply. It becomes the most recently
+ * used one and its copy is kept in validated till the reply. */
+static struct curl_slist *rest_cache_validate(struct curl_slist *headerList,
+                                              const std::string &key,
+                                              RestCacheEntry *validated) {
+    validated->body.reset();
+    if (key.empty()) {
+        return headerList;
+    }
+    RestCacheIndex::iterator found = cache_index.find(key);
+    if (found == cache_index.end()) {
+        return headerList;
+    }
+    RestCacheList::iterator entry = found->second;
+    if (time(NULL) - entry->stored > cache_age) {
+        rest_cache_erase(entry);
+        return headerList;
+    }
+    cache_entries.splice(cache_entries.begin(), cache_entries, entry);
+    *validated = *entry;
+
+    if (entry->etag.size()) {
+        std::string hdr = "If-None-Match: " + entry->etag;
+        headerList = curl_slist_append(headerList, hdr.c_str());
+    }
+    if (entry->modified.size()) {
+        std::string hdr = "If-Modified-Since: " + entry->modified;
+        headerList = curl_slist_append(headerList, hdr.c_str());
+    }
+    return headerList;
+}
+
+/* Serve the validated reply on 304 or cache the new one. The 304
+ * without the validated entry is the reply to the validators of the
+ * caller, it's passed as is. */
+static void rest_cache_reply(const std::string &key, RestCacheEntry *validated,
+                             const RestBuffer *buf, rest_reply_t *reply) {
+    std::shared_ptr<const std::string> cached;
+
+    cached.swap(validated->body);
+    if (key.empty()) {
+        return;
+    }
+    RestCacheIndex::iterator found = cache_index.find(key);
+
+    if (reply->status == 304 && cached) {
+        char *body = reinterpret_cast<char *>(malloc(cached->size() + 1));
+
+        if (!body) {
+            return;
+        }
+        memcpy(body, cached->data(), cached->size());
+        body[cached->size()] = '\0';
+        free(reply->body);
+        free(reply->content_type);
+        reply->body = body;
+        reply->len = cached->size();
+        reply->content_type = validated->content_type.size() ?
+            strdup(validated->content_type.c_str()) : NULL;
+        reply->status = 200;
+        if (found != cache_index.end()) {
+            found->second->stored = time(NULL);
+        }
+        return;
+    }
+    if (found != cache_index.end()) {
+        rest_cache_erase(found->second);
+    }
+    if (reply->status != 200 || (!buf->etag[0] && !buf->modified[0]) ||
+        reply->len > cache_limit / 4) {
+        return;
+    }
+
+    RestCacheEntry entry;
+    entry.key = key;
+    entry.etag = buf->etag;
+    entry.modified = buf->modified;
+    entry.content_type = reply->content_type ? reply->content_type : "";
+    entry.body = std::make_shared<const std::string>(reply->body ? reply->body : "", reply->len);
+    entry.stored = time(NULL);
+    cache_entries.push_front(entry);
+    cache_index[key] = cache_entries.begin();
+    cache_size += reply->len;
+
+    while (cache_size > cache_limit) {
+        rest_cache_erase(--cache_entries.end());
+    }
+}
+
+static bool rest_async_defer(const char *method, const char *path,
+                             const char **headers, const char *body,
+                             size_t body_len, rest_reply_t *reply);
+static void rest_async_wait();
+
+/* Issue the request through the command handle. It's used by the
+ * clish_rest Python module, so the caller holds the command lock.
+ * The headers are "Name: value" strings, NULL terminated. The reply
+ * body and content type are allocated, the caller frees them. */
+int rest_request(const char *method, const char *path, const char **headers,
+                 const char *body, size_t body_len, rest_reply_t *reply) {
+
+    CURLcode res;
+    std::string url = REST_API_ROOT;
+    struct curl_slist* headerList = NULL;
+
+    memset(reply, 0, sizeof(*reply));
+    if (rest_breaker_check(reply)) {
+        return -1;
+    }
+
+    if (rest_async_defer(method, path, headers, body, body_len, reply)) {
+        return 0;
+    }
+    rest_async_wait();
+
+    memset(reply, 0, sizeof(*reply));
+
+    if (!curl) {
+        reply->error = "Couldn't initialize curl handle";
+        return -1;
+    }
+
+    url += path;
+    std::string cbor_body;
+    bool cbor = rest_cbor_body(headers, body, body_len, cbor_body);
+    headerList = rest_request_headers(headers, cbor);
+    std::string cache_key = rest_cache_key(method, path, headers);
+    RestCacheEntry validated;
+    headerList = rest_cache_validate(headerList, cache_key, &validated);
+
+    RestBuffer buf = {};
+    PayloadData up_obj = {};
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, strcmp(method, "HEAD") ? 0L : 1L);
+    if (body) {
+        up_obj.data = cbor ? cbor_body.data() : body;
+        up_obj.length = cbor ? cbor_body.size() : body_len;
+        curl_easy_setopt(curl, CURLOPT_READDATA, &up_obj);
+        curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)up_obj.length);
+        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_UPLOAD, 0L);
+    }
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, buffer_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, buffer_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &buf);
+    rest_set_timeout(curl, path);
+
+    res = curl_easy_perform(curl);
+    rest_timing(curl);
+    rest_breaker_result(res);
+    if (res != CURLE_OK) {
+        syslog(LOG_WARNING, "curl_easy_perform() for rest_request failed: %s\n",
+                curl_easy_strerror(res));
+        reply->error = rest_strerror(res);
+        free(buf.data);
+    } else {
+        char *ctype = NULL;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &reply->status);
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &ctype);
+        reply->content_type = ctype ? strdup(ctype) : NULL;
+        reply->body = buf.data;
+        reply->len = buf.len;
+        rest_cache_reply(cache_key, &validated, &buf, reply);
+    }
+
+    /* Restore the command handle state */
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 0L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, rest_headers);
+    curl_slist_free_all(headerList);
+
+    if (res == CURLE_OK && rest_cbor_rejected(cbor, reply->status)) {
+        free(reply->body);
+        free(reply->content_type);
+        return rest_request(method, path, headers, body, body_len, reply);
+    }
+
+    return (res == CURLE_OK) ? 0 : -1;
+}
+
+/* The requests of rest_request_many() and the deferred config
+ * requests run concurrently on up to REST_MANY_HANDLES connections.
+ * The handles and the multi are kept, so the connections stay alive
+ * in the multi's connection cache. */
+#define REST_MANY_HANDLES 8
+
+/* The copy of a deferred request and its line */
+typedef struct {
+    std::string method;
+    std::string path;
+    std::string body;
+    unsigned int seq;
+    unsigned int lineno;
+    std::string line;
+} RestAsyncEdit;
+
+typedef struct {
+    CURL *handle;
+    size_t index;
+    bool busy;
+    struct curl_slist *headers;
+    PayloadData upload;
+    /* The body sent as CBOR */
+    bool cbor;
+    std::string cbor_body;
+    RestBuffer buf;
+    std::string cache_key;
+    RestCacheEntry validated;
+    /* The deferred requests, more than one if they were coalesced,
+     * and the path without the query, headers and body sent */
+    std::vector<RestAsyncEdit> edits;
+    std::string path;
+    std::vector<std::string> hdrs;
+    std::string body;
+} RestTransfer;
+
+static CURLM *many_multi = NULL;
+static RestTransfer many_xfers[REST_MANY_HANDLES];
+static size_t many_slots = 0;
+
+/* The deferred config requests. While the pasted or sourced config
+ * is read, the writes of the consecutive lines are sent without
+ * waiting for the replies. The failures are reported with their
+ * line by rest_async_barrier(). */
+typedef struct {
+    unsigned int seq;
+    unsigned int lineno;
+    std::string line;
+    std::string error;
+} RestAsyncError;
+
+/* The consecutive PATCHes of the nodes under the same container are
+ * coalesced into one PATCH of the container. They're held till a
+ * request which can't be merged, a barrier, or the CLISH_REST_COALESCE
+ * timeout. */
+#define REST_COALESCE_MAX 64
+
+typedef struct {
+    std::vector<RestAsyncEdit> edits;
+    std::vector<std::string> hdrs;
+    std::string parent;
+    std::string module;
+    std::string name;
+    cJSON *content;
+    struct timespec since;
+} RestAsyncHold;
+
+/* The PATCH of a line parsed for coalescing. The value is the node
+ * and key its member name in the content of the parent. */
+typedef struct {
+    std::string parent;
+    std::string module;
+    std::string name;
+    std::string key;
+    cJSON *value;
+} RestAsyncMerge;
+
+static size_t async_window = 0;
+static long async_coalesce = 0;
+static RestAsyncHold async_hold;
+static bool async_active = false;
+static size_t async_busy = 0;
+static unsigned int async_seq = 0;
+static unsigned int async_lineno = 0;
+static std::string async_line;
+static std::vector<RestAsyncError> async_errors;
+
+static bool rest_many_init(size_t num) {
+    size_t i;
+
+    if (!many_multi) {
+        many_multi = curl_multi_init();
+        if (!many_multi) {
+            return false;
+        }
+        curl_multi_setopt(many_multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                          (long)REST_MANY_HANDLES);
+        curl_multi_setopt(many_multi, CURLMOPT_MAXCONNECTS,
+                          (long)REST_MANY_HANDLES);
+    }
+    for (i = many_slots; i < REST_MANY_HANDLES && i < num; i++) {
+        many_xfers[i].handle = _new_curl();
+        if (!many_xfers[i].handle) {
+            break;
+        }
+        many_slots++;
+    }
+
+    return many_slots > 0;
+}
+
+static void rest_transfer_setup(RestTransfer *xfer, const rest_req_t *req,
+                                size_t index, bool cancel) {
+    std::string url = REST_API_ROOT;
+    CURL *handle = xfer->handle;
+
+    url += req->path;
+    xfer->index = index;
+    xfer->busy = true;
+    xfer->cache_key = rest_cache_key(req->method, req->path, req->headers);
+    xfer->cbor = rest_cbor_body(req->headers, req->body, req->body_len, xfer->cbor_body);
+    xfer->headers = rest_cache_validate(rest_request_headers(req->headers, xfer->cbor),
+                                        xfer->cache_key, &xfer->validated);
+    memset(&xfer->buf, 0, sizeof(xfer->buf));
+
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, req->method);
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, xfer->headers);
+    curl_easy_setopt(handle, CURLOPT_NOBODY, strcmp(req->method, "HEAD") ? 0L : 1L);
+    if (req->body) {
+        xfer->upload.data = xfer->cbor ? xfer->cbor_body.data() : req->body;
+        xfer->upload.length = xfer->cbor ? xfer->cbor_body.size() : req->body_len;
+        curl_easy_setopt(handle, CURLOPT_READDATA, &xfer->upload);
+        curl_easy_setopt(handle, CURLOPT_INFILESIZE_LARGE, (curl_off_t)xfer->upload.length);
+        curl_easy_setopt(handle, CURLOPT_UPLOAD, 1L);
+    } else {
+        curl_easy_setopt(handle, CURLOPT_UPLOAD, 0L);
+    }
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, buffer_write_callback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &xfer->buf);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, buffer_header_callback);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, &xfer->buf);
+    curl_easy_setopt(handle, CURLOPT_PRIVATE, xfer);
+    rest_set_timeout(handle, req->path);
+    rest_set_cancel(handle, cancel);
+}
+
+static void rest_transfer_start(RestTransfer *xfer, const rest_req_t *req,
+                                size_t index, bool cancel) {
+    rest_transfer_setup(xfer, req, index, cancel);
+    curl_multi_add_handle(many_multi, xfer->handle);
+}
+
+static void rest_transfer_reply(RestTransfer *xfer, CURLcode res,
+                                rest_reply_t *reply) {
+    curl_slist_free_all(xfer->headers);
+    xfer->headers = NULL;
+    xfer->busy = false;
+    rest_timing(xfer->handle);
+    rest_breaker_result(res);
+
+    if (res != CURLE_OK) {
+        syslog(LOG_WARNING, "rest transfer failed: %s\n", curl_easy_strerror(res));
+        reply->error = rest_strerror(res);
+        free(xfer->buf.data);
+        xfer->validated.body.reset();
+        return;
+    }
+
+    char *ctype = NULL;
+    curl_easy_getinfo(xfer->handle, CURLINFO_RESPONSE_CODE, &reply->status);
+    curl_easy_getinfo(xfer->handle, CURLINFO_CONTENT_TYPE, &ctype);
+    reply->content_type = ctype ? strdup(ctype) : NULL;
+    reply->body = xfer->buf.data;
+    reply->len = xfer->buf.len;
+    rest_cache_reply(xfer->cache_key, &xfer->validated, &xfer->buf, reply);
+}
+
+static void rest_transfer_done(RestTransfer *xfer, CURLcode res,
+                               rest_reply_t *reply) {
+    curl_multi_remove_handle(many_multi, xfer->handle);
+    rest_transfer_reply(xfer, res, reply);
+}
+
+/* Record the error of the deferred request */
+static void rest_async_check(const RestAsyncEdit &edit, const rest_reply_t *reply) {
+    RestAsyncError err;
+
+    if (reply->error == rest_error_interrupted) {
+        err.error = reply->error;
+    } else if (reply->error) {
+        err.error = "Could not connect to Management REST Server";
+    } else if ((reply->status < 200 || reply->status > 299) &&
+               /* Like ApiClient.delete() the missing entry is deleted */
+               !(reply->status == 404 && edit.method == "DELETE")) {
+        std::string body(reply->body ? reply->body : "", reply->len);
+        if (!rest_error_message(body.c_str(), err.error)) {
+            err.error = "operation failed";
+        }
+    }
+    if (err.error.size()) {
+        err.seq = edit.seq;
+        err.lineno = edit.lineno;
+        err.line = edit.line;
+        async_errors.push_back(err);
+    }
+}
+
+static bool rest_async_rejected(const rest_reply_t *reply) {
+    return !reply->error && (reply->status < 200 || reply->status > 299);
+}
+
+/* The coalesced PATCH failed as a whole. Its requests are sent again
+ * one by one on the handle, so the errors are reported for their
+ * lines and the valid ones are applied as without coalescing. Ctrl-C
+ * aborts the replay, and the server which isn't reached fails the
+ * rest of the requests at once. */
+static void rest_async_replay(RestTransfer *xfer) {
+    std::vector<const char *> hdrs;
+    const char *error = NULL;
+
+    for (size_t i = 0; i < xfer->hdrs.size(); i++) {
+        hdrs.push_back(xfer->hdrs[i].c_str());
+    }
+    hdrs.push_back(NULL);
+
+    for (size_t i = 0; i < xfer->edits.size(); i++) {
+        const RestAsyncEdit &edit = xfer->edits[i];
+        rest_req_t req = {edit.method.c_str(), edit.path.c_str(), hdrs.data(),
+                          edit.body.data(), edit.body.size()};
+        rest_reply_t reply;
+
+        memset(&reply, 0, sizeof(reply));
+        if (is_ctrlc_pressed()) {
+            error = rest_error_interrupted;
+        }
+        if (error) {
+            reply.error = error;
+        } else {
+            rest_transfer_setup(xfer, &req, 0, true);
+            rest_transfer_reply(xfer, curl_easy_perform(xfer->handle), &reply);
+            error = reply.error;
+        }
+        rest_async_check(edit, &reply);
+        free(reply.body);
+        free(reply.content_type);
+    }
+}
+
+/* Record the reply of the deferred request */
+static void rest_async_done(RestTransfer *xfer, CURLcode res) {
+    rest_reply_t reply;
+
+    memset(&reply, 0, sizeof(reply));
+    rest_transfer_done(xfer, res, &reply);
+    async_busy--;
+
+    /* The CBOR body rejected by the server is sent again as JSON. The
+     * coalesced PATCH rejected by the server is replayed, the one which
+     * didn't reach it fails for all its lines. */
+    if (rest_cbor_rejected(xfer->cbor, reply.status) ||
+        (xfer->edits.size() > 1 && rest_async_rejected(&reply))) {
+        rest_async_replay(xfer);
+    } else {
+        for (size_t i = 0; i < xfer->edits.size(); i++) {
+            rest_async_check(xfer->edits[i], &reply);
+        }
+    }
+    free(reply.body);
+    free(reply.content_type);
+}
+
+/* Run the transfers till one of the deferred requests is done or,
+ * if all is set, till all of them are done */
+static void rest_async_pump(bool all) {
+    size_t busy = async_busy;
+
+    while (async_busy && (all || async_busy == busy)) {
+        int running = 0;
+        CURLMsg *msg;
+        int left;
+        CURLcode res = CURLE_OK;
+
+        if (curl_multi_perform(many_multi, &running) != CURLM_OK) {
+            res = CURLE_RECV_ERROR;
+        }
+        while (res == CURLE_OK && (msg = curl_multi_info_read(many_multi, &left))) {
+            RestTransfer *xfer = NULL;
+
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &xfer);
+            rest_async_done(xfer, msg->data.result);
+        }
+        /* The multi failed, abort the transfers */
+        for (size_t i = 0; res != CURLE_OK && i < many_slots; i++) {
+            if (many_xfers[i].busy) {
+                rest_async_done(&many_xfers[i], res);
+            }
+        }
+        if (async_busy && (all || async_busy == busy)) {
+            curl_multi_poll(many_multi, NULL, 0, 1000, NULL);
+        }
+    }
+}
+
+/* The path without the query */
+static std::string rest_async_key(const char *path) {
+    return std::string(path, strcspn(path, "?"));
+}
+
+/* Whether the request is for the resource or the parent or the child
+ * of the resource of a deferred request */
+static bool rest_async_depends(const std::string &path) {
+    for (size_t i = 0; i < many_slots; i++) {
+        const std::string &other = many_xfers[i].path;
+        size_t len = std::min(path.size(), other.size());
+
+        if (!many_xfers[i].busy || path.compare(0, len, other, 0, len)) {
+            continue;
+        }
+        if (path.size() == other.size() ||
+            (path.size() > len && path[len] == '/') ||
+            (other.size() > len && other[len] == '/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Send the deferred requests, one or the coalesced ones, once the
+ * requests they depend on are done and the window allows */
+static void rest_async_send(const char *method, const std::string &path,
+                            const std::vector<std::string> &hdrs,
+                            const std::string &body, bool has_body,
+                            std::vector<RestAsyncEdit> &edits) {
+    std::vector<const char *> headers;
+    RestTransfer *xfer = NULL;
+    size_t i;
+
+    std::string key = rest_async_key(path.c_str());
+    if (rest_async_depends(key)) {
+        rest_async_pump(true);
+    }
+    while (async_busy >= std::min(async_window, many_slots)) {
+        rest_async_pump(false);
+    }
+    for (i = 0; i < many_slots; i++) {
+        if (!many_xfers[i].busy) {
+            xfer = &many_xfers[i];
+            break;
+        }
+    }
+
+    xfer->edits.swap(edits);
+    xfer->path = key;
+    xfer->hdrs = hdrs;
+    xfer->body = body;
+    for (i = 0; i < xfer->hdrs.size(); i++) {
+        headers.push_back(xfer->hdrs[i].c_str());
+    }
+    headers.push_back(NULL);
+
+    rest_req_t req = {method, path.c_str(), headers.data(),
+                      has_body ? xfer->body.data() : NULL, xfer->body.size()};
+    rest_transfer_start(xfer, &req, 0, false);
+    async_busy++;
+}
+
+/* The module of the last node of the data path, it's the one of the
+ * nearest node with the module prefix */
+static std::string rest_path_module(const std::string &path) {
+    size_t start = strlen("/restconf/data/");
+    std::string module;
+
+    while (start < path.size()) {
+        size_t end = std::min(path.find('/', start), path.size());
+        size_t colon = path.find(':', start);
+
+        if (colon < end && colon < path.find('=', start)) {
+            module = path.substr(start, colon - start);
+        }
+        start = end + 1;
+    }
+    return module;
+}
+
+/* The PATCH can be coalesced if it's for a container or a leaf in a
+ * container and the body is the member of that node. The list
+ * entries are not merged, their keys aren't known from the path. */
+static bool rest_async_parse(const char *method, const char *path,
+                             const char **headers, const char *body,
+                             size_t body_len, RestAsyncMerge *merge) {
+    bool json = false;
+    const char **hdr;
+
+    if (!async_coalesce || strcmp(method, "PATCH") || !body || strchr(path, '?')) {
+        return false;
+    }
+    for (hdr = headers; hdr && *hdr; hdr++) {
+        if (!strncasecmp(*hdr, "Content-Type:", strlen("Content-Type:")) &&
+            strstr(*hdr, "json")) {
+            json = true;
+        }
+    }
+    if (!json) {
+        return false;
+    }
+
+    std::string target(path);
+    size_t slash = target.rfind('/');
+    if (slash <= strlen("/restconf/data")) {
+        return false;
+    }
+    merge->parent = target.substr(0, slash);
+    std::string node = target.substr(slash + 1);
+    std::string parent_node = merge->parent.substr(merge->parent.rfind('/') + 1);
+    if (node.empty() || node.find('=') != std::string::npos ||
+        parent_node.find('=') != std::string::npos) {
+        return false;
+    }
+
+    std::string text(body, body_len);
+    cJSON *root = cJSON_Parse(text.c_str());
+    if (!cJSON_IsObject(root) || !root->child || root->child->next) {
+        cJSON_Delete(root);
+        return false;
+    }
+
+    /* The member name is qualified by its module or by the one of
+     * the path. The module is omitted in the parent's content if it's
+     * the same, the parent is qualified like the member. */
+    std::string member(root->child->string);
+    size_t colon = member.find(':');
+    std::string local = member.substr(colon == std::string::npos ? 0 : colon + 1);
+    std::string module = (colon == std::string::npos) ?
+        rest_path_module(target) : member.substr(0, colon);
+
+    if (local != node.substr(node.find(':') + 1)) {
+        cJSON_Delete(root);
+        return false;
+    }
+    merge->module = rest_path_module(merge->parent);
+    merge->name = parent_node.substr(parent_node.find(':') + 1);
+    if (colon != std::string::npos) {
+        merge->name = merge->module + ":" + merge->name;
+    }
+    merge->key = (module == merge->module) ? local : module + ":" + local;
+    merge->value = cJSON_DetachItemViaPointer(root, root->child);
+    cJSON_Delete(root);
+
+    return true;
+}
+
+/* Whether the members of the objects collide other than as objects */
+static bool rest_json_conflicts(const cJSON *dst, const cJSON *src) {
+    const cJSON *item;
+
+    cJSON_ArrayForEach(item, src) {
+        const cJSON *other = cJSON_GetObjectItemCaseSensitive(dst, item->string);
+
+        if (other && (!cJSON_IsObject(other) || !cJSON_IsObject(item) ||
+                      rest_json_conflicts(other, item))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Move the members of src into dst */
+static void rest_json_merge(cJSON *dst, cJSON *src) {
+    while (src->child) {
+        cJSON *item = cJSON_DetachItemViaPointer(src, src->child);
+        cJSON *other = cJSON_GetObjectItemCaseSensitive(dst, item->string);
+
+        if (other) {
+            rest_json_merge(other, item);
+            cJSON_Delete(item);
+        } else {
+            cJSON_AddItemToObject(dst, item->string, item);
+        }
+    }
+}
+
+static long rest_elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 +
+        (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+/* Add the PATCH to the held ones. It's not added if it's for another
+ * container or its member was already set by a held one, the value
+ * is kept by the caller then. */
+static bool rest_async_hold(RestAsyncEdit &edit, const std::vector<std::string> &hdrs,
+                            RestAsyncMerge *merge) {
+    RestAsyncHold *hold = &async_hold;
+
+    if (hold->edits.empty()) {
+        hold->parent = merge->parent;
+        hold->module = merge->module;
+        hold->name = merge->name;
+        hold->hdrs = hdrs;
+        hold->content = cJSON_CreateObject();
+        clock_gettime(CLOCK_MONOTONIC, &hold->since);
+        if (!hold->content) {
+            return false;
+        }
+    } else if (hold->parent != merge->parent || hold->hdrs != hdrs ||
+               hold->edits.size() >= REST_COALESCE_MAX) {
+        return false;
+    }
+
+    cJSON *other = cJSON_GetObjectItemCaseSensitive(hold->content, merge->key.c_str());
+    if (other) {
+        if (!cJSON_IsObject(other) || !cJSON_IsObject(merge->value) ||
+            rest_json_conflicts(other, merge->value)) {
+            return false;
+        }
+        rest_json_merge(other, merge->value);
+        cJSON_Delete(merge->value);
+    } else {
+        cJSON_AddItemToObject(hold->content, merge->key.c_str(), merge->value);
+    }
+    merge->value = NULL;
+    hold->edits.push_back(edit);
+
+    return true;
+}
+
+/* Send the held PATCHes as the PATCH of their container */
+static void rest_async_flush() {
+    RestAsyncHold *hold = &async_hold;
+    std::vector<RestAsyncEdit> edits;
+    char *body = NULL;
+
+    if (hold->edits.empty()) {
+        cJSON_Delete(hold->content);
+        hold->content = NULL;
+        return;
+    }
+    edits.swap(hold->edits);
+
+    if (edits.size() > 1) {
+        cJSON *root = cJSON_CreateObject();
+
+        if (root) {
+            cJSON_AddItemToObject(root, hold->name.c_str(), hold->content);
+            hold->content = NULL;
+            body = cJSON_PrintUnformatted(root);
+            cJSON_Delete(root);
+        }
+    }
+    cJSON_Delete(hold->content);
+    hold->content = NULL;
+
+    if (body) {
+        rest_async_send("PATCH", hold->parent, hold->hdrs, body, true, edits);
+        cJSON_free(body);
+        return;
+    }
+    /* Not coalesced */
+    for (size_t i = 0; i < edits.size(); i++) {
+        std::vector<RestAsyncEdit> edit(1, edits[i]);
+
+        rest_async_send("PATCH", edit[0].path, hold->hdrs, edit[0].body, true, edit);
+    }
+}
+
+/* Defer the config request of the current line. It's sent at once,
+ * or held to be coalesced, and the reply is recorded later. The
+ * caller gets the empty success reply. The reads and the RPCs are
+ * not deferred. */
+static bool rest_async_defer(const char *method, const char *path,
+                             const char **headers, const char *body,
+                             size_t body_len, rest_reply_t *reply) {
+    std::vector<std::string> hdrs;
+    RestAsyncMerge merge;
+    RestAsyncEdit edit;
+    const char **hdr;
+
+    if (!async_active ||
+        (strcmp(method, "PATCH") && strcmp(method, "PUT") &&
+         strcmp(method, "POST") && strcmp(method, "DELETE")) ||
+        strncmp(path, "/restconf/data/", strlen("/restconf/data/"))) {
+        return false;
+    }
+
+    edit.method = method;
+    edit.path = path;
+    edit.body.assign(body ? body : "", body ? body_len : 0);
+    edit.seq = ++async_seq;
+    edit.lineno = async_lineno;
+    edit.line = async_line;
+    for (hdr = headers; hdr && *hdr; hdr++) {
+        hdrs.push_back(*hdr);
+    }
+
+    if (rest_async_parse(method, path, headers, body, body_len, &merge)) {
+        if (!rest_async_hold(edit, hdrs, &merge)) {
+            rest_async_flush();
+            if (!rest_async_hold(edit, hdrs, &merge)) {
+                cJSON_Delete(merge.value);
+                rest_async_flush();
+                std::vector<RestAsyncEdit> edits(1, edit);
+                rest_async_send(method, edit.path, hdrs, edit.body, true, edits);
+            }
+        }
+    } else {
+        rest_async_flush();
+        std::vector<RestAsyncEdit> edits(1, edit);
+        rest_async_send(method, edit.path, hdrs, edit.body, body != NULL, edits);
+    }
+
+    memset(reply, 0, sizeof(*reply));
+    reply->status = 204;
+
+    return true;
+}
+
+/* The number of the deferred requests in flight is limited by
+ * CLISH_REST_WINDOW, 0 disables the async mode. The PATCHes are held
+ * for coalescing up to CLISH_REST_COALESCE ms, 0 disables it. */
+static void rest_async_init() {
+    char *window = getenv("CLISH_REST_WINDOW");
+    char *coalesce = getenv("CLISH_REST_COALESCE");
+
+    async_window = window ? strtoul(window, NULL, 10) : REST_MANY_HANDLES;
+    async_window = std::min(async_window, (size_t)REST_MANY_HANDLES);
+    async_coalesce = coalesce ? strtol(coalesce, NULL, 10) : 100;
+}
+
+/* Wait for the deferred requests */
+static void rest_async_wait() {
+    rest_async_flush();
+    if (async_busy) {
+        rest_async_pump(true);
+    }
+}
+
+static bool rest_async_error_less(const RestAsyncError &a, const RestAsyncError &b) {
+    return a.seq < b.seq;
+}
+
+/* Print the errors of the deferred requests done so far in the
+ * order of the lines. Returns the number of the failed requests. */
+static int rest_async_report() {
+    int failed;
+
+    std::stable_sort(async_errors.begin(), async_errors.end(), rest_async_error_less);
+    for (size_t i = 0; i < async_errors.size(); i++) {
+        const RestAsyncError &err = async_errors[i];
+
+        if (err.lineno) {
+            lub_dump_printf("%% Error: %s (line %u: %s)\r\n", err.error.c_str(),
+                            err.lineno, err.line.c_str());
+        } else {
+            lub_dump_printf("%% Error: %s (%s)\r\n", err.error.c_str(), err.line.c_str());
+        }
+    }
+    failed = async_errors.size();
+    async_errors.clear();
+
+    return failed;
+}
+
+/* The config requests of the line are deferred if the async mode is
+ * enabled. The caller holds the command lock. */
+void rest_async_begin(unsigned int lineno, const char *line) {
+    rest_async_report();
+    if (!async_window || !rest_many_init(async_window)) {
+        return;
+    }
+    if (async_hold.edits.size() && rest_elapsed_ms(&async_hold.since) >= async_coalesce) {
+        rest_async_flush();
+    }
+    async_lineno = lineno;
+    async_line.assign(line ? line : "");
+    async_active = true;
+}
+
+void rest_async_end() {
+    async_active = false;
+}
+
+/* Send the held requests, wait for the deferred ones and print their
+ * errors. Returns the number of the failed requests. */
+int rest_async_barrier() {
+    rest_async_wait();
+    return rest_async_report();
+}
+
+/* Issue the requests concurrently and wait for all the replies. The
+ * replies are in the order of the requests, a failed one has the
+ * error set. The caller holds the command lock and frees the reply
+ * bodies and content types. Returns -1 if no request could be
+ * issued. */
+int rest_request_many(const rest_req_t *reqs, rest_reply_t *replies, size_t num) {
+    size_t next = 0, active = 0, slots;
+    size_t i;
+
+    memset(replies, 0, num * sizeof(*replies));
+    if (!num) {
+        return 0;
+    }
+    if (rest_breaker_check(&replies[0])) {
+        return -1;
+    }
+
+    rest_async_wait();
+    if (!rest_many_init(num)) {
+        replies[0].error = "Couldn't initialize curl handle";
+        return -1;
+    }
+    slots = std::min(many_slots, num);
+
+    for (i = 0; i < slots; i++) {
+        rest_transfer_start(&many_xfers[i], &reqs[next], next, true);
+        next++;
+        active++;
+    }
+
+    while (active) {
+        int running = 0;
+        CURLMsg *msg;
+        int left;
+
+        if (curl_multi_perform(many_multi, &running) != CURLM_OK) {
+            break;
+        }
+        while ((msg = curl_multi_info_read(many_multi, &left))) {
+            RestTransfer *xfer = NULL;
+
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &xfer);
+            rest_transfer_done(xfer, msg->data.result, &replies[xfer->index]);
+            active--;
+            /* The handle takes the next request, unless interrupted */
+            if (next < num && !is_ctrlc_pressed()) {
+                rest_transfer_start(xfer, &reqs[next], next, true);
+                next++;
+                active++;
+            }
+        }
+        if (active) {
+            curl_multi_poll(many_multi, NULL, 0, 1000, NULL);
+        }
+    }
+
+    /* The multi failed, abort the transfers still running */
+    for (i = 0; i < slots; i++) {
+        if (many_xfers[i].busy) {
+            rest_transfer_done(&many_xfers[i], CURLE_RECV_ERROR,
+                               &replies[many_xfers[i].index]);
+        }
+    }
+    for (i = next; i < num; i++) {
+        replies[i].error = rest_strerror(is_ctrlc_pressed() ?
+                                         CURLE_ABORTED_BY_CALLBACK : CURLE_RECV_ERROR);
+    }
+
+    return 0;
+}
+
+/* The reply body passed to the caller while it's received. The
+ * transfer is paused while the caller didn't read the received data,
+ * so at most REST_STREAM_CHUNK of the body is kept in memory. */
+#define REST_STREAM_CHUNK (64 * 1024)
+
+struct rest_stream_s {
+    CURL *handle;
+    CURLM *multi;
+    bool own; /* The handle is not the cached one */
+    struct curl_slist *headers;
+    std::string body;
+    PayloadData upload;
+    RestBuffer buf;
+    bool taken; /* The buf is returned by rest_stream_read() */
+    bool paused;
+    bool headers_done;
+    bool done;
+    CURLcode result;
+};
+
+/* The stream handles are kept to reuse the connection */
+static CURL *stream_curl = NULL;
+static CURLM *stream_multi = NULL;
+static bool stream_busy = false;
+
+static size_t stream_write_callback(void *data, size_t size,
+                                    size_t nmemb, void *userdata) {
+    rest_stream_t *stream = reinterpret_cast<rest_stream_t *>(userdata);
+
+    /* curl passes the same data again once it's unpaused */
+    if (stream->buf.len >= REST_STREAM_CHUNK) {
+        stream->paused = true;
+        return CURL_WRITEFUNC_PAUSE;
+    }
+
+    return buffer_write_callback(data, size, nmemb, &stream->buf);
+}
+
+static size_t stream_header_callback(char *hdr, size_t size,
+                                     size_t nitems, void *userdata) {
+    rest_stream_t *stream = reinterpret_cast<rest_stream_t *>(userdata);
+    size_t realsize = size * nitems;
+    long status = 0;
+
+    /* The empty line ends the headers of the final response */
+    if (!strncmp(hdr, "\r\n", realsize) || !strncmp(hdr, "\n", realsize)) {
+        curl_easy_getinfo(stream->handle, CURLINFO_RESPONSE_CODE, &status);
+        if (status >= 200) {
+            stream->headers_done = true;
+        }
+    }
+
+    return realsize;
+}
+
+/* Run the transfer till some data is received or it's done */
+static int rest_stream_pump(rest_stream_t *stream) {
+    int running = 0;
+    CURLMcode mc;
+    CURLMsg *msg;
+    int left;
+
+    mc = curl_multi_perform(stream->multi, &running);
+    if (mc != CURLM_OK) {
+        stream->result = CURLE_RECV_ERROR;
+        stream->done = true;
+        return -1;
+    }
+    while ((msg = curl_multi_info_read(stream->multi, &left))) {
+        if (msg->msg == CURLMSG_DONE) {
+            stream->result = msg->data.result;
+            stream->done = true;
+        }
+    }
+    if (stream->done || stream->buf.len || stream->paused) {
+        return 0;
+    }
+    curl_multi_poll(stream->multi, NULL, 0, 1000, NULL);
+
+    return 0;
+}
+
+static void rest_stream_free(rest_stream_t *stream) {
+    rest_timing(stream->handle);
+    curl_multi_remove_handle(stream->multi, stream->handle);
+    if (stream->own) {
+        curl_multi_cleanup(stream->multi);
+        curl_easy_cleanup(stream->handle);
+    } else {
+        stream_busy = false;
+    }
+    curl_slist_free_all(stream->headers);
+    free(stream->buf.data);
+    delete stream;
+}
+
+/* Issue the request and wait for the reply headers. The status and
+ * content type are returned in the reply, the body is read by
+ * rest_stream_read(). The caller holds the command lock. */
+rest_stream_t *rest_stream_open(const char *method, const char *path,
+                                const char **headers, const char *body,
+                                size_t body_len, rest_reply_t *reply) {
+    std::string url = REST_API_ROOT;
+    rest_stream_t *stream;
+
+    memset(reply, 0, sizeof(*reply));
+    if (rest_breaker_check(reply)) {
+        return NULL;
+    }
+    rest_async_wait();
+
+    stream = new rest_stream_t();
+    /* A stream opened while the other one is read gets own handles */
+    if (!stream_busy) {
+        if (!stream_curl) {
+            stream_curl = _new_curl();
+        }
+        if (!stream_multi) {
+            stream_multi = curl_multi_init();
+        }
+        stream->handle = stream_curl;
+        stream->multi = stream_multi;
+    } else {
+        stream->handle = _new_curl();
+        stream->multi = curl_multi_init();
+        stream->own = true;
+    }
+    if (stream->handle) {
+        rest_set_cancel(stream->handle, true);
+    }
+    if (!stream->handle || !stream->multi) {
+        reply->error = "Couldn't initialize curl handle";
+        if (stream->own) {
+            curl_multi_cleanup(stream->multi);
+            curl_easy_cleanup(stream->handle);
+        }
+        delete stream;
+        return NULL;
+    }
+    if (!stream->own) {
+        stream_busy = true;
+    }
+
+    url += path;
+    stream->headers = rest_request_headers(headers, false);
+
+    CURL *handle = stream->handle;
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, method);
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, stream->headers);
+    curl_easy_setopt(handle, CURLOPT_NOBODY, strcmp(method, "HEAD") ? 0L : 1L);
+    if (body) {
+        stream->body.assign(body, body_len);
+        stream->upload.data = stream->body.data();
+        stream->upload.length = body_len;
+        curl_easy_setopt(handle, CURLOPT_READDATA, &stream->upload);
+        curl_easy_setopt(handle, CURLOPT_INFILESIZE_LARGE, (curl_off_t)body_len);
+        curl_easy_setopt(handle, CURLOPT_UPLOAD, 1L);
+    } else {
+        curl_easy_setopt(handle, CURLOPT_UPLOAD, 0L);
+    }
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, stream_write_callback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, stream);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, stream_header_callback);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, stream);
+    /* The body is read as the caller pulls it, so only the wait for
+     * the headers is limited */
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, (long)REST_CONNECT_TIMEOUT_MS);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, 0L);
+    curl_multi_add_handle(stream->multi, handle);
+
+    struct timespec start;
+    long timeout = rest_timeout(path);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (!stream->headers_done && !stream->done) {
+        rest_stream_pump(stream);
+        if (!stream->headers_done && !stream->done &&
+            (long)(cli_stats_elapsed(&start) / 1000) > timeout) {
+            stream->result = CURLE_OPERATION_TIMEDOUT;
+            stream->done = true;
+        }
+    }
+    rest_breaker_result(stream->done ? stream->result : CURLE_OK);
+    if (stream->done && stream->result != CURLE_OK) {
+        syslog(LOG_WARNING, "rest_stream_open() failed: %s\n",
+                curl_easy_strerror(stream->result));
+        reply->error = rest_strerror(stream->result);
+        rest_stream_free(stream);
+        return NULL;
+    }
+
+    char *ctype = NULL;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &reply->status);
+    curl_easy_getinfo(handle, CURLINFO_CONTENT_TYPE, &ctype);
+    reply->content_type = ctype ? strdup(ctype) : NULL;
+
+    return stream;
+}
+
+/* Returns the next received part of the body. The data is valid till
+ * the next call. Returns 1 if there is data, 0 at the end of the body
+ * and -1 on error. */
+int rest_stream_read(rest_stream_t *stream, const char **data, size_t *len,
+                     const char **error) {
+    /* The body received with the headers is kept for the first read */
+    if (stream->taken) {
+        stream->buf.len = 0;
+        stream->taken = false;
+    }
+    if (stream->paused) {
+        stream->paused = false;
+        curl_easy_pause(stream->handle, CURLPAUSE_CONT);
+    }
+    while (!stream->buf.len && !stream->done) {
+        rest_stream_pump(stream);
+    }
+
+    *data = stream->buf.data;
+    *len = stream->buf.len;
+    if (stream->buf.len) {
+        stream->taken = true;
+        return 1;
+    }
+    if (stream->result != CURLE_OK) {
+        *error = rest_strerror(stream->result);
+        return -1;
+    }
+    return 0;
+}
+
+/* The transfer is aborted if the body is not read till the end */
+void rest_stream_close(rest_stream_t *stream) {
+    if (stream) {
+        rest_stream_free(stream);
+    }
+}
+
+std::string& rtrim(std::string& str, const std::string& chars = "\t\n\v\f\r ")
+{
+    str.erase(str.find_last_not_of(chars) + 1);
+    return str;
+}
+
+int _parse_args (std::string &input, std::string &oper_s, std::string &url_s, std::string &body_s){
+
+    size_t oper_pos = input.find("oper=");
+    if (oper_pos != std::string::npos) {
+        oper_pos += strlen("oper=");
+    }
+
+    size_t url_pos = input.find("url=");
+    if (url_pos == std::string::npos) {
+        syslog(LOG_ERR, "url= missing in %s\r\n", input.c_str());
+        return 1;
+    } else {
+        /* 'oper' terminates just before 'url=' */
+        oper_s = input.substr(oper_pos, url_pos - oper_pos);
+        rtrim(oper_s);
+    
+        url_pos += strlen("url=");
+    }
+
+    url_s = REST_API_ROOT;
+    
+    size_t body_pos = input.find("body=");
+
+    /* If "body=" doesnt exist, 'url' extends till end of string */
+    if (body_pos == std::string::npos) {
+        url_s += input.substr(url_pos);
+    } else {
+        /* 'url' terminates just before 'body=' */
+        url_s += input.substr(url_pos, body_pos - url_pos);
+
+        body_pos += strlen("body=");
+        body_s = input.substr(body_pos);
+
+        rtrim(body_s);
+    }
+
+    rtrim(url_s);
+    
+    return 0;
+}
+
+int rest_cl(char *cmd, const char *buff)
+{
+    CURLcode res;
+
+    int ret_code = 1;
+    std::string url, body, oper;
+    std::string arg = buff;
+
+    setenv("USER_COMMAND", cmd, 1);
+    syslog(LOG_DEBUG, "clish_restcl: cmd=%s", cmd);
+
+    if (rest_breaker_tripped()) {
+        lub_dump_printf("%%Error: %s, try again later\n", rest_error_unavailable);
+        return ret_code;
+    }
+    rest_async_wait();
+
+    _parse_args(arg, oper, url, body);
+    syslog(LOG_DEBUG, "clish_restcl: [oper:%s][path:%s][body:%s]", oper.c_str(), url.c_str(), body.c_str());
+
+    RestResponse ret = {};
+    ret.size = 0;
+
+    if(curl) {
+
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, oper.c_str());
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+
+        /* The body is written as JSON in the ACTION */
+        static const char *json_headers[] = {
+            "accept: application/yang-data+json",
+            "Content-Type: application/yang-data+json",
+            NULL
+        };
+        std::string cbor_body;
+        struct curl_slist *cbor_headers = NULL;
+        bool cbor = body.size() &&
+            rest_cbor_body(json_headers, body.data(), body.size(), cbor_body);
+        if (cbor) {
+            cbor_headers = rest_request_headers(json_headers, true);
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, cbor_headers);
+        }
+
+        PayloadData up_obj = {};
+        if (body.size()) {
+
+            up_obj.data = cbor ? cbor_body.data() : body.c_str();
+            up_obj.length = cbor ? cbor_body.size() : body.size();
+            curl_easy_setopt(curl, CURLOPT_READDATA, &up_obj);
+
+            curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE,
+                    (curl_off_t)up_obj.length);
+
+            curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_UPLOAD, 0L);
+        }
+
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ret);
+        rest_set_timeout(curl, url.c_str() + std::min(url.size(), REST_API_ROOT.size()));
+
+        res = curl_easy_perform(curl);
+        rest_timing(curl);
+        rest_breaker_result(res);
+        if (cbor) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, rest_headers);
+            curl_slist_free_all(cbor_headers);
+
+            int64_t http_code = 0;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+            if (res == CURLE_OK && rest_cbor_rejected(true, http_code)) {
+                return rest_cl(cmd, buff);
+            }
+        }
+        /* Check for errors */
+        if (res == CURLE_ABORTED_BY_CALLBACK) {
+            syslog(LOG_DEBUG, "clish_restcl: interrupted");
+        } else if(res != CURLE_OK) {
             lub_dump_printf("%%Error: Could not connect to Management REST Server\n");
             syslog(LOG_WARNING, "curl_easy_perform() failed: %s\n",
                     curl_easy_strerror(res));
@@ -2,6 +2,7 @@
  * sym_navy.c
  */
 #include "private.h"
+#include "nos_extn.h"
 #include "lub/string.h"
 #include "lub/argv.h"
 #include "lub/conv.h"
@@ -156,6 +157,8 @@ CLISH_PLUGIN_SYM(clish_nested_up)
 
 	if (!this)
 		return -1;
+	/* The deferred config of the view is done before it's left */
+	nos_extn_rest_barrier();
 	/* If depth=0 then exit */
 	if (((depth = clish_shell__get_depth(this)) == 0) ||
 		!clish_shell__set_depth(this, --depth)) {
@@ -5,6 +5,7 @@
  */
 
 #include "private.h"
+#include "nos_extn.h"
 #include "lub/string.h"
 #include "konf/buf.h"
 
@@ -41,6 +42,10 @@ CLISH_PLUGIN_OSYM(clish_script)
 	setenv("USER_COMMAND", cmd, 1);
 	lub_string_free(cmd);
 
+	/* The script sends its own requests after the deferred ones */
+	nos_extn_rest_barrier();
+	rest_breaker_export();
+
 	/* Find out shebang */
 	if (action)
 		shebang = clish_action__get_shebang(action);
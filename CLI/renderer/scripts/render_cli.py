@@ -1,13 +1,29 @@
 #!/usr/bin/env python3
-from jinja2 import Template, Environment, FileSystemLoader
+from jinja2 import Template, Environment, FileSystemLoader, FileSystemBytecodeCache
 import os
 import json
 import sys
 import gc
 import select
 import termios
-from .rpipe_utils import pipestr
 import datetime
+import time
+
+# clish_table renders the plain tables natively, see table_spec(). It is
+# installed next to the clish.
+try:
+    import clish_table
+except ImportError:
+    clish_table = None
+
+# The render time is added to the statistics of the command
+try:
+    from clish_rest import add_time
+except ImportError:
+    try:
+        from cli_client import add_time
+    except ImportError:
+        add_time = None
 
 # Capture our current directory
 #THIS_DIR = os.path.dirname(os.path.abspath(__file__))
@@ -120,46 +136,151 @@ def _write(string, disable_page=False):
                     break
     return False
 
-def write(t_str, continuation=False):
+def write_lines(lines, continuation=False):
+    """
+    Pages the lines pulled from the iterable. The lines are not pulled
+    anymore once the user quits the pager. The output modifiers like
+    '| grep' are applied by klish to the output of the actioner.
+    """
     global line_count
     if not continuation:
         line_count = 0
-    q = False
 
     render_init(0)
-    if t_str != "":
-        pipelst = pipestr().read();
-        for s_str in t_str.split('\n'):
-            if pipelst:
-                if pipelst.process_pipes(s_str):
-                    q = _write(s_str, pipelst.is_page_disabled())
-            else:
-                q = _write(s_str)
-            if q:
-                return True
+    for s_str in lines:
+        if _write(s_str):
+            return True
     return False
 
-def show_cli_output(template_file, response, continuation=False, **kwargs):
-    # Create the jinja2 environment.
-    # Notice the use of trim_blocks, which greatly helps control whitespace.
+def write(t_str, continuation=False):
+    if t_str != "":
+        return write_lines(t_str.split('\n'), continuation=continuation)
+    return write_lines([], continuation=continuation)
 
-    template_path = os.getenv("RENDERER_TEMPLATE_PATH")
-    #template_path = os.path.abspath(os.path.join(THIS_DIR, "../render-templates"))
+def stream_lines(chunks):
+    """
+    Splits the stream of text chunks into lines. The trailing empty
+    line is dropped, it's not printed anyway.
+    """
+    buf = []
+    for chunk in chunks:
+        if '\n' not in chunk:
+            buf.append(chunk)
+            continue
+        parts = chunk.split('\n')
+        buf.append(parts[0])
+        yield ''.join(buf)
+        for part in parts[1:-1]:
+            yield part
+        buf = [parts[-1]]
+    tail = ''.join(buf)
+    if tail:
+        yield tail
+
+def datetimeformat(time):
+    return datetime.datetime.fromtimestamp(int(time)).strftime('%Y-%m-%d %H:%M:%S')
+
+class TemplateBytecodeCache(FileSystemBytecodeCache):
+    """
+    Compiled templates shared by the sessions. The users which can't
+    write the cache directory just read it.
+    """
+    def dump_bytecode(self, bucket):
+        try:
+            FileSystemBytecodeCache.dump_bytecode(self, bucket)
+            os.chmod(self._get_cache_filename(bucket), 0o644)
+        except OSError:
+            pass
 
-    j2_env = Environment(loader=FileSystemLoader(template_path),extensions=['jinja2.ext.do','jinja2.ext.loopcontrols'])
+def bytecode_cache(template_path):
+    """
+    Returns the bytecode cache under the templates directory. The
+    directory is created by the install, the cache is not used without
+    it or if other users can plant the bytecode there.
+    """
+    cache_dir = os.path.join(template_path, '.bytecode')
+    try:
+        st = os.stat(cache_dir)
+    except OSError:
+        return None
+    if st.st_uid not in (0, os.getuid()) or st.st_mode & 0o022:
+        return None
+    return TemplateBytecodeCache(cache_dir)
+
+# The environments by the templates directory. The compiled templates
+# are kept by the environment and reloaded when the file changes.
+j2_envs = {}
+
+def get_env(template_path):
+    j2_env = j2_envs.get(template_path)
+    if j2_env is not None:
+        return j2_env
+
+    # Create the jinja2 environment.
+    # Notice the use of trim_blocks, which greatly helps control whitespace.
+    j2_env = Environment(loader=FileSystemLoader(template_path),
+                         extensions=['jinja2.ext.do','jinja2.ext.loopcontrols'],
+                         bytecode_cache=bytecode_cache(template_path),
+                         auto_reload=True)
     j2_env.trim_blocks = True
     j2_env.lstrip_blocks = True
     j2_env.rstrip_blocks = True
 
-    def datetimeformat(time):
-        return datetime.datetime.fromtimestamp(int(time)).strftime('%Y-%m-%d %H:%M:%S')
-
     j2_env.globals.update(datetimeformat=datetimeformat)
 
-    full_cmd = os.getenv('USER_COMMAND', None)
-    if full_cmd is not None:
-        pipestr().write(full_cmd.split())
+    j2_envs[template_path] = j2_env
+    return j2_env
+
+# The compiled table specs by the spec file, with the file's mtime
+table_specs = {}
+
+def table_spec(template_path, template_file):
+    """
+    Returns the compiled column spec of the table template or None.
+    The spec is the JSON file next to the template, with the .table
+    extension instead of .j2. The templates without the spec, or with
+    more complex layout, are rendered by Jinja.
+    """
+    if clish_table is None:
+        return None
+    spec_file = os.path.join(template_path, os.path.splitext(template_file)[0] + '.table')
+    try:
+        mtime = os.stat(spec_file).st_mtime
+    except OSError:
+        return None
+    cached = table_specs.get(spec_file)
+    if cached is not None and cached[0] == mtime:
+        return cached[1]
+    with open(spec_file) as f:
+        spec = clish_table.compile(json.load(f))
+    table_specs[spec_file] = (mtime, spec)
+    return spec
+
+def show_cli_output(template_file, response, continuation=False, **kwargs):
+    if add_time is None:
+        return _show_cli_output(template_file, response, continuation, **kwargs)
+    # Includes the time the pager waits for the user
+    start = time.monotonic()
+    try:
+        return _show_cli_output(template_file, response, continuation, **kwargs)
+    finally:
+        add_time("render", time.monotonic() - start)
+
+def _show_cli_output(template_file, response, continuation=False, **kwargs):
+    template_path = os.getenv("RENDERER_TEMPLATE_PATH")
+    #template_path = os.path.abspath(os.path.join(THIS_DIR, "../render-templates"))
+
+    if response is not None and not kwargs:
+        spec = table_spec(template_path, template_file)
+        if spec is not None:
+            return write_lines(spec.render(response), continuation=continuation)
+
+    j2_env = get_env(template_path)
 
     if response is not None:
-        t_str = (j2_env.get_template(template_file).render(json_output=response, **kwargs))
-        return write(t_str, continuation=continuation)
+        # The template is rendered as the pager pulls the lines
+        stream = j2_env.get_template(template_file).generate(json_output=response, **kwargs)
+        try:
+            return write_lines(stream_lines(stream), continuation=continuation)
+        finally:
+            stream.close()
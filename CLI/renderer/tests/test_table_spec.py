@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+###########################################################################
+#
+# Copyright 2019 Dell, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###########################################################################
+
+"""
+Diffs the tables rendered by the .table column specs against the
+Jinja templates they replace. Needs jinja2 and the clish_table module
+built by klish:
+
+  PYTHONPATH=build/cli:CLI/renderer python3 -m unittest discover -s CLI/renderer/tests
+"""
+
+import os
+import unittest
+
+from scripts import render_cli
+
+TEMPLATE_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'templates')
+
+
+def interface(name, speed=True, counters=True, description="", **state):
+    intf = {
+        "name": name,
+        "state": {
+            "name": name,
+            "admin-status": state.get("admin", "UP"),
+            "oper-status": state.get("oper", "UP"),
+            "mtu": state.get("mtu", 9100),
+        },
+    }
+    if description is not None:
+        intf["state"]["description"] = description
+    if speed:
+        intf["openconfig-if-ethernet:ethernet"] = {
+            "state": {"port-speed": "openconfig-if-ethernet:SPEED_" + speed
+                      if isinstance(speed, str) else "openconfig-if-ethernet:SPEED_100GB"}
+        }
+    if counters:
+        base = int(name[len("Ethernet"):]) if name.startswith("Ethernet") else 7
+        intf["state"]["counters"] = {
+            "in-pkts": base * 1000 + 1, "in-errors": base, "in-discards": base + 1,
+            "out-pkts": base * 2000 + 2, "out-errors": base + 2, "out-discards": base + 3,
+        }
+    return intf
+
+
+def reply(*interfaces):
+    return {"openconfig-interfaces:interfaces": {"interface": list(interfaces)}}
+
+
+CASES = {
+    "full": reply(*[interface("Ethernet%d" % i, description="port %d" % i if i % 3 else "",
+                              oper="DOWN" if i % 2 else "UP") for i in range(0, 64, 4)]),
+    "non_ethernet_filtered": reply(interface("Ethernet0"), interface("PortChannel1"),
+                                   interface("Vlan10"), interface("Ethernet4")),
+    "missing_speed": reply(interface("Ethernet0", speed="40GB"), interface("Ethernet4", speed=False),
+                           interface("Ethernet8", speed="10GB")),
+    "missing_counters": reply(interface("Ethernet0"), interface("Ethernet4", counters=False),
+                              interface("Ethernet8")),
+    "missing_description": reply(interface("Ethernet0", description="uplink"),
+                                 interface("Ethernet4", description=None)),
+    "empty_list": reply(),
+    "empty_reply": {},
+}
+
+
+@unittest.skipIf(render_cli.clish_table is None, "clish_table module is not built")
+class TableSpecTest(unittest.TestCase):
+
+    def render_jinja(self, template_file, data):
+        env = render_cli.get_env(TEMPLATE_PATH)
+        stream = env.get_template(template_file).generate(json_output=data)
+        # The empty lines are not printed by write_lines()
+        return [line for line in render_cli.stream_lines(stream) if line]
+
+    def render_spec(self, template_file, data):
+        spec = render_cli.table_spec(TEMPLATE_PATH, template_file)
+        self.assertIsNotNone(spec)
+        return [line for line in spec.render(data) if line]
+
+    def check(self, template_file):
+        for case, data in CASES.items():
+            with self.subTest(case=case):
+                self.assertEqual(self.render_spec(template_file, data),
+                                 self.render_jinja(template_file, data))
+
+    def test_interface_status(self):
+        self.check("show_interface_status.j2")
+
+    def test_interface_counters(self):
+        self.check("show_interface_counters.j2")
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -48,6 +48,9 @@ var (
 	caFile     string // Client CA certificate file path
 	clientAuth string // Client auth mode
 
+	// compressMinSize is the smallest response size to be compressed
+	compressMinSize int = 4096
+
 	// readTimeout is the deadline for receiving a full request (TLS+header+body)
 	// once the connection is made. Value 0 indicates no timeout.
 	readTimeout time.Duration = 15 * time.Second
@@ -62,6 +65,7 @@ func init() {
 	flag.StringVar(&caFile, "cacert", "", "CA certificate for client certificate validation")
 	flag.StringVar(&clientAuth, "client_auth", "none", "Client auth mode - none|cert|user")
 	flag.DurationVar(&readTimeout, "readtimeout", readTimeout, "Maximum duration for reading entire request")
+	flag.IntVar(&compressMinSize, "compress_min_size", compressMinSize, "Smallest response size to be compressed; 0 disables compression")
 	flag.Parse()
 }
 
@@ -87,7 +91,7 @@ func main() {
 
 	openapi.Load()
 
-	rtrConfig := server.RouterConfig{}
+	rtrConfig := server.RouterConfig{CompressMinSize: compressMinSize}
 	if clientAuth == "user" {
 		rtrConfig.AuthEnable = true
 	}
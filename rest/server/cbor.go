@@ -0,0 +1,419 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright 2020 Broadcom. The term Broadcom refers to Broadcom Inc. and/or //
+//  its subsidiaries.                                                         //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//     http://www.apache.org/licenses/LICENSE-2.0                             //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+package server
+
+import (
+	"bytes"
+	"encoding/base64"
+	"encoding/binary"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"math"
+	"strconv"
+	"strings"
+)
+
+// The application/yang-data+cbor (RFC 9254) support. Data nodes are
+// identified by their names, like in the JSON encoding; YANG SIDs are
+// not supported. Translib and the request validation work on JSON,
+// hence CBOR payloads are transcoded to and from the JSON encoding
+// without building an object tree.
+
+const (
+	cborUint   = 0
+	cborNegInt = 1
+	cborBytes  = 2
+	cborText   = 3
+	cborArray  = 4
+	cborMap    = 5
+	cborTag    = 6
+	cborSimple = 7
+
+	cborIndefinite = 31
+	cborBreak      = 0xff
+
+	// cborMaxDepth limits the nesting of the decoded data
+	cborMaxDepth = 512
+)
+
+var errCBORTruncated = errors.New("truncated cbor data")
+
+// prefersCBOR checks if the Accept header value asks for
+// application/yang-data+cbor at least as much as for JSON.
+func prefersCBOR(accept string) bool {
+	cborQ, jsonQ := -1.0, -1.0
+	for _, v := range strings.Split(accept, ",") {
+		params := strings.Split(v, ";")
+		q := 1.0
+		for _, p := range params[1:] {
+			p = strings.TrimSpace(p)
+			if strings.HasPrefix(p, "q=") {
+				if f, err := strconv.ParseFloat(p[2:], 64); err == nil {
+					q = f
+				}
+			}
+		}
+
+		switch strings.ToLower(strings.TrimSpace(params[0])) {
+		case mimeYangDataCBOR:
+			cborQ = q
+		case mimeYangDataJSON, "application/json":
+			jsonQ = math.Max(jsonQ, q)
+		}
+	}
+
+	return cborQ > 0 && cborQ >= jsonQ
+}
+
+// cborHead writes the initial bytes of a data item with the major
+// type and the argument in the shortest form.
+func cborHead(buff *bytes.Buffer, major byte, arg uint64) {
+	major <<= 5
+	switch {
+	case arg < 24:
+		buff.WriteByte(major | byte(arg))
+	case arg <= math.MaxUint8:
+		buff.Write([]byte{major | 24, byte(arg)})
+	case arg <= math.MaxUint16:
+		buff.WriteByte(major | 25)
+		binary.Write(buff, binary.BigEndian, uint16(arg))
+	case arg <= math.MaxUint32:
+		buff.WriteByte(major | 26)
+		binary.Write(buff, binary.BigEndian, uint32(arg))
+	default:
+		buff.WriteByte(major | 27)
+		binary.Write(buff, binary.BigEndian, arg)
+	}
+}
+
+func cborNumber(buff *bytes.Buffer, n json.Number) error {
+	if i, err := strconv.ParseInt(string(n), 10, 64); err == nil {
+		if i < 0 {
+			cborHead(buff, cborNegInt, uint64(-1-i))
+		} else {
+			cborHead(buff, cborUint, uint64(i))
+		}
+		return nil
+	}
+	if u, err := strconv.ParseUint(string(n), 10, 64); err == nil {
+		cborHead(buff, cborUint, u)
+		return nil
+	}
+
+	f, err := n.Float64()
+	if err != nil {
+		return err
+	}
+	buff.WriteByte(cborSimple<<5 | 27)
+	return binary.Write(buff, binary.BigEndian, math.Float64bits(f))
+}
+
+// jsonToCBOR transcodes JSON data into CBOR. Objects and arrays are
+// written with indefinite lengths, so the data is converted in one pass.
+func jsonToCBOR(data []byte) ([]byte, error) {
+	dec := json.NewDecoder(bytes.NewReader(data))
+	dec.UseNumber()
+
+	var buff bytes.Buffer
+	buff.Grow(len(data))
+	depth := 0
+	for {
+		tok, err := dec.Token()
+		if err == io.EOF && depth == 0 {
+			break
+		}
+		if err == io.EOF {
+			err = io.ErrUnexpectedEOF
+		}
+		if err != nil {
+			return nil, err
+		}
+
+		switch v := tok.(type) {
+		case json.Delim:
+			switch v {
+			case '{':
+				buff.WriteByte(cborMap<<5 | cborIndefinite)
+				depth++
+			case '[':
+				buff.WriteByte(cborArray<<5 | cborIndefinite)
+				depth++
+			default:
+				buff.WriteByte(cborBreak)
+				depth--
+			}
+		case string:
+			cborHead(&buff, cborText, uint64(len(v)))
+			buff.WriteString(v)
+		case json.Number:
+			if err = cborNumber(&buff, v); err != nil {
+				return nil, err
+			}
+		case bool:
+			if v {
+				buff.WriteByte(cborSimple<<5 | 21)
+			} else {
+				buff.WriteByte(cborSimple<<5 | 20)
+			}
+		case nil:
+			buff.WriteByte(cborSimple<<5 | 22)
+		}
+	}
+
+	return buff.Bytes(), nil
+}
+
+// cborDecoder transcodes CBOR data items into JSON
+type cborDecoder struct {
+	data []byte
+	pos  int
+	out  bytes.Buffer
+}
+
+// cborToJSON transcodes CBOR data into JSON. Map keys must be text
+// strings; byte strings are written as base64 like the YANG binary
+// type in JSON.
+func cborToJSON(data []byte) ([]byte, error) {
+	d := cborDecoder{data: data}
+	d.out.Grow(len(data) * 5 / 4)
+	if err := d.item(0); err != nil {
+		return nil, err
+	}
+	if d.pos != len(data) {
+		return nil, errors.New("extra data after cbor item")
+	}
+	return d.out.Bytes(), nil
+}
+
+// head reads the initial bytes of a data item. Returns the major type,
+// additional info and the argument.
+func (d *cborDecoder) head() (byte, byte, uint64, error) {
+	if d.pos >= len(d.data) {
+		return 0, 0, 0, errCBORTruncated
+	}
+	b := d.data[d.pos]
+	d.pos++
+	major, info := b>>5, b&0x1f
+
+	var size int
+	switch {
+	case info < 24:
+		return major, info, uint64(info), nil
+	case info == cborIndefinite:
+		return major, info, 0, nil
+	case info <= 27:
+		size = 1 << (info - 24)
+	default:
+		return 0, 0, 0, fmt.Errorf("bad cbor additional info %d", info)
+	}
+	if d.pos+size > len(d.data) {
+		return 0, 0, 0, errCBORTruncated
+	}
+
+	var arg uint64
+	for _, c := range d.data[d.pos : d.pos+size] {
+		arg = arg<<8 | uint64(c)
+	}
+	d.pos += size
+	return major, info, arg, nil
+}
+
+// isBreak consumes the break code if it's next
+func (d *cborDecoder) isBreak() bool {
+	if d.pos < len(d.data) && d.data[d.pos] == cborBreak {
+		d.pos++
+		return true
+	}
+	return false
+}
+
+// str reads a byte or text string, the indefinite length one
+// as the concatenation of its chunks.
+func (d *cborDecoder) str(major, info byte, arg uint64) ([]byte, error) {
+	if info != cborIndefinite {
+		if arg > uint64(len(d.data)-d.pos) {
+			return nil, errCBORTruncated
+		}
+		s := d.data[d.pos : d.pos+int(arg)]
+		d.pos += int(arg)
+		return s, nil
+	}
+
+	var s []byte
+	for !d.isBreak() {
+		m, i, n, err := d.head()
+		if err != nil {
+			return nil, err
+		}
+		if m != major || i == cborIndefinite {
+			return nil, errors.New("bad cbor string chunk")
+		}
+		chunk, err := d.str(m, i, n)
+		if err != nil {
+			return nil, err
+		}
+		s = append(s, chunk...)
+	}
+	return s, nil
+}
+
+func (d *cborDecoder) item(depth int) error {
+	if depth > cborMaxDepth {
+		return errors.New("cbor data nested too deep")
+	}
+	major, info, arg, err := d.head()
+	if err != nil {
+		return err
+	}
+
+	switch major {
+	case cborUint:
+		d.out.WriteString(strconv.FormatUint(arg, 10))
+	case cborNegInt:
+		if arg > math.MaxInt64 {
+			return errors.New("cbor negative integer out of range")
+		}
+		d.out.WriteString(strconv.FormatInt(-1-int64(arg), 10))
+	case cborBytes, cborText:
+		s, err := d.str(major, info, arg)
+		if err != nil {
+			return err
+		}
+		var str string
+		if major == cborBytes {
+			str = base64.StdEncoding.EncodeToString(s)
+		} else {
+			str = string(s)
+		}
+		enc, _ := json.Marshal(str)
+		d.out.Write(enc)
+	case cborArray, cborMap:
+		return d.container(major, info, arg, depth)
+	case cborTag:
+		// Tags carry no meaning for the JSON encoding
+		return d.item(depth + 1)
+	case cborSimple:
+		return d.simple(info, arg)
+	}
+
+	return nil
+}
+
+func (d *cborDecoder) container(major, info byte, arg uint64, depth int) error {
+	if major == cborMap {
+		d.out.WriteByte('{')
+	} else {
+		d.out.WriteByte('[')
+	}
+
+	for i := uint64(0); ; i++ {
+		if info == cborIndefinite {
+			if d.isBreak() {
+				break
+			}
+		} else if i == arg {
+			break
+		}
+		if i != 0 {
+			d.out.WriteByte(',')
+		}
+
+		if major == cborMap {
+			m, ki, n, err := d.head()
+			if err != nil {
+				return err
+			}
+			if m != cborText {
+				return errors.New("cbor map key is not a text string")
+			}
+			key, err := d.str(m, ki, n)
+			if err != nil {
+				return err
+			}
+			enc, _ := json.Marshal(string(key))
+			d.out.Write(enc)
+			d.out.WriteByte(':')
+		}
+		if err := d.item(depth + 1); err != nil {
+			return err
+		}
+	}
+
+	if major == cborMap {
+		d.out.WriteByte('}')
+	} else {
+		d.out.WriteByte(']')
+	}
+	return nil
+}
+
+func (d *cborDecoder) simple(info byte, arg uint64) error {
+	var f float64
+	switch info {
+	case 20:
+		d.out.WriteString("false")
+		return nil
+	case 21:
+		d.out.WriteString("true")
+		return nil
+	case 22, 23: // null, undefined
+		d.out.WriteString("null")
+		return nil
+	case 25:
+		f = halfToFloat(uint16(arg))
+	case 26:
+		f = float64(math.Float32frombits(uint32(arg)))
+	case 27:
+		f = math.Float64frombits(arg)
+	default:
+		return fmt.Errorf("unsupported cbor simple value %d", info)
+	}
+
+	if math.IsNaN(f) || math.IsInf(f, 0) {
+		return errors.New("cbor float not representable in json")
+	}
+	d.out.WriteString(strconv.FormatFloat(f, 'g', -1, 64))
+	return nil
+}
+
+// halfToFloat converts an IEEE 754 half precision value
+func halfToFloat(h uint16) float64 {
+	exp := int(h>>10) & 0x1f
+	mant := float64(h & 0x3ff)
+	var f float64
+	switch exp {
+	case 0:
+		f = math.Ldexp(mant, -24)
+	case 31:
+		if mant == 0 {
+			f = math.Inf(1)
+		} else {
+			f = math.NaN()
+		}
+	default:
+		f = math.Ldexp(mant+1024, exp-25)
+	}
+	if h&0x8000 != 0 {
+		f = -f
+	}
+	return f
+}
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright 2020 Broadcom. The term Broadcom refers to Broadcom Inc. and/or //
+//  its subsidiaries.                                                         //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//     http://www.apache.org/licenses/LICENSE-2.0                             //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+package server
+
+import (
+	"encoding/hex"
+	"encoding/json"
+	"reflect"
+	"testing"
+)
+
+func testCBORToJSON(cborHex, expJSON string) func(*testing.T) {
+	return func(t *testing.T) {
+		data, _ := hex.DecodeString(cborHex)
+		jsn, err := cborToJSON(data)
+		if expJSON == "" {
+			if err == nil {
+				t.Fatalf("Expecting error for %s; found %s", cborHex, jsn)
+			}
+			return
+		}
+		if err != nil {
+			t.Fatalf("Failed to decode %s; err=%v", cborHex, err)
+		}
+		if string(jsn) != expJSON {
+			t.Fatalf("Expecting %s; found %s", expJSON, jsn)
+		}
+	}
+}
+
+// Examples from RFC 8949 Appendix A
+func TestCBORToJSON(t *testing.T) {
+	t.Run("uint", testCBORToJSON("1903e8", "1000"))
+	t.Run("uint64", testCBORToJSON("1bffffffffffffffff", "18446744073709551615"))
+	t.Run("negint", testCBORToJSON("3903e7", "-1000"))
+	t.Run("half", testCBORToJSON("f93e00", "1.5"))
+	t.Run("float", testCBORToJSON("fa47c35000", "100000"))
+	t.Run("double", testCBORToJSON("fb3ff199999999999a", "1.1"))
+	t.Run("simple", testCBORToJSON("83f4f5f6", "[false,true,null]"))
+	t.Run("text", testCBORToJSON("62c3bc", `"ü"`))
+	t.Run("bytes", testCBORToJSON("4401020304", `"AQIDBA=="`))
+	t.Run("tag", testCBORToJSON("c074323031332d30332d32315432303a30343a30305a",
+		`"2013-03-21T20:04:00Z"`))
+	t.Run("map", testCBORToJSON("a26161016162820203", `{"a":1,"b":[2,3]}`))
+	t.Run("indef", testCBORToJSON("bf61610161629f0203ffff", `{"a":1,"b":[2,3]}`))
+	t.Run("indef_text", testCBORToJSON("7f657374726561646d696e67ff", `"streaming"`))
+	t.Run("escape", testCBORToJSON("62220a", `"\"\n"`))
+	t.Run("int_key", testCBORToJSON("a10102", ""))
+	t.Run("truncated", testCBORToJSON("a2616101", ""))
+	t.Run("extra", testCBORToJSON("0101", ""))
+	t.Run("nan", testCBORToJSON("f97e00", ""))
+}
+
+func TestJSONToCBOR(t *testing.T) {
+	cbor, err := jsonToCBOR([]byte(`{"a":1,"b":[-2,true,null],"c":"x","d":1.5}`))
+	if err != nil {
+		t.Fatalf("Failed to encode; err=%v", err)
+	}
+	exp := "bf61610161629f21f5f6ff616361786164fb3ff8000000000000ff"
+	if hex.EncodeToString(cbor) != exp {
+		t.Fatalf("Expecting %s; found %x", exp, cbor)
+	}
+
+	if _, err = jsonToCBOR([]byte(`{"a":`)); err == nil {
+		t.Fatalf("Expecting error for truncated json")
+	}
+}
+
+func TestCBORRoundTrip(t *testing.T) {
+	input := testPayload(10)
+	cbor, err := jsonToCBOR(input)
+	if err != nil {
+		t.Fatalf("Failed to encode; err=%v", err)
+	}
+	jsn, err := cborToJSON(cbor)
+	if err != nil {
+		t.Fatalf("Failed to decode; err=%v", err)
+	}
+
+	var exp, found interface{}
+	json.Unmarshal(input, &exp)
+	json.Unmarshal(jsn, &found)
+	if !reflect.DeepEqual(exp, found) {
+		t.Fatalf("Round trip mismatch;\nexp=%s\nfound=%s", input, jsn)
+	}
+}
+
+func TestPrefersCBOR(t *testing.T) {
+	for _, v := range []string{
+		"application/yang-data+cbor",
+		"application/yang-data+cbor, application/yang-data+json;q=0.9",
+		"application/yang-data+json;q=0.5, application/yang-data+cbor;q=0.5",
+	} {
+		if !prefersCBOR(v) {
+			t.Fatalf("Accept '%s' did not prefer cbor", v)
+		}
+	}
+	for _, v := range []string{
+		"", "*/*", "application/yang-data+json",
+		"application/yang-data+cbor;q=0.5, application/yang-data+json",
+		"application/yang-data+cbor;q=0",
+	} {
+		if prefersCBOR(v) {
+			t.Fatalf("Accept '%s' preferred cbor", v)
+		}
+	}
+}
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright 2020 Broadcom. The term Broadcom refers to Broadcom Inc. and/or //
+//  its subsidiaries.                                                         //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//     http://www.apache.org/licenses/LICENSE-2.0                             //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+package server
+
+import (
+	"bytes"
+	"compress/gzip"
+	"net/http"
+	"strconv"
+	"strings"
+	"sync"
+)
+
+// gzipWriters pools the gzip writers; their state is large and costly
+// to allocate for every response.
+var gzipWriters = sync.Pool{
+	New: func() interface{} {
+		w, _ := gzip.NewWriterLevel(nil, gzip.BestSpeed)
+		return w
+	},
+}
+
+// compressMinSize returns the smallest response size to be compressed
+// from the RouterConfig of the request. Returns 0 (no compression)
+// if the request was not routed through a Router.
+func compressMinSize(r *http.Request) int {
+	if rr, ok := getContextValue(r, routerObjContextKey).(*Router); ok {
+		return rr.config.CompressMinSize
+	}
+	return 0
+}
+
+// compressResponse gzips the response data if the client accepts gzip
+// and data is at least minSize bytes. Sets the Content-Encoding header
+// and returns the data to be written. The ETag, if any, is made weak
+// since the encoded bytes differ from the identity ones.
+func compressResponse(w http.ResponseWriter, r *http.Request, data []byte, minSize int) []byte {
+	if minSize <= 0 || len(data) < minSize {
+		return data
+	}
+
+	w.Header().Add("Vary", "Accept-Encoding")
+	if !acceptsEncoding(r.Header.Get("Accept-Encoding"), "gzip") {
+		return data
+	}
+
+	var buff bytes.Buffer
+	buff.Grow(len(data) / 4)
+	gz := gzipWriters.Get().(*gzip.Writer)
+	gz.Reset(&buff)
+	_, err := gz.Write(data)
+	if err == nil {
+		err = gz.Close()
+	}
+	gzipWriters.Put(gz)
+	if err != nil || buff.Len() >= len(data) {
+		return data
+	}
+
+	w.Header().Set("Content-Encoding", "gzip")
+	if etag := w.Header().Get("ETag"); etag != "" && !strings.HasPrefix(etag, "W/") {
+		w.Header().Set("ETag", "W/"+etag)
+	}
+	return buff.Bytes()
+}
+
+// acceptsEncoding checks if an Accept-Encoding header value allows
+// the content coding. Codings with q=0 are not acceptable; "*" matches
+// the codings not listed explicitly.
+func acceptsEncoding(accept, coding string) bool {
+	wildcard := false
+	for _, v := range strings.Split(accept, ",") {
+		params := strings.Split(v, ";")
+		name := strings.ToLower(strings.TrimSpace(params[0]))
+		if name != coding && name != "*" {
+			continue
+		}
+
+		ok := true
+		for _, p := range params[1:] {
+			p = strings.TrimSpace(p)
+			if strings.HasPrefix(p, "q=") {
+				q, err := strconv.ParseFloat(p[2:], 64)
+				ok = (err == nil && q > 0)
+			}
+		}
+
+		if name == coding {
+			return ok
+		}
+		wildcard = ok
+	}
+
+	return wildcard
+}
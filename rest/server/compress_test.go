@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright 2020 Broadcom. The term Broadcom refers to Broadcom Inc. and/or //
+//  its subsidiaries.                                                         //
+//                                                                            //
+//  Licensed under the Apache License, Version 2.0 (the "License");           //
+//  you may not use this file except in compliance with the License.          //
+//  You may obtain a copy of the License at                                   //
+//                                                                            //
+//     http://www.apache.org/licenses/LICENSE-2.0                             //
+//                                                                            //
+//  Unless required by applicable law or agreed to in writing, software       //
+//  distributed under the License is distributed on an "AS IS" BASIS,         //
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  //
+//  See the License for the specific language governing permissions and       //
+//  limitations under the License.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+package server
+
+import (
+	"bytes"
+	"compress/gzip"
+	"fmt"
+	"io/ioutil"
+	"net/http/httptest"
+	"testing"
+	"time"
+)
+
+// testPayload returns an interface list JSON similar to the
+// "show interface status" response of a switch with n ports.
+func testPayload(n int) []byte {
+	var buff bytes.Buffer
+	buff.WriteString(`{"openconfig-interfaces:interfaces":{"interface":[`)
+	for i := 0; i < n; i++ {
+		if i != 0 {
+			buff.WriteByte(',')
+		}
+		fmt.Fprintf(&buff, `{"name":"Ethernet%d","config":{"name":"Ethernet%d",`+
+			`"mtu":9100,"description":"port %d","enabled":true},"state":{"name":"Ethernet%d",`+
+			`"mtu":9100,"admin-status":"UP","oper-status":"DOWN","counters":{"in-octets":"%d",`+
+			`"out-octets":"%d","in-pkts":"%d","out-pkts":"%d"}}}`, i*4, i*4, i, i*4,
+			i*7919, i*104729, i*31, i*17)
+	}
+	buff.WriteString(`]}}`)
+	return buff.Bytes()
+}
+
+func testCompress(accept string, size, minSize int, expGzip bool) func(*testing.T) {
+	return func(t *testing.T) {
+		data := testPayload(size)
+		r := httptest.NewRequest("GET", "/restconf/data/compresstest", nil)
+		if accept != "" {
+			r.Header.Set("Accept-Encoding", accept)
+		}
+		w := httptest.NewRecorder()
+		w.Header().Set("ETag", payloadETag(data))
+
+		out := compressResponse(w, r, data, minSize)
+		coding := w.Header().Get("Content-Encoding")
+		if !expGzip {
+			if coding != "" || !bytes.Equal(out, data) {
+				t.Fatalf("Expecting uncompressed data; found Content-Encoding '%s'", coding)
+			}
+			return
+		}
+
+		if coding != "gzip" {
+			t.Fatalf("Expecting Content-Encoding gzip; found '%s'", coding)
+		}
+		if etag := w.Header().Get("ETag"); etag != "W/"+payloadETag(data) {
+			t.Fatalf("Expecting weak ETag; found '%s'", etag)
+		}
+		gz, err := gzip.NewReader(bytes.NewReader(out))
+		if err != nil {
+			t.Fatalf("Invalid gzip data; err=%v", err)
+		}
+		plain, err := ioutil.ReadAll(gz)
+		if err != nil || !bytes.Equal(plain, data) {
+			t.Fatalf("Decompressed data does not match; err=%v", err)
+		}
+	}
+}
+
+func TestCompress(t *testing.T) {
+	t.Run("gzip", testCompress("gzip", 100, 1024, true))
+	t.Run("gzip_deflate", testCompress("deflate, gzip;q=0.5", 100, 1024, true))
+	t.Run("wildcard", testCompress("*", 100, 1024, true))
+	t.Run("no_accept", testCompress("", 100, 1024, false))
+	t.Run("identity", testCompress("identity", 100, 1024, false))
+	t.Run("gzip_q0", testCompress("gzip;q=0, *", 100, 1024, false))
+	t.Run("small", testCompress("gzip", 1, 1024, false))
+	t.Run("disabled", testCompress("gzip", 100, 0, false))
+}
+
+func TestAcceptsEncoding(t *testing.T) {
+	for _, v := range []string{"gzip", "GZIP", "br, gzip", "gzip;q=1.0", "*", "zstd, *;q=0.1"} {
+		if !acceptsEncoding(v, "gzip") {
+			t.Fatalf("Accept-Encoding '%s' did not accept gzip", v)
+		}
+	}
+	for _, v := range []string{"", "identity", "gzip;q=0", "*;q=0", "*, gzip;q=0", "deflate"} {
+		if acceptsEncoding(v, "gzip") {
+			t.Fatalf("Accept-Encoding '%s' accepted gzip", v)
+		}
+	}
+}
+
+// BenchmarkCompress measures the CPU cost of compressing the interface
+// lists of various sizes. It reports the compression ratio and the time
+// saved on a 100Mbps management link ("net-ns/op") to compare with the
+// compression time.
+func BenchmarkCompress(b *testing.B) {
+	for _, n := range []int{10, 100, 1000} {
+		data := testPayload(n)
+		b.Run(fmt.Sprintf("ports_%d", n), func(b *testing.B) {
+			r := httptest.NewRequest("GET", "/restconf/data/compresstest", nil)
+			r.Header.Set("Accept-Encoding", "gzip")
+			var out []byte
+			b.SetBytes(int64(len(data)))
+			for i := 0; i < b.N; i++ {
+				out = compressResponse(httptest.NewRecorder(), r, data, 1)
+			}
+			saved := time.Duration(int64(len(data)-len(out)) * 8 * 10) // ns at 100Mbps
+			b.ReportMetric(float64(len(data))/float64(len(out)), "ratio")
+			b.ReportMetric(float64(saved.Nanoseconds()), "net-ns/op")
+		})
+	}
+}
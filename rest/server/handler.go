@@ -21,6 +21,7 @@ package server
 
 import (
 	"fmt"
+	"hash/fnv"
 	"io/ioutil"
 	"net/http"
 	"net/url"
@@ -43,6 +44,8 @@ func Process(w http.ResponseWriter, r *http.Request) {
 	var status int
 	var data []byte
 	var rtype string
+	var etag string
+	var cbor bool
 
 	glog.Infof("[%s] %s %s; content-len=%d", reqID, r.Method, r.URL.Path, r.ContentLength)
 	_, args.data, err = getRequestBody(r, rc)
@@ -65,12 +68,24 @@ func Process(w http.ResponseWriter, r *http.Request) {
 	args.path = getPathForTranslib(r, rc)
 	glog.V(1).Infof("[%s] Translated path = %s", reqID, args.path)
 
+	// Reads of the client which went away are not processed further
+	if args.isRead() && clientGone(r, rc) {
+		return
+	}
+
 	status, data, err = invokeTranslib(&args, rc)
 	if err != nil {
 		glog.Warningf("[%s] Translib error %T - %v", reqID, err, err)
 		status, data, rtype = prepareErrorResponse(err, r)
 		goto write_resp
 	}
+	if args.isRead() && clientGone(r, rc) {
+		return
+	}
+
+	if args.isRead() {
+		etag = payloadETag(data)
+	}
 
 	// Special handling for HEAD -- ignore the data but set content-length.
 	// HTTP spec says HEAD can return content-length and content-type as if it was a GET.
@@ -86,6 +101,40 @@ func Process(w http.ResponseWriter, r *http.Request) {
 		goto write_resp
 	}
 
+	// Client can ask for CBOR instead of JSON data. The ETag becomes
+	// weak since the bytes differ from the JSON ones.
+	if mt, _ := parseMediaType(rtype); mt != nil && mt.isJSON() {
+		w.Header().Add("Vary", "Accept")
+		cbor = prefersCBOR(r.Header.Get("Accept"))
+	}
+
+	// GET response carries an ETag. Client sends it back through
+	// If-None-Match header and gets 304 without the data if unchanged.
+	// The 304 has the ETag and Vary headers of the full response.
+	if etag != "" {
+		if cbor {
+			w.Header().Set("ETag", "W/"+etag)
+		} else {
+			w.Header().Set("ETag", etag)
+		}
+		if etagMatches(r.Header.Get("If-None-Match"), etag) {
+			status = http.StatusNotModified
+			data = nil
+			goto write_resp
+		}
+	}
+
+	if cbor {
+		if cdata, err := jsonToCBOR(data); err == nil {
+			data, rtype = cdata, mimeYangDataCBOR
+		} else {
+			glog.Warningf("[%s] Failed to encode cbor, sending json; err=%v", rc.ID, err)
+			if etag != "" {
+				w.Header().Set("ETag", etag)
+			}
+		}
+	}
+
 write_resp:
 	glog.Infof("[%s] Sending response %d, type=%s, size=%d", reqID, status, rtype, len(data))
 	glog.V(1).Infof("[%s] data=%s", reqID, data)
@@ -97,6 +146,7 @@ write_resp:
 	//	3. Finally, write response body via w.Write(bytes)
 	if len(data) != 0 {
 		w.Header().Set("Content-Type", rtype)
+		data = compressResponse(w, r, data, compressMinSize(r))
 		w.WriteHeader(status)
 		w.Write([]byte(data))
 	} else {
@@ -105,6 +155,17 @@ write_resp:
 	}
 }
 
+// clientGone checks if the client has closed the connection, like the
+// CLI does when the command is interrupted by Ctrl-C. The request
+// context is cancelled then.
+func clientGone(r *http.Request, rc *RequestContext) bool {
+	if err := r.Context().Err(); err != nil {
+		glog.Infof("[%s] Client went away; %v", rc.ID, err)
+		return true
+	}
+	return false
+}
+
 // getRequestID returns the request ID for a http Request r.
 // ID is looked up from the RequestContext associated with this request.
 // Returns empty value if context is not initialized yet.
@@ -146,6 +207,16 @@ func getRequestBody(r *http.Request, rc *RequestContext) (*MediaType, []byte, er
 		return nil, nil, httpBadRequest("Bad content-type")
 	}
 
+	// CBOR body is accepted wherever JSON is; it is transcoded to JSON
+	// for the validation and translib.
+	if ct.Type == mimeYangDataCBOR && rc.Consumes.Contains(mimeYangDataJSON) {
+		if body, err = cborToJSON(body); err != nil {
+			glog.Warningf("[%s] cbor decoding error; %v", rc.ID, err)
+			return nil, nil, httpBadRequest("Invalid cbor")
+		}
+		ct, _ = parseMediaType(mimeYangDataJSON)
+	}
+
 	// Check if content type is one of the acceptable types specified
 	// in "consumes" section in OpenAPI spec.
 	if !rc.Consumes.Contains(ct.Type) {
@@ -182,6 +253,28 @@ func resolveResponseContentType(data []byte, r *http.Request, rc *RequestContext
 	return http.DetectContentType(data), nil
 }
 
+// payloadETag returns the strong entity tag for a response payload.
+// Translib does not expose the DB change state; hence the tag is a
+// FNV-1a hash of the payload. It is cheap compared to the translib
+// Get and saves the transfer and parsing on the client.
+func payloadETag(data []byte) string {
+	h := fnv.New64a()
+	h.Write(data)
+	return fmt.Sprintf("\"%016x\"", h.Sum64())
+}
+
+// etagMatches checks if the If-None-Match header value matches the
+// entity tag. Uses the weak comparison as per RFC 7232 section 3.2.
+func etagMatches(ifNoneMatch, etag string) bool {
+	for _, v := range strings.Split(ifNoneMatch, ",") {
+		v = strings.TrimSpace(v)
+		if v == "*" || strings.TrimPrefix(v, "W/") == etag {
+			return true
+		}
+	}
+	return false
+}
+
 // getPathForTranslib converts REST URIs into GNMI paths
 func getPathForTranslib(r *http.Request, rc *RequestContext) string {
 	match := getRouteMatchInfo(r)
@@ -283,6 +376,11 @@ func (args *translibArgs) parseMethod(r *http.Request, rc *RequestContext) error
 	return nil
 }
 
+// isRead checks if the request reads data (GET or HEAD).
+func (args *translibArgs) isRead() bool {
+	return args.method == "GET" || args.method == "HEAD"
+}
+
 // parseClientVersion parses the Accept-Version request header value
 func (args *translibArgs) parseClientVersion(r *http.Request, rc *RequestContext) error {
 	if v := r.Header.Get("Accept-Version"); len(v) != 0 {
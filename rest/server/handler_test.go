@@ -20,6 +20,8 @@
 package server
 
 import (
+	"bytes"
+	"context"
 	"encoding/json"
 	"errors"
 	"fmt"
@@ -435,6 +437,28 @@ func TestReqData_BadJsonWithValidation(t *testing.T) {
 	testReqError(t, r, rc, 400)
 }
 
+func TestReqData_Cbor(t *testing.T) {
+	// {"one":1} in CBOR
+	input := "\xa1\x63one\x01"
+	r := httptest.NewRequest("PUT", "/test", strings.NewReader(input))
+	r.Header.Set("content-type", "application/yang-data+cbor")
+
+	rc := &RequestContext{ID: t.Name()}
+	rc.Consumes.Add("application/yang-data+json")
+
+	testReqSuccess(t, r, rc, "application/yang-data+json", "{\"one\":1}")
+}
+
+func TestReqData_BadCbor(t *testing.T) {
+	r := httptest.NewRequest("PUT", "/test", strings.NewReader("\xa1\x63on"))
+	r.Header.Set("content-type", "application/yang-data+cbor")
+
+	rc := &RequestContext{ID: t.Name()}
+	rc.Consumes.Add("application/yang-data+json")
+
+	testReqError(t, r, rc, 400)
+}
+
 func testReqSuccess(t *testing.T, r *http.Request, rc *RequestContext, expType, expData string) {
 	ct, data, err := getRequestBody(r, rc)
 
@@ -637,6 +661,98 @@ func TestProcessGET_error(t *testing.T) {
 	verifyResponse(t, w, 404)
 }
 
+func TestProcessGET_etag(t *testing.T) {
+	w := httptest.NewRecorder()
+	Process(w, prepareRequest(t, "GET", "/api-tests:sample", ""))
+	verifyResponse(t, w, 200)
+
+	etag := w.Header().Get("ETag")
+	if etag == "" {
+		t.Fatalf("Expecting ETag response header..")
+	}
+
+	r := prepareRequest(t, "GET", "/api-tests:sample", "")
+	r.Header.Set("If-None-Match", "\"0\", "+etag)
+	w = httptest.NewRecorder()
+	Process(w, r)
+	verifyResponse(t, w, 304)
+	if w.Body.Len() != 0 {
+		t.Fatalf("Expecting empty body; found %d bytes - %s", w.Body.Len(), w.Body.String())
+	}
+	if v := w.Header().Get("ETag"); v != etag {
+		t.Fatalf("Expecting ETag %s in 304; found '%s'", etag, v)
+	}
+	if v := w.Header().Get("Vary"); v != "Accept" {
+		t.Fatalf("Expecting 'Vary: Accept' in 304; found '%s'", v)
+	}
+
+	r = prepareRequest(t, "GET", "/api-tests:sample", "")
+	r.Header.Set("If-None-Match", "\"0\"")
+	w = httptest.NewRecorder()
+	Process(w, r)
+	verifyResponseData(t, w, 200, jsonObj{"path": "/api-tests:sample"})
+}
+
+func TestProcessGET_cbor(t *testing.T) {
+	r := prepareRequest(t, "GET", "/api-tests:sample", "")
+	r.Header.Set("Accept", "application/yang-data+cbor, application/yang-data+json;q=0.5")
+	w := httptest.NewRecorder()
+	Process(w, r)
+	verifyResponse(t, w, 200)
+
+	if ctype := w.Header().Get("Content-Type"); ctype != mimeYangDataCBOR {
+		t.Fatalf("Expecting content-type %s; found '%s'", mimeYangDataCBOR, ctype)
+	}
+	if etag := w.Header().Get("ETag"); !strings.HasPrefix(etag, "W/") {
+		t.Fatalf("Expecting weak ETag; found '%s'", etag)
+	}
+
+	jsn, err := cborToJSON(w.Body.Bytes())
+	if err != nil {
+		t.Fatalf("Invalid cbor response; err=%v", err)
+	}
+	w.Body = bytes.NewBuffer(jsn)
+	verifyResponseData(t, w, 200, jsonObj{"path": "/api-tests:sample"})
+
+	etag := w.Header().Get("ETag")
+	r.Header.Set("If-None-Match", etag)
+	w = httptest.NewRecorder()
+	Process(w, r)
+	verifyResponse(t, w, 304)
+	if v := w.Header().Get("ETag"); v != etag {
+		t.Fatalf("Expecting ETag %s in 304; found '%s'", etag, v)
+	}
+	if v := w.Header().Get("Vary"); v != "Accept" {
+		t.Fatalf("Expecting 'Vary: Accept' in 304; found '%s'", v)
+	}
+}
+
+func TestProcessGET_clientGone(t *testing.T) {
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+	r := prepareRequest(t, "GET", "/api-tests:sample", "").WithContext(ctx)
+	w := httptest.NewRecorder()
+	Process(w, r)
+
+	if w.Body.Len() != 0 || w.Header().Get("Content-Type") != "" {
+		t.Fatalf("Expecting no response; found %d bytes - %s", w.Body.Len(), w.Body.String())
+	}
+}
+
+func TestETagMatch(t *testing.T) {
+	etag := payloadETag([]byte("{}"))
+	for _, v := range []string{etag, "*", "W/" + etag, "\"1\", " + etag} {
+		if !etagMatches(v, etag) {
+			t.Fatalf("If-None-Match '%s' did not match %s", v, etag)
+		}
+	}
+	for _, v := range []string{"", "\"1\"", payloadETag([]byte("[]"))} {
+		if etagMatches(v, etag) {
+			t.Fatalf("If-None-Match '%s' matched %s", v, etag)
+		}
+	}
+}
+
 func TestProcessHEAD(t *testing.T) {
 	w := httptest.NewRecorder()
 	Process(w, prepareRequest(t, "HEAD", "/api-tests:sample", ""))
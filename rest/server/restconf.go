@@ -31,6 +31,7 @@ import (
 const (
 	mimeYangDataJSON = "application/yang-data+json"
 	mimeYangDataXML  = "application/yang-data+xml"
+	mimeYangDataCBOR = "application/yang-data+cbor"
 
 	restconfPathPrefix     = "/restconf/"
 	restconfDataPathPrefix = "/restconf/data/"
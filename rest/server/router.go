@@ -57,6 +57,10 @@ type RouterConfig struct {
 	// ServerAddr is the address to contact main server. Will be used to
 	// advertise the server's address (like yang download path).. Optional
 	ServerAddr string
+
+	// CompressMinSize is the smallest response body size, in bytes, to be
+	// gzip compressed for the clients accepting it. 0 disables compression.
+	CompressMinSize int
 }
 
 // ServeHTTP resolves and invokes the handler for http request r.